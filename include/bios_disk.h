@@ -24,6 +24,7 @@
 #include <memory>
 #include <stdio.h>
 #include <array>
+#include <vector>
 
 #include "bios.h"
 #include "dos_inc.h"
@@ -49,6 +50,12 @@ public:
 	Bit8u Read_AbsoluteSector(Bit32u sectnum, void * data);
 	Bit8u Write_AbsoluteSector(Bit32u sectnum, void * data);
 
+	// Transfer 'count' consecutive sectors in one go
+	Bit8u Read_AbsoluteSectors(Bit32u start, Bit32u count, void *data);
+	Bit8u Write_AbsoluteSectors(Bit32u start, Bit32u count, const void *data);
+
+	Bit32u Get_AbsoluteSector(Bit32u head, Bit32u cylinder, Bit32u sector) const;
+
 	void Set_Geometry(Bit32u setHeads, Bit32u setCyl, Bit32u setSect, Bit32u setSectSize);
 	void Get_Geometry(Bit32u * getHeads, Bit32u *getCyl, Bit32u *getSect, Bit32u *getSectSize);
 	Bit8u GetBiosType(void);
@@ -58,11 +65,7 @@ public:
 	imageDisk(const imageDisk&) = delete; // prevent copy
 	imageDisk& operator=(const imageDisk&) = delete; // prevent assignment
 
-	virtual ~imageDisk()
-	{
-		if (diskimg != nullptr)
-			fclose(diskimg);
-	}
+	virtual ~imageDisk();
 
 	bool hardDrive;
 	bool active;
@@ -72,9 +75,38 @@ public:
 
 	Bit32u sector_size;
 	Bit32u heads,cylinders,sectors;
+
 private:
-	Bit32u current_fpos;
-	enum { NONE,READ,WRITE } last_action;
+	// The image is memory-mapped when the host supports it, so sector
+	// transfers become plain copies and the OS page cache does the
+	// write-back. Otherwise (or past the end of the mapping) the image is
+	// accessed through a small write-back cache of multi-sector blocks,
+	// which turns runs of single-sector accesses into few large reads.
+	struct CacheBlock {
+		uint64_t offset = UINT64_MAX; // position in the image, or unused
+		size_t valid = 0;             // bytes backed by the image file
+		uint32_t last_use = 0;
+		bool dirty = false;
+		std::vector<Bit8u> data = {};
+	};
+
+	bool MapImage();
+	void UnmapImage();
+
+	size_t ReadImage(uint64_t offset, size_t bytes, Bit8u *data);
+	size_t WriteImage(uint64_t offset, size_t bytes, const Bit8u *data);
+	size_t ReadCached(uint64_t offset, size_t bytes, Bit8u *data);
+	size_t WriteCached(uint64_t offset, size_t bytes, const Bit8u *data);
+	CacheBlock &GetCacheBlock(uint64_t offset);
+	void FlushCacheBlock(CacheBlock &block);
+	void FlushCache();
+
+	Bit8u *mapped_image = nullptr;
+	size_t mapped_size = 0;
+	bool mapped_writable = false;
+
+	std::vector<CacheBlock> cache = {};
+	uint32_t cache_clock = 0;
 };
 
 void updateDPT(void);
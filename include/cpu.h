@@ -21,6 +21,8 @@
 
 #include "dosbox.h" 
 
+#include <cstdint>
+
 #ifndef DOSBOX_REGS_H
 #include "regs.h"
 #endif
@@ -54,6 +56,7 @@ extern Bit32s CPU_CyclePercUsed;
 extern Bit32s CPU_CycleLimit;
 extern Bit64s CPU_IODelayRemoved;
 extern bool CPU_CycleAutoAdjust;
+extern bool CPU_CycleGovernor; // auto cycles are set by the PI controller
 extern bool CPU_SkipCycleAutoAdjust;
 extern Bitu CPU_AutoDetermineMode;
 
@@ -82,6 +85,41 @@ void CPU_Enable_SkipAutoAdjust(void);
 void CPU_Disable_SkipAutoAdjust(void);
 void CPU_Reset_AutoAdjust(void);
 
+/* Idle detection */
+extern bool CPU_IdlePolling;
+
+// Gives up the remaining cycles (at most max_cycles) like HLT does, so
+// emulated time skips ahead to the next scheduled event and the host can
+// sleep once the current tick is over. Use when the guest is waiting.
+void CPU_Idle(Bit32s max_cycles = INT32_MAX);
+
+// Tracks a guest asking for something that isn't there yet (a key, the
+// next retrace) in a tight loop
+struct CPU_IdlePoller {
+	double last_poll = -1.0; // PIC_FullIndex of the previous poll
+	Bitu polls = 0;
+};
+
+// Counts a poll that came up empty. Returns true once the guest has kept
+// polling back-to-back long enough to be considered waiting, and only
+// with idle_polling enabled.
+bool CPU_IdlePoll(CPU_IdlePoller &poller);
+
+// The poll was answered, the guest isn't waiting anymore
+static INLINE void CPU_IdlePollHit(CPU_IdlePoller &poller) {
+	poller.polls = 0;
+}
+
+// How idle the guest and the host have been since the CPU was set up
+struct CPU_IdleStats {
+	double emulated_s = 0.0;   // emulated time
+	double guest_idle = 0.0;   // share of emulated time the guest was idle
+	double wall_s = 0.0;       // host time
+	double host_sleep = 0.0;   // share of host time spent sleeping
+};
+
+CPU_IdleStats CPU_GetIdleStats();
+
 
 //CPU Stuff
 
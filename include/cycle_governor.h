@@ -0,0 +1,95 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_CYCLE_GOVERNOR_H
+#define DOSBOX_CYCLE_GOVERNOR_H
+
+#include <cstdint>
+
+/*
+CycleGovernor picks the number of cycles per emulated millisecond when the
+cycles are set to auto or max and cycle_governor = pi.
+
+The host time spent emulating is measured with a microsecond clock over short
+windows (25 ms of host time) and divided by the emulated milliseconds that
+were run, which gives the load: the share of the host's time the emulator
+needs to keep up. A PI controller then moves the cycles so that the load
+settles on the target (90% of the max percentage).
+
+The load is proportional to the cycles, so the controller works on their
+logarithm: the error is ln(target / load), and each window multiplies the
+cycles by exp(kp * (error - previous error) + ki * error). Working on the
+change (velocity form) means hitting a limit can't wind the integrator up.
+
+Cycles the guest gave up by halting or waiting on I/O cost no host time;
+the load is scaled up to what it would have been had they all run. A window
+where the guest was almost entirely idle carries no information and leaves
+the cycles alone, as does one where the host stalled.
+*/
+
+class CycleGovernor {
+public:
+	struct State {
+		double target = 0.0; // wanted load, 0.9 at 100%
+		double load = 0.0;   // measured over the last window
+		double error = 0.0;  // target - load
+		int32_t cycles = 0;  // cycles per ms chosen for the next window
+	};
+
+	// Sampling window, in microseconds of host time
+	static constexpr int64_t window_us = 25000;
+
+	// Drops the current window; the next Update starts a fresh one
+	void ResetWindow();
+
+	// Emulated milliseconds that were run
+	void AddTicks(uint32_t ticks) { window_ticks += ticks; }
+
+	// Host time spent sleeping, waiting for the next tick
+	void AddSleep(int64_t us) { window_slept_us += us; }
+
+	enum class Outcome {
+		Measuring, // the window is still open
+		Restarted, // a new window started, the last one (if any) was dropped
+		Adjusted,  // cycles holds a new value, and a new window started
+	};
+
+	// Closes the window once it's long enough and sets the cycles to use
+	// for the next one. idle_cycles are the cycles given up during the
+	// window, percentage is the max percentage and limit the most cycles
+	// allowed (0 or less for none). Unless it returns Measuring, the
+	// caller starts counting idle cycles anew.
+	Outcome Update(int64_t now_us, int32_t &cycles, int64_t idle_cycles,
+	               int32_t percentage, int32_t limit);
+
+	const State &GetState() const { return state; }
+
+private:
+	State state = {};
+	int64_t window_start_us = -1;
+	int64_t window_slept_us = 0;
+	uint32_t window_ticks = 0;
+	double last_error = 0.0; // of the log error, for the proportional term
+};
+
+// The instance driving auto cycles, defined alongside the main loop
+extern CycleGovernor cycle_governor;
+
+#endif
@@ -86,6 +86,13 @@ public:
 	}
 	Bitu Read(Bitu size, Bit8u * buffer);
 	Bitu Write(Bitu size, Bit8u * buffer);
+
+	// Points data straight at the guest memory the next reads come from,
+	// saving the copy Read makes, and returns how many of the wanted
+	// bytes/words can be taken from there (0 when none sit in RAM). Skip
+	// moves past them afterwards, just like reading them would.
+	Bitu Peek(Bitu size, const Bit8u ** data) const;
+	Bitu Skip(Bitu size) { return Read(size, nullptr); }
 };
 
 class DmaController {
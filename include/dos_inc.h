@@ -112,6 +112,8 @@ enum { HAND_NONE=0,HAND_FILE,HAND_DEVICE};
 void DOS_SetupFiles (void);
 bool DOS_ReadFile(Bit16u handle,Bit8u * data,Bit16u * amount, bool fcb = false);
 bool DOS_WriteFile(Bit16u handle,Bit8u * data,Bit16u * amount,bool fcb = false);
+bool DOS_ReadFileToMem(Bit16u handle, PhysPt pt, Bit16u *amount);
+bool DOS_WriteFileFromMem(Bit16u handle, PhysPt pt, Bit16u *amount);
 bool DOS_SeekFile(Bit16u handle,Bit32u * pos,Bit32u type,bool fcb = false);
 bool DOS_CloseFile(Bit16u handle,bool fcb = false,Bit8u * refcnt = NULL);
 bool DOS_FlushFile(Bit16u handle);
@@ -54,6 +54,12 @@ struct FileStat_Block {
 
 class DOS_DTA;
 
+// A host buffer taking part in a scatter/gather file transfer
+struct DOS_IoSpan {
+	Bit8u *data;
+	Bit16u size;
+};
+
 class DOS_File {
 public:
 	DOS_File()
@@ -88,6 +94,13 @@ public:
 	virtual bool	Close()=0;
 	virtual Bit16u	GetInformation(void)=0;
 
+	// Transfer through a list of buffers as if they were one, stopping at
+	// the first short one. size holds the spans' total on entry and the
+	// amount transferred on return. The defaults call Read and Write once
+	// per span.
+	virtual bool ReadSpans(const DOS_IoSpan *spans, Bitu count, Bit16u *size);
+	virtual bool WriteSpans(const DOS_IoSpan *spans, Bitu count, Bit16u *size);
+
 	virtual bool IsOpen() { return open; }
 	virtual void AddRef() { refCtr++; }
 	virtual Bits RemoveRef() { return --refCtr; }
@@ -147,6 +160,8 @@ public:
 	localFile &operator=(const localFile &) = delete; // prevent assignment
 	bool Read(uint8_t *data, uint16_t *size);
 	bool Write(uint8_t *data, uint16_t *size);
+	bool ReadSpans(const DOS_IoSpan *spans, Bitu count, uint16_t *size);
+	bool WriteSpans(const DOS_IoSpan *spans, Bitu count, uint16_t *size);
 	bool Seek(uint32_t *pos, uint32_t type);
 	bool Close();
 	uint16_t GetInformation();
@@ -22,6 +22,7 @@
 #include "dosbox.h"
 
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <string>
 #include <vector>
@@ -178,6 +179,7 @@ public:
 	virtual void EmptyCache(void){}
 public:
 	Bit8u readSector(Bit32u sectnum, void * data);
+	Bit8u readSectors(Bit32u sectnum, Bit32u count, void *data);
 	Bit8u writeSector(Bit32u sectnum, void * data);
 	Bit32u getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos);
 	Bit32u getSectorSize(void);
@@ -194,6 +196,7 @@ public:
 private:
 	Bit32u getClusterValue(Bit32u clustNum);
 	void setClusterValue(Bit32u clustNum, Bit32u clustValue);
+	bool isEndOfChain(Bit32u clustValue) const;
 	Bit32u getClustFirstSect(Bit32u clustNum);
 	bool FindNextInternal(Bit32u dirClustNumber, DOS_DTA & dta, direntry *foundEntry);
 	bool getDirClustNum(char * dir, Bit32u * clustNum, bool parDir);
@@ -214,6 +217,15 @@ private:
 
 	Bit8u fatSectBuffer[1024];
 	Bit32u curFatSect;
+
+	// Cluster chains resolved so far, keyed by their starting cluster.
+	// Chains are extended lazily as deeper sectors are requested, and
+	// the whole index is dropped whenever the FAT is modified.
+	struct ClusterChain {
+		std::vector<Bit32u> clusters = {};
+		bool complete = false; // end-of-chain marker was reached
+	};
+	std::unordered_map<Bit32u, ClusterChain> clusterChains = {};
 };
 
 class cdromDrive final : public localDrive
@@ -312,7 +324,9 @@ struct isoDirEntry {
 #define IS_ASSOC(fileFlags)	(fileFlags & ISO_ASSOCIATED)
 #define IS_DIR(fileFlags)	(fileFlags & ISO_DIRECTORY)
 #define IS_HIDDEN(fileFlags)	(fileFlags & ISO_HIDDEN)
-#define ISO_MAX_HASH_TABLE_SIZE 	100
+#define ISO_SECTOR_CACHE_SETS	64
+#define ISO_SECTOR_CACHE_WAYS	8
+#define ISO_MAX_INDEX_ENTRIES	(256 * 1024)
 
 class isoDrive final : public DOS_Drive {
 public:
@@ -349,22 +363,46 @@ private:
 	bool GetNextDirEntry(const int dirIterator, isoDirEntry* de);
 	void FreeDirIterator(const int dirIterator);
 	bool ReadCachedSector(Bit8u** buffer, const Bit32u sector);
-	
+	bool buildIndex();
+
 	struct DirIterator {
 		bool valid;
 		bool root;
+		bool indexed; // walks indexEntries instead of directory sectors
 		Bit32u currentSector;
 		Bit32u endSector;
 		Bit32u pos;
+		Bit32u indexPos;
+		Bit32u indexEnd;
 	} dirIterators[MAX_OPENDIRS];
 	
 	int nextFreeDirIterator;
 	
-	struct SectorHashEntry {
+	struct SectorCacheEntry {
 		bool valid;
 		Bit32u sector;
+		Bit32u lastUse;
 		Bit8u data[ISO_FRAMESIZE];
-	} sectorHashEntries[ISO_MAX_HASH_TABLE_SIZE];
+	};
+	std::vector<SectorCacheEntry> sectorCache;
+	Bit32u sectorCacheClock;
+
+	// The directory tree, read once at mount time. Each directory's
+	// entries are stored next to each other, in the order found on disc.
+	struct IndexEntry {
+		std::string ident; // as left by readDirEntry, "." and ".." included
+		Bit32u extent;
+		Bit32u length;
+		Bit8u flags;
+		Bit8u dateYear, dateMonth, dateDay;
+		Bit8u timeHour, timeMin, timeSec;
+		Bit32u firstChild;  // directories only
+		Bit32u numChildren;
+	};
+	std::vector<IndexEntry> indexEntries;
+	std::unordered_map<std::string, Bit32u> indexPaths; // upper-cased path
+	std::unordered_map<Bit32u, Bit32u> indexDirs;       // extent of directory
+	void indexToDirEntry(isoDirEntry *de, const IndexEntry &entry) const;
 
 	bool iso;
 	bool dataCD;
@@ -75,6 +75,9 @@ public:
 
 	void Reactivate();
 
+	// False once the envelope has gone dormant and Process() is a no-op
+	bool IsActive() const { return is_active; }
+
 private:
 	Envelope(const Envelope &) = delete;            // prevent copying
 	Envelope &operator=(const Envelope &) = delete; // prevent assignment
@@ -94,6 +97,7 @@ private:
 
 	using process_f = std::function<void(Envelope &, bool, bool, intptr_t[], intptr_t[])>;
 	process_f process = &Envelope::Apply;
+	bool is_active = true;
 
 	const char *channel_name = nullptr;
 	uint32_t expire_after_frames = 0u; // Stop enveloping when this many
@@ -25,13 +25,13 @@
 #include "dosbox.h"
 
 #include <functional>
-#include <unordered_map>
 
 #define IO_MB	0x1 // Byte (8-bit)
 #define IO_MW	0x2 // Word (16-bit)
 #define IO_MD	0x4 // DWord (32-bit)
 #define IO_MA	(IO_MB | IO_MW | IO_MD ) // All three
 #define IO_SIZES 3 // byte, word, and dword
+#define IO_MAX_PORTS 0x10000 // 16-bit port address space
 
 // Existing type sizes
 using io_port_t = Bitu;
@@ -44,9 +44,6 @@ using io_val_t_proposed = uint32_t; // Handling exists up to a dword (or less)
 using IO_ReadHandler = std::function<Bitu(io_port_t port, Bitu iolen)>;
 using IO_WriteHandler = std::function<void(io_port_t port, io_val_t val, Bitu iolen)>;
 
-extern std::unordered_map<io_port_t, IO_WriteHandler> io_writehandlers[IO_SIZES];
-extern std::unordered_map<io_port_t, IO_ReadHandler> io_readhandlers[IO_SIZES];
-
 void IO_RegisterReadHandler(io_port_t port, IO_ReadHandler handler, Bitu mask, Bitu range = 1);
 void IO_RegisterWriteHandler(io_port_t port,
                              IO_WriteHandler handler,
@@ -132,6 +132,17 @@ void MEM_BlockCopy(PhysPt dest, PhysPt src, Bitu size);
 void MEM_StrCopy(PhysPt pt, char *data, Bitu size);
 
 void mem_memcpy(PhysPt dest, PhysPt src, Bitu size);
+
+/* Splits a block of memory into runs that are either plain host memory, which
+ * can be accessed directly, or have a nullptr host pointer and must go through
+ * the page handlers (as MEM_BlockRead and MEM_BlockWrite do). Adjacent runs of
+ * the same kind are merged, so at most size / MEM_PAGE_SIZE + 2 are stored. */
+struct MemHostRun {
+	HostPt host;
+	PhysPt pt;
+	size_t size;
+};
+size_t MEM_GetHostRuns(PhysPt pt, size_t size, bool for_write, MemHostRun *runs);
 Bitu mem_strlen(PhysPt pt);
 void mem_strcpy(PhysPt dest, PhysPt src);
 
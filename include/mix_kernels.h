@@ -0,0 +1,206 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_MIX_KERNELS_H
+#define DOSBOX_MIX_KERNELS_H
+
+/*  Mixer Kernels
+ *  -------------
+ *  The inner loops that move samples into and out of the mixer's 32-bit
+ *  work buffer, which holds interleaved left and right samples scaled up by
+ *  the channel volume. Each kernel has an SSE2 or NEON path, picked at
+ *  compile-time, and a scalar fallback; all paths produce identical results.
+ *
+ *  - mix_add_*: accumulate 16-bit frames multiplied by per-side volumes.
+ *    Sums wrap at 32 bits, the same as the mixer's scalar code.
+ *  - mix_to_s16: shift work samples down by the volume shift and clip them
+ *    to the 16-bit range.
+ *  - mix_drain_to_s16: like mix_to_s16, but also clears the work samples.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP == 2)
+#define MIX_KERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define MIX_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Scalar helpers
+// ~~~~~~~~~~~~~~
+static inline int32_t mix_scale(const int32_t sample, const int32_t volume)
+{
+	// Multiply and wrap without invoking signed overflow
+	return static_cast<int32_t>(static_cast<uint32_t>(sample) *
+	                            static_cast<uint32_t>(volume));
+}
+
+static inline int32_t mix_wrapping_add(const int32_t a, const int32_t b)
+{
+	return static_cast<int32_t>(static_cast<uint32_t>(a) +
+	                            static_cast<uint32_t>(b));
+}
+
+static inline int16_t mix_clip_s16(const int32_t sample, const int shift)
+{
+	const int32_t shifted = sample >> shift;
+	if (shifted > INT16_MAX)
+		return INT16_MAX;
+	if (shifted < INT16_MIN)
+		return INT16_MIN;
+	return static_cast<int16_t>(shifted);
+}
+
+#if MIX_KERNELS_SSE2
+// SSE2 lacks a 32-bit multiply-low, so build it from two 32x32->64 unsigned
+// multiplies; the low 32 bits are the same for signed operands.
+static inline __m128i mix_mullo_epi32(const __m128i a, const __m128i b)
+{
+	const __m128i even = _mm_mul_epu32(a, b);
+	const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+	                                  _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+	                          _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Sign-extends the low or high four 16-bit lanes to 32-bit
+static inline __m128i mix_widen_lo(const __m128i v)
+{
+	return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+static inline __m128i mix_widen_hi(const __m128i v)
+{
+	return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+#endif
+
+// Accumulates interleaved stereo frames into the work buffer
+static inline void mix_add_stereo_s16(int32_t *work,
+                                      const int16_t *src,
+                                      size_t frames,
+                                      const int32_t vol_left,
+                                      const int32_t vol_right)
+{
+#if MIX_KERNELS_SSE2
+	const __m128i vol = _mm_set_epi32(vol_right, vol_left, vol_right, vol_left);
+	for (; frames >= 4; frames -= 4, src += 8, work += 8) {
+		const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+		__m128i *out = reinterpret_cast<__m128i *>(work);
+		const __m128i lo = mix_mullo_epi32(mix_widen_lo(in), vol);
+		const __m128i hi = mix_mullo_epi32(mix_widen_hi(in), vol);
+		_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), lo));
+		_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), hi));
+	}
+#elif MIX_KERNELS_NEON
+	const int32_t vol_pair[4] = {vol_left, vol_right, vol_left, vol_right};
+	const int32x4_t vol = vld1q_s32(vol_pair);
+	for (; frames >= 4; frames -= 4, src += 8, work += 8) {
+		const int16x8_t in = vld1q_s16(src);
+		const int32x4_t lo = vmlaq_s32(vld1q_s32(work),
+		                               vmovl_s16(vget_low_s16(in)), vol);
+		const int32x4_t hi = vmlaq_s32(vld1q_s32(work + 4),
+		                               vmovl_s16(vget_high_s16(in)), vol);
+		vst1q_s32(work, lo);
+		vst1q_s32(work + 4, hi);
+	}
+#endif
+	for (; frames; --frames, src += 2, work += 2) {
+		work[0] = mix_wrapping_add(work[0], mix_scale(src[0], vol_left));
+		work[1] = mix_wrapping_add(work[1], mix_scale(src[1], vol_right));
+	}
+}
+
+// Accumulates mono frames into both sides of the work buffer
+static inline void mix_add_mono_s16(int32_t *work,
+                                    const int16_t *src,
+                                    size_t frames,
+                                    const int32_t vol_left,
+                                    const int32_t vol_right)
+{
+#if MIX_KERNELS_SSE2
+	const __m128i vol = _mm_set_epi32(vol_right, vol_left, vol_right, vol_left);
+	for (; frames >= 4; frames -= 4, src += 4, work += 8) {
+		const __m128i in = mix_widen_lo(
+		        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src)));
+		__m128i *out = reinterpret_cast<__m128i *>(work);
+		const __m128i lo = mix_mullo_epi32(_mm_unpacklo_epi32(in, in), vol);
+		const __m128i hi = mix_mullo_epi32(_mm_unpackhi_epi32(in, in), vol);
+		_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), lo));
+		_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), hi));
+	}
+#elif MIX_KERNELS_NEON
+	const int32_t vol_pair[4] = {vol_left, vol_right, vol_left, vol_right};
+	const int32x4_t vol = vld1q_s32(vol_pair);
+	for (; frames >= 4; frames -= 4, src += 4, work += 8) {
+		const int32x4_t in = vmovl_s16(vld1_s16(src));
+		const int32x4x2_t pairs = vzipq_s32(in, in);
+		vst1q_s32(work, vmlaq_s32(vld1q_s32(work), pairs.val[0], vol));
+		vst1q_s32(work + 4, vmlaq_s32(vld1q_s32(work + 4), pairs.val[1], vol));
+	}
+#endif
+	for (; frames; --frames, ++src, work += 2) {
+		work[0] = mix_wrapping_add(work[0], mix_scale(*src, vol_left));
+		work[1] = mix_wrapping_add(work[1], mix_scale(*src, vol_right));
+	}
+}
+
+// Converts work samples (not frames) into clipped 16-bit output samples
+static inline void mix_to_s16(const int32_t *work,
+                              int16_t *out,
+                              size_t samples,
+                              const int shift)
+{
+#if MIX_KERNELS_SSE2
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	for (; samples >= 8; samples -= 8, work += 8, out += 8) {
+		const __m128i *in = reinterpret_cast<const __m128i *>(work);
+		const __m128i lo = _mm_sra_epi32(_mm_loadu_si128(in), count);
+		const __m128i hi = _mm_sra_epi32(_mm_loadu_si128(in + 1), count);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+		                 _mm_packs_epi32(lo, hi));
+	}
+#elif MIX_KERNELS_NEON
+	const int32x4_t count = vdupq_n_s32(-shift);
+	for (; samples >= 8; samples -= 8, work += 8, out += 8) {
+		const int16x4_t lo = vqmovn_s32(vshlq_s32(vld1q_s32(work), count));
+		const int16x4_t hi = vqmovn_s32(vshlq_s32(vld1q_s32(work + 4), count));
+		vst1q_s16(out, vcombine_s16(lo, hi));
+	}
+#endif
+	for (; samples; --samples)
+		*out++ = mix_clip_s16(*work++, shift);
+}
+
+// Converts work samples into clipped 16-bit output and clears them
+static inline void mix_drain_to_s16(int32_t *work,
+                                    int16_t *out,
+                                    const size_t samples,
+                                    const int shift)
+{
+	mix_to_s16(work, out, samples, shift);
+	memset(work, 0, samples * sizeof(*work));
+}
+
+#endif
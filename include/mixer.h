@@ -25,6 +25,7 @@
 #include "dosbox.h"
 
 #include <functional>
+#include <vector>
 
 #include "envelope.h"
 
@@ -73,6 +74,19 @@ public:
 	void UpdateVolume();
 	void SetFreq(Bitu _freq);
 	void SetPeakAmplitude(uint32_t peak);
+
+	// Lets the channel render on the mixer's worker threads when the
+	// [mixer] threads setting is non-zero. Only opt in if the handler
+	// touches nothing but its own device's state. Work that reaches beyond
+	// that, such as raising IRQs or disabling the channel, belongs in the
+	// after_mix callback, which runs on the emulation thread once the
+	// channel's samples have been mixed in.
+	using after_mix_callback_f = std::function<void()>;
+	void EnableThreadedRendering(after_mix_callback_f after_mix);
+	bool CanRenderThreaded(Bitu _needed) const;
+	void RenderThreaded(Bitu _needed);
+	void MergeThreaded();
+
 	void Mix(Bitu _needed);
 	void AddSilence(); // Fill up until needed
 
@@ -114,6 +128,9 @@ private:
 	MixerChannel(const MixerChannel &) = delete;
 	MixerChannel &operator=(const MixerChannel &) = delete;
 
+	void AddSamplesAtMixerRate(Bitu len, const int16_t *data, bool stereo);
+	void Render(Bitu _needed);
+
 	Envelope envelope;
 	MIXER_Handler handler = nullptr;
 	Bitu freq_add = 0u; // This gets added the frequency counter each mixer
@@ -142,6 +159,15 @@ private:
 	// in-place of scaling by volmain[]
 	apply_level_callback_f apply_level = nullptr;
 
+	// Where AddSamples() and friends write: the mixer's work buffer, or
+	// the channel's private buffer while it renders on a worker thread.
+	using work_frame_t = int32_t[2];
+	work_frame_t *work = nullptr;
+	std::vector<int32_t> threaded_work = {};
+	Bitu threaded_start = 0u; // done count when the threaded render began
+	after_mix_callback_f after_mix = nullptr;
+	bool is_threadable = false;
+
 	bool interpolate = false;
 	bool last_samples_were_stereo = false;
 	bool last_samples_were_silence = true;
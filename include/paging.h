@@ -89,6 +89,8 @@ void PAGING_ClearTLB(void);
 void PAGING_LinkPage(Bitu lin_page,Bitu phys_page);
 void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page);
 void PAGING_UnlinkPages(Bitu lin_page,Bitu pages);
+/* Unlinks every linked page that maps to one of the physical pages */
+void PAGING_UnlinkPhysPages(Bitu phys_page,Bitu pages);
 /* This maps the page directly, only use when paging is disabled */
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page);
 bool PAGING_MakePhysPage(Bitu & page);
@@ -29,7 +29,7 @@
 
 #define RENDER_SKIP_CACHE	16
 //Enable this for scalers to support 0 input for empty lines
-//#define RENDER_NULL_INPUT
+#define RENDER_NULL_INPUT
 
 typedef struct {
 	struct { 
@@ -73,6 +73,8 @@ typedef struct {
 		ScalerLineHandler_t lineHandler;
 		ScalerLineHandler_t linePalHandler;
 		ScalerComplexHandler_t complexHandler;
+		ScalerComplexLineHandler_t complexLineHandler;
+		Bitu complexLines; // output lines per input line, 0 follows the aspect table
 		Bitu blocks, lastBlock;
 		int outPitch;
 		Bit8u *outWrite;
@@ -24,6 +24,8 @@
 #include <cctype>
 #include <list>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #ifndef DOSBOX_PROGRAMS_H
 #include "programs.h"
@@ -56,6 +58,20 @@ public:
 	BatchFile *prev = nullptr;
 	CommandLine *cmd = nullptr;
 	std::string filename{};
+
+private:
+	bool GetStamp(FileStat_Block &stamp) const;
+	bool LoadFile();
+	void IndexFile();
+
+	// The whole file, read again only when its size or date changes
+	std::vector<uint8_t> contents{};
+	FileStat_Block stamp{};
+	bool loaded = false;
+
+	std::vector<uint32_t> line_starts{};
+	// Upper-cased label to the offset of the line after it
+	std::unordered_map<std::string, uint32_t> labels{};
 };
 
 class AutoexecEditor;
@@ -0,0 +1,96 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SPSC_RING_H
+#define DOSBOX_SPSC_RING_H
+
+#include "dosbox.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/*
+SPSCRing is a fixed-capacity ring of preallocated slots shared between exactly
+one producer thread and one consumer thread.
+
+Unlike RWQueue, items are never moved or copied in or out of the ring: the
+producer acquires a free slot, fills it in place, and commits it; the consumer
+acquires the oldest committed slot, reads it in place, and releases it back.
+Slot hand-off uses only atomic index updates, so neither side takes a lock
+while the ring has room (for the producer) or items (for the consumer).
+
+The Acquire calls optionally block. A side only touches the mutex when it
+actually has to sleep, and the opposite side only signals when it sees a
+sleeper. Stop() wakes both sides and makes subsequent acquires return nullptr,
+which lets owners tear down their threads without draining the ring.
+*/
+
+template <typename T>
+class SPSCRing {
+public:
+	SPSCRing() = delete;
+	SPSCRing(const SPSCRing<T> &other) = delete;
+	SPSCRing<T> &operator=(const SPSCRing<T> &other) = delete;
+
+	// Preallocates num_slots copies of the prototype item
+	SPSCRing(size_t num_slots, const T &prototype = T());
+
+	size_t MaxCapacity() const;
+	size_t Size() const;
+	bool IsEmpty() const;
+	bool IsStopped() const;
+
+	// Producer side: fill the acquired slot then commit it. Returns
+	// nullptr if the ring is full (and wait is false) or was stopped.
+	T *AcquireWrite(bool wait = true);
+	void CommitWrite();
+
+	// Consumer side: read the acquired slot then release it. Returns
+	// nullptr if the ring is empty (and wait is false) or was stopped.
+	T *AcquireRead(bool wait = true);
+	void ReleaseRead();
+
+	// Wakes any waiting thread and rejects further acquires
+	void Stop();
+
+	// Empties and re-arms the ring; only call when no thread is using it
+	void Reset();
+
+private:
+	void Wait(bool for_write);
+	void WakeWaiters();
+
+	std::vector<T> slots;
+	const size_t capacity = 0;
+
+	// Monotonic counters: read_index is only written by the consumer and
+	// write_index only by the producer.
+	std::atomic<size_t> read_index{0};
+	std::atomic<size_t> write_index{0};
+
+	std::atomic<int> num_waiting{0};
+	std::atomic_bool is_stopped{false};
+	std::mutex mutex = {};
+	std::condition_variable wakeup = {};
+};
+
+#endif
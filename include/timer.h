@@ -20,12 +20,22 @@
 #define DOSBOX_TIMER_H
 
 /* underlying clock rate in HZ */
+#include <cstdint>
 #include <SDL.h>
 
 #define PIT_TICK_RATE 1193182
 
 #define GetTicks() SDL_GetTicks()
 
+/* Microseconds from the high-resolution counter, for measuring short spans */
+static inline int64_t GetTicksUs()
+{
+	const Uint64 count = SDL_GetPerformanceCounter();
+	const Uint64 freq = SDL_GetPerformanceFrequency();
+	return static_cast<int64_t>(count / freq * 1000000 +
+	                            count % freq * 1000000 / freq);
+}
+
 typedef void (*TIMER_TickHandler)(void);
 
 /* Register a function that gets called every time if 1 or more ticks pass */
@@ -0,0 +1,106 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_TRANSLATION_PROFILE_H
+#define DOSBOX_TRANSLATION_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+/*
+TranslationProfile remembers, across runs, where the dynamic core found code
+in each guest code page it translated.
+
+Translated blocks can't be stored themselves: the generated code embeds host
+addresses (of the cache block, the core's state and its helper functions)
+that are only valid in the process that produced them. Instead the profile
+records which offsets of a page were translated as block entries and which
+ones turned out to be self-modifying. With that, the core can translate all
+of a page's known blocks together the first time the page runs, and send
+self-modifying code straight to the normal core instead of re-translating it
+until the invalidation counter gives up.
+
+Pages are identified by a hash of their contents seeded with the code size
+(16 or 32-bit), so the same program loaded at a different address matches,
+while a page whose code differs won't.
+
+Only the pages that ran during a session are saved, and no more than
+max_pages are kept at a time. Pages that hold data next to code, or
+self-modifying code, produce a new key for each variant of their contents;
+without these limits those variants would pile up in the file run after run.
+
+The file starts with a format identifier followed by a host signature set by
+the core (backend and version); a file written by a different backend or
+version is ignored and replaced on the next save.
+*/
+
+class TranslationProfile {
+public:
+	struct Page {
+		std::set<uint16_t> entries = {};  // offsets of translated blocks
+		std::set<uint16_t> modified = {}; // offsets handed to the normal core
+		bool used = false; // found or recorded this session, not saved
+
+		template <class Archive>
+		void Serialize(Archive &archive)
+		{
+			archive & entries & modified;
+		}
+	};
+
+	static constexpr size_t max_pages = 8192;
+
+	TranslationProfile() = default;
+	TranslationProfile(const TranslationProfile &) = delete;
+	TranslationProfile &operator=(const TranslationProfile &) = delete;
+
+	// Hashes a 4 KB guest code page
+	static uint64_t PageKey(const uint8_t *page, bool code_big);
+
+	// Returns nullptr if the page hasn't been seen before
+	const Page *Find(uint64_t key);
+
+	// Once max_pages pages are known, a new page first replaces the ones
+	// unused this session, and is ignored if there are none
+	void AddEntry(uint64_t key, uint16_t offset);
+	void AddModified(uint64_t key, uint16_t offset);
+
+	size_t NumPages() const { return pages.size(); }
+	bool IsDirty() const { return dirty; }
+	void Clear();
+
+	// Both return false and leave the profile empty (Load) or the file
+	// untouched (Save) if anything goes wrong; the profile is optional.
+	// Save drops the pages unused this session first.
+	bool Load(const std::string &filename, const std::string &host_signature);
+	bool Save(const std::string &filename, const std::string &host_signature);
+
+private:
+	Page *Use(uint64_t key);
+	bool DropUnused();
+
+	std::map<uint64_t, Page> pages = {};
+	bool dirty = false;
+};
+
+#endif
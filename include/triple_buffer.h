@@ -0,0 +1,96 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_TRIPLE_BUFFER_H
+#define DOSBOX_TRIPLE_BUFFER_H
+
+#include "dosbox.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/*
+TripleBuffer hands the latest of a stream of items from one producer thread
+to one consumer thread, such as emulated frames to a presenter.
+
+Each side owns one of three preallocated slots and the third sits in the
+middle. Publishing swaps the producer's slot with the middle one and
+acquiring swaps the consumer's slot with it, both in a single atomic
+exchange, so neither side ever waits for the other. If the producer
+publishes twice before the consumer acquires, the older item is dropped
+and Publish() reports it; the consumer always gets the newest item.
+
+AcquireRead optionally blocks until something new is published, using the
+same sleeper handshake as SPSCRing. Stop() wakes the consumer and makes
+subsequent acquires return nullptr.
+*/
+
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer(const TripleBuffer<T> &other) = delete;
+	TripleBuffer<T> &operator=(const TripleBuffer<T> &other) = delete;
+
+	// Preallocates three copies of the prototype item
+	TripleBuffer(const T &prototype = T());
+
+	// Producer side: fill the write slot then publish it. Publish returns
+	// false if it replaced an item the consumer never acquired.
+	T &WriteSlot();
+	bool Publish();
+
+	// Consumer side: returns the newest published item, which stays
+	// valid until the next acquire. Returns nullptr if nothing new was
+	// published (and wait is false) or the buffer was stopped.
+	T *AcquireRead(bool wait = true);
+	bool HasNew() const;
+
+	// Wakes a waiting consumer and rejects further acquires
+	void Stop();
+	bool IsStopped() const;
+
+	// Forgets any published item and re-arms the buffer; only call when
+	// no thread is using it
+	void Reset();
+
+private:
+	void Wait();
+
+	std::vector<T> slots;
+
+	// Slot index in the low bits, plus a flag while the middle slot holds
+	// an item the consumer hasn't acquired yet
+	static constexpr unsigned index_mask = 0x3;
+	static constexpr unsigned fresh_flag = 0x4;
+	std::atomic<unsigned> middle{1};
+
+	// Only touched by their own side
+	unsigned write_index = 0;
+	unsigned read_index = 2;
+
+	std::atomic<int> num_waiting{0};
+	std::atomic_bool is_stopped{false};
+	std::mutex mutex = {};
+	std::condition_variable wakeup = {};
+};
+
+#endif
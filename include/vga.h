@@ -21,9 +21,10 @@
 
 #include "dosbox.h"
 
-//Don't enable keeping changes and mapping lfb probably...
+// Direct-mapped LFB and SVGA pages are tracked when their TLB entry gets
+// linked, so keeping changes works together with mapping the lfb
 #define VGA_LFB_MAPPED
-//#define VGA_KEEP_CHANGES
+#define VGA_KEEP_CHANGES
 #define VGA_CHANGE_SHIFT	9
 
 class PageHandler;
@@ -362,12 +363,13 @@ typedef struct {
 
 typedef struct {
 	//Add a few more just to be safe
-	Bit8u*	map; /* allocated dynamically: [(VGA_MEMORY >> VGA_CHANGE_SHIFT) + 32] */
+	Bit8u*	map; /* allocated dynamically: [(fastmem size >> VGA_CHANGE_SHIFT) + 32] */
+	Bitu	mapSize;
 	Bit8u	checkMask, frame, writeMask;
-	bool	active;
-	Bit32u  clearMask;
-	Bit32u	start, last;
-	Bit32u	lastAddress;
+	bool	active;		/* Only draw the lines of this frame that were written to */
+	bool	redraw;		/* Output changed without a memory write, draw the next frame in full */
+	Bit8u*	lastBase;	/* Layout of the last drawn frame */
+	Bitu	lastAddress, lastAddressAdd, lastMask, lastSplit, lastLineSkip;
 } VGA_Changes;
 
 typedef struct {
@@ -449,6 +451,8 @@ void VGA_SetClock(Bitu which,Bitu target);
 void VGA_DACSetEntirePalette(void);
 void VGA_StartRetrace(void);
 void VGA_StartUpdateLFB(void);
+void VGA_MarkChanged(Bitu start, Bitu size);
+void VGA_UnlinkMappedPages(void);
 void VGA_SetBlinking(Bitu enabled);
 void VGA_SetCGA2Table(Bit8u val0,Bit8u val1);
 void VGA_SetCGA4Table(Bit8u val0,Bit8u val1,Bit8u val2,Bit8u val3);
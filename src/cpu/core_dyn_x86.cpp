@@ -54,6 +54,7 @@
 #include "fpu.h"
 
 #define CACHE_MAXSIZE	(4096*3)
+// default cache dimensions, see CPU_Core_Dyn_X86_Cache_Configure
 #define CACHE_TOTAL		(1024*1024*8)
 #define CACHE_PAGES		(512)
 #define CACHE_BLOCKS	(64*1024)
@@ -464,12 +465,17 @@ void CPU_Core_Dyn_X86_Init(void) {
 	return;
 }
 
+void CPU_Core_Dyn_X86_Cache_Configure(Bitu size_mb, Bitu pages) {
+	cache_configure(size_mb, pages);
+}
+
 void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache) {
 	/* Initialize code cache and dynamic blocks */
 	cache_init(enable_cache);
 }
 
 void CPU_Core_Dyn_X86_Cache_Close(void) {
+	cache_log_stats("DYNX86");
 	cache_close();
 }
 
@@ -87,16 +87,13 @@ static bool MakeCodePage(Bitu lin_addr,CodePageHandler * &cph) {
 	}
 	/* Find a free CodePage */
 	if (!cache.free_pages && cache.used_pages) {
-		if (cache.used_pages != decode.page.code)
-			cache.used_pages->ClearRelease();
-		else {
-			if ((cache.used_pages->next) && (cache.used_pages->next != decode.page.code))
-				cache.used_pages->next->ClearRelease();
-			else {
-				LOG_MSG("DYNX86:Invalid cache links");
-				cache.used_pages->ClearRelease();
-			}
+		CodePageHandler *victim = cache_pick_victim_page(decode.page.code);
+		if (!victim) {
+			LOG_MSG("DYNX86:Invalid cache links");
+			victim = cache.used_pages;
 		}
+		victim->ClearRelease();
+		cache.stats.evicted_pages++;
 	}
 	if (!cache.free_pages) {
 		LOG_MSG("DYNX86:cache.free_pages is not usable");
@@ -2189,6 +2186,9 @@ static CacheBlock * CreateCacheBlock(CodePageHandler * codepage,PhysPt start,Bit
 	}
 	gen_reinit();
 	gen_save_host_direct(&cache.block.running,(Bitu)decode.block);
+	/* Mark the block and its page as recently run, linked entries included */
+	gen_save_host_dword(&decode.block->hits,CACHE_MAX_HITS);
+	gen_save_host_dword(&codepage->hits,CACHE_MAX_HITS);
 	/* Start with the cycles check */
 	gen_protectflags();
 	gen_dop_word(DOP_TEST,true,DREG(CYCLES),DREG(CYCLES));
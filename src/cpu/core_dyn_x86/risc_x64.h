@@ -1220,6 +1220,13 @@ static void gen_save_host_direct(void *data,Bitu imm) {
 		opcode(0).set64().setimm(imm,4).setabsaddr(data).Emit8(0xC7); // mov qword[], Bit32s
 }
 
+// Stores a dword anywhere in memory, unlike gen_save_host_direct which needs
+// an address setabsaddr can reach; clobbers rax
+static void gen_save_host_dword(void *data,Bit32u imm) {
+	opcode(0).set64().setimm((Bitu)data,8).Emit8Reg(0xB8); // mov rax,imm64
+	opcode(0).setea(0).setimm(imm,4).Emit8(0xC7); // mov dword[rax],imm32
+}
+
 static void gen_return(BlockReturn retcode) {
 	gen_protectflags();
 	opcode(1).setea(4,-1,0,CALLSTACK).Emit8(0x8B); // mov ecx, [rsp+8/40]
@@ -1041,6 +1041,10 @@ static void gen_save_host_direct(void * data,Bits imm) {
 	cache_addd(imm);
 }
 
+static void gen_save_host_dword(void * data,Bit32u imm) {
+	gen_save_host_direct(data,imm);
+}
+
 static void gen_return(BlockReturn retcode) {
 	gen_protectflags();
 	cache_addb(0x59);			//POP ECX, the flags
@@ -26,6 +26,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 #include <type_traits>
 
 #if defined (WIN32)
@@ -53,8 +54,10 @@
 #include "inout.h"
 #include "lazyflags.h"
 #include "pic.h"
+#include "translation_profile.h"
 
 #define CACHE_MAXSIZE	(4096*2)
+// default cache dimensions, see CPU_Core_Dynrec_Cache_Configure
 #define CACHE_TOTAL		(1024*1024*8)
 #define CACHE_PAGES		(512)
 #define CACHE_BLOCKS	(128*1024)
@@ -199,6 +202,72 @@ CacheBlock *LinkBlocks(BlockReturn ret)
 	return block;
 }
 
+// Persistent translation profile, see translation_profile.h
+static TranslationProfile dynrec_profile;
+static std::string dynrec_profile_file = {};
+
+// Profiles depend on how the decoder splits code into blocks, so they are
+// only valid for the backend and version that wrote them.
+static std::string dynrec_profile_signature()
+{
+	return "dynrec-" + std::to_string(C_TARGETCPU) + "-" +
+	       std::to_string(sizeof(void *) * 8) + "-" + VERSION;
+}
+
+// Called the first time a code page runs. If the page's code was profiled
+// before, its self-modifying instructions are handed to the normal core
+// straight away and its blocks are translated in one go. Returns true if
+// any block was translated.
+static bool dynrec_profile_apply(CodePageHandler *chandler, PhysPt ip_point)
+{
+	chandler->profile_checked = true;
+	if (dynrec_profile_file.empty())
+		return false;
+	const uint8_t *code = chandler->GetCode();
+	if (!code)
+		return false;
+	chandler->profile_key = TranslationProfile::PageKey(code, cpu.code.big);
+	const auto page = dynrec_profile.Find(chandler->profile_key);
+	if (!page)
+		return false;
+
+	for (const auto offset : page->modified)
+		chandler->MarkModified(offset);
+
+	// Blocks at the end of the page may continue in the next one. That
+	// page must already be mapped to memory, as merely looking at it
+	// could raise a page fault or touch a device while the guest isn't
+	// running this code yet.
+	const PhysPt page_base = ip_point & ~static_cast<PhysPt>(4095);
+	const PhysPt next_page = page_base + 4096;
+	if (!get_tlb_read(next_page) &&
+	    !(get_tlb_readhandler(next_page)->flags & PFLAG_HASCODE))
+		return false;
+
+	bool translated = false;
+	for (const auto offset : page->entries) {
+		if (chandler->FindCacheBlock(offset))
+			continue;
+		if (chandler->invalidation_map && chandler->invalidation_map[offset] >= 4)
+			continue;
+		CreateCacheBlock(chandler, page_base + offset, 32);
+		translated = true;
+	}
+	return translated;
+}
+
+static inline void dynrec_profile_entry(const CodePageHandler *chandler, PhysPt ip_point)
+{
+	if (!dynrec_profile_file.empty() && chandler->profile_checked)
+		dynrec_profile.AddEntry(chandler->profile_key, ip_point & 4095);
+}
+
+static inline void dynrec_profile_modified(const CodePageHandler *chandler, PhysPt ip_point)
+{
+	if (!dynrec_profile_file.empty() && chandler->profile_checked)
+		dynrec_profile.AddModified(chandler->profile_key, ip_point & 4095);
+}
+
 /*
 	The core tries to find the block that should be executed next.
 	If such a block is found, it is run, otherwise the instruction
@@ -231,6 +300,10 @@ Bits CPU_Core_Dynrec_Run(void) {
 		// page doesn't contain code or is special
 		if (GCC_UNLIKELY(!chandler)) return CPU_Core_Normal_Run();
 
+		if (GCC_UNLIKELY(!chandler->profile_checked) &&
+		    dynrec_profile_apply(chandler, ip_point))
+			continue; // blocks of this page were translated, look again
+
 		// find correct Dynamic Block to run
 		CacheBlock *block = chandler->FindCacheBlock(ip_point & 4095);
 		if (!block) {
@@ -238,8 +311,10 @@ Bits CPU_Core_Dynrec_Run(void) {
 			// unless the instruction is known to be modified
 			if (!chandler->invalidation_map || (chandler->invalidation_map[ip_point&4095]<4)) {
 				// translate up to 32 instructions
+				dynrec_profile_entry(chandler, ip_point);
 				block=CreateCacheBlock(chandler,ip_point,32);
 			} else {
+				dynrec_profile_modified(chandler, ip_point);
 				// let the normal core handle this instruction to avoid zero-sized blocks
 				Bitu old_cycles=CPU_Cycles;
 				CPU_Cycles=1;
@@ -357,12 +432,34 @@ Bits CPU_Core_Dynrec_Trap_Run(void) {
 void CPU_Core_Dynrec_Init(void) {
 }
 
+void CPU_Core_Dynrec_Cache_Configure(Bitu size_mb, Bitu pages) {
+	cache_configure(size_mb, pages);
+}
+
+void CPU_Core_Dynrec_Cache_Profile(const std::string &filename) {
+	dynrec_profile_file = filename;
+	if (filename.empty())
+		return;
+	if (dynrec_profile.Load(filename, dynrec_profile_signature()))
+		LOG_MSG("DYNREC: Loaded the translation profile of %u code pages from %s",
+		        static_cast<unsigned>(dynrec_profile.NumPages()), filename.c_str());
+}
+
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache) {
 	// Initialize code cache and dynamic blocks
 	cache_init(enable_cache);
 }
 
 void CPU_Core_Dynrec_Cache_Close(void) {
+	cache_log_stats("DYNREC");
+	if (cache.stats.translations)
+		LOG_MSG("DYNREC: Superblocks followed %llu jumps and formed %llu side exits",
+		        static_cast<unsigned long long>(trace_stats.jumps_followed),
+		        static_cast<unsigned long long>(trace_stats.side_exits));
+	if (!dynrec_profile_file.empty() && dynrec_profile.IsDirty() &&
+	    !dynrec_profile.Save(dynrec_profile_file, dynrec_profile_signature()))
+		LOG_MSG("DYNREC: Couldn't write the translation profile to %s",
+		        dynrec_profile_file.c_str());
 	cache_close();
 }
 
@@ -39,6 +39,7 @@ static CacheBlock *CreateCacheBlock(CodePageHandler *codepage, PhysPt start, Bit
 	decode.page.wmap=codepage->write_map;
 	decode.page.invmap=codepage->invalidation_map;
 	decode.page.first=start >> 12;
+	decode.side_exit=false;
 	decode.active_block=decode.block=cache_openblock();
 	decode.block->page.start=(Bit16u)decode.page.index;
 	codepage->AddCacheBlock(decode.block);
@@ -49,6 +50,11 @@ static CacheBlock *CreateCacheBlock(CodePageHandler *codepage, PhysPt start, Bit
 	// so the block linking knows the last executed block
 	gen_mov_direct_ptr(&cache.block.running,(Bitu)decode.block);
 
+	// mark the block and its page as recently run, which keeps them from
+	// being evicted; done here so blocks entered through links count too
+	gen_mov_direct_dword(&decode.block->hits,CACHE_MAX_HITS);
+	gen_mov_direct_dword(&codepage->hits,CACHE_MAX_HITS);
+
 	// start with the cycles check
 	gen_mov_word_to_reg(FC_RETOP,&CPU_Cycles,true);
 	save_info_dynrec[used_save_info_dynrec].branch_pos=gen_create_branch_long_leqzero(FC_RETOP);
@@ -192,10 +198,12 @@ restart_prefix:
 
 				// short conditional jumps
 				case 0x80:case 0x81:case 0x82:case 0x83:case 0x84:case 0x85:case 0x86:case 0x87:	
-				case 0x88:case 0x89:case 0x8a:case 0x8b:case 0x8c:case 0x8d:case 0x8e:case 0x8f:	
-					dyn_branched_exit((BranchTypes)(dual_code&0xf),
-						decode.big_op ? (Bit32s)decode_fetchd() : (Bit16s)decode_fetchw());
+				case 0x88:case 0x89:case 0x8a:case 0x8b:case 0x8c:case 0x8d:case 0x8e:case 0x8f: {
+					Bit32s eip_add=decode.big_op ? (Bit32s)decode_fetchd() : (Bit16s)decode_fetchw();
+					if (dyn_side_exit((BranchTypes)(dual_code&0xf),eip_add)) break;
+					dyn_branched_exit((BranchTypes)(dual_code&0xf),eip_add);
 					goto finish_block;
+				}
 
 				// conditional byte set instructions
 /*				case 0x90:case 0x91:case 0x92:case 0x93:case 0x94:case 0x95:case 0x96:case 0x97:	
@@ -295,9 +303,12 @@ restart_prefix:
 
 		// short conditional jumps
 		case 0x70:case 0x71:case 0x72:case 0x73:case 0x74:case 0x75:case 0x76:case 0x77:	
-		case 0x78:case 0x79:case 0x7a:case 0x7b:case 0x7c:case 0x7d:case 0x7e:case 0x7f:	
-			dyn_branched_exit((BranchTypes)(opcode&0xf),(Bit8s)decode_fetchb());	
+		case 0x78:case 0x79:case 0x7a:case 0x7b:case 0x7c:case 0x7d:case 0x7e:case 0x7f: {
+			Bit32s eip_add=(Bit8s)decode_fetchb();
+			if (dyn_side_exit((BranchTypes)(opcode&0xf),eip_add)) break;
+			dyn_branched_exit((BranchTypes)(opcode&0xf),eip_add);
 			goto finish_block;
+		}
 
 		// 'op []/reg8,imm8'
 		case 0x80:
@@ -513,17 +524,23 @@ restart_prefix:
 			dyn_call_near_imm();
 			goto finish_block;
 		// 'jmp near imm16/32'
-		case 0xe9:
-			dyn_exit_link(decode.big_op ? (Bit32s)decode_fetchd() : (Bit16s)decode_fetchw());
+		case 0xe9: {
+			Bits eip_change=decode.big_op ? (Bit32s)decode_fetchd() : (Bit16s)decode_fetchw();
+			if (dyn_follow_jump(eip_change)) break;
+			dyn_exit_link(eip_change);
 			goto finish_block;
+		}
 		// 'jmp far'
 		case 0xea:
 			dyn_jmp_far_imm();
 			goto finish_block;
 		// 'jmp short imm8'
-		case 0xeb:
-			dyn_exit_link((Bit8s)decode_fetchb());
+		case 0xeb: {
+			Bits eip_change=(Bit8s)decode_fetchb();
+			if (dyn_follow_jump(eip_change)) break;
+			dyn_exit_link(eip_change);
 			goto finish_block;
+		}
 
 
 		// repeat prefixes
@@ -103,6 +103,7 @@ static struct DynDecode {
 	Bitu cycles;			// number cycles used by currently translated code
 	bool seg_prefix_used;	// segment overridden
 	Bit8u seg_prefix;		// segment prefix (if seg_prefix_used==true)
+	bool side_exit;			// the second block link is used by a side exit
 
 	// block that contains the first instruction translated
 	CacheBlock *block;
@@ -127,6 +128,12 @@ static struct DynDecode {
 	} modrm;
 } decode;
 
+// superblock statistics, see dyn_follow_jump and dyn_side_exit
+static struct {
+	uint64_t jumps_followed;
+	uint64_t side_exits;
+} trace_stats;
+
 static bool MakeCodePage(Bitu lin_addr, CodePageHandler *&cph)
 {
 	Bit8u rdval;
@@ -172,16 +179,14 @@ static bool MakeCodePage(Bitu lin_addr, CodePageHandler *&cph)
 	}
 	// find a free CodePage
 	if (!cache.free_pages) {
-		if (cache.used_pages!=decode.page.code) cache.used_pages->ClearRelease();
-		else {
-			// try another page to avoid clearing our source-crosspage
-			if ((cache.used_pages->next) && (cache.used_pages->next!=decode.page.code))
-				cache.used_pages->next->ClearRelease();
-			else {
-				LOG_MSG("DYNREC:Invalid cache links");
-				cache.used_pages->ClearRelease();
-			}
+		// avoid clearing our source-crosspage
+		CodePageHandler *victim = cache_pick_victim_page(decode.page.code);
+		if (!victim) {
+			LOG_MSG("DYNREC:Invalid cache links");
+			victim = cache.used_pages;
 		}
+		victim->ClearRelease();
+		cache.stats.evicted_pages++;
 	}
 	CodePageHandler *cpagehandler = cache.free_pages;
 	cache.free_pages=cache.free_pages->next;
@@ -292,6 +297,16 @@ static void INLINE decode_increase_wmapmask(Bitu size) {
 	}
 }
 
+// continue decoding further on in the current page; the skipped bytes
+// don't belong to the block, so they are masked out of its write map
+static void decode_skip(Bitu bytes) {
+	for (Bitu i=0;i<bytes;i++) {
+		decode_increase_wmapmask(1);
+		decode.page.index++;
+	}
+	decode.code+=bytes;
+}
+
 // fetch a byte, val points to the code location if possible,
 // otherwise val contains the current value read from the position
 static bool decode_fetchb_imm(Bitu & val) {
@@ -1104,7 +1104,22 @@ static void dyn_exit_link(Bits eip_change) {
 }
 
 
+// Branches with two targets need both block links. If a side exit took
+// the second one already, end the block before the branch; it is then
+// translated as the start of the next block.
+static void dyn_exit_before_branch(void) {
+	if (decode.cycles) decode.cycles--;
+	dyn_set_eip_last();
+	dyn_reduce_cycles();
+	gen_jmp_ptr(&decode.block->link[0].to, offsetof(CacheBlock, cache.start));
+	dyn_closeblock();
+}
+
 static void dyn_branched_exit(BranchTypes btype,Bit32s eip_add) {
+	if (decode.side_exit) {
+		dyn_exit_before_branch();
+		return;
+	}
 	Bitu eip_base=decode.code-decode.code_start;
 	dyn_reduce_cycles();
 
@@ -1122,6 +1137,54 @@ static void dyn_branched_exit(BranchTypes btype,Bit32s eip_add) {
 	dyn_closeblock();
 }
 
+/*
+	Superblocks: rather than ending a block at every branch, translation
+	carries on along the path the code is most likely to take. Either way
+	the block is exited through the same linked jumps, so no profiling is
+	needed before forming them.
+*/
+
+// max. number of bytes a followed jump may skip
+#define DYN_FOLLOW_JUMP_MAX 512
+
+// Unconditional jumps a short way forward in the same page continue the
+// block at their target. Returns false if the block has to end instead.
+static bool dyn_follow_jump(Bits eip_change) {
+	if (eip_change<0 || eip_change>DYN_FOLLOW_JUMP_MAX) return false;
+	if (decode.page.index+eip_change>=4096) return false;
+	// the linear target only matches if ip doesn't wrap around
+	Bitu eip_next=decode.code-SegPhys(cs);
+	if (!decode.big_op && eip_next+eip_change>0xffff) return false;
+	decode_skip(eip_change);
+	trace_stats.jumps_followed++;
+	return true;
+}
+
+// Forward conditional jumps are assumed not to be taken: the taken path
+// leaves through a side exit and the block continues after the jump. The
+// side exit needs the second block link, so only one is possible per block.
+// Returns false if the jump has to end the block instead.
+static bool dyn_side_exit(BranchTypes btype,Bit32s eip_add) {
+	if (eip_add<=0 || decode.side_exit) return false;
+	decode.side_exit=true;
+	Bitu eip_base=decode.code-decode.code_start;
+
+	// the block carries on, so later instructions mustn't drop the flags
+	// the test depends on
+	AcquireFlags(FMASK_TEST);
+
+	// skip the exit unless the branch is taken
+	dyn_branchflag_to_reg((BranchTypes)(btype^1));
+	const auto not_taken=gen_create_branch_long_nonzero(FC_RETOP,true);
+
+	dyn_reduce_cycles();
+	gen_add_direct_word(&reg_eip,eip_base+eip_add,decode.big_op);
+	gen_jmp_ptr(&decode.block->link[1].to, offsetof(CacheBlock, cache.start));
+	gen_fill_branch_long(not_taken);
+	trace_stats.side_exits++;
+	return true;
+}
+
 /*
 static void dyn_set_byte_on_condition(BranchTypes btype) {
 	dyn_get_modrm();
@@ -1137,6 +1200,10 @@ static void dyn_set_byte_on_condition(BranchTypes btype) {
 */
 
 static void dyn_loop(LoopTypes type) {
+	if (decode.side_exit) {
+		dyn_exit_before_branch();
+		return;
+	}
 	dyn_reduce_cycles();
 	Bits eip_add=(Bit8s)decode_fetchb();
 	Bitu eip_base=decode.code-decode.code_start;
@@ -18,7 +18,9 @@
 
 #include "cpu.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <sstream>
 #include <stddef.h>
 
@@ -28,6 +30,8 @@
 #include "setup.h"
 #include "programs.h"
 #include "paging.h"
+#include "pic.h"
+#include "cycle_governor.h"
 #include "lazyflags.h"
 #include "support.h"
 
@@ -59,6 +63,7 @@ Bit32s CPU_CycleDown = 0;
 Bit64s CPU_IODelayRemoved = 0;
 CPU_Decoder * cpudecoder;
 bool CPU_CycleAutoAdjust = false;
+bool CPU_CycleGovernor = false;
 bool CPU_SkipCycleAutoAdjust = false;
 Bitu CPU_AutoDetermineMode = 0;
 
@@ -73,11 +78,14 @@ void CPU_Core_Normal_Init(void);
 void CPU_Core_Simple_Init(void);
 #if (C_DYNAMIC_X86)
 void CPU_Core_Dyn_X86_Init(void);
+void CPU_Core_Dyn_X86_Cache_Configure(Bitu size_mb, Bitu pages);
 void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
 void CPU_Core_Dyn_X86_Cache_Close(void);
 void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu);
 #elif (C_DYNREC)
 void CPU_Core_Dynrec_Init(void);
+void CPU_Core_Dynrec_Cache_Configure(Bitu size_mb, Bitu pages);
+void CPU_Core_Dynrec_Cache_Profile(const std::string &filename);
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
 void CPU_Core_Dynrec_Cache_Close(void);
 #endif
@@ -2049,21 +2057,87 @@ bool CPU_CPUID(void) {
 	return true;
 }
 
+bool CPU_IdlePolling = false;
+
+// Emulated time spent idle, in ms (ticks)
+static double idle_ticks = 0.0;
+static Bitu idle_start_tick = 0;
+
+// Host time spent sleeping between ticks, in ms
+extern Bit32u ticksSlept;
+static Bit32u idle_start_slept = 0;
+static std::chrono::steady_clock::time_point idle_start_time;
+
+// A guest polling more often than this is taken to be spinning on the
+// poll; one that does other work in between isn't
+constexpr double idle_poll_gap = 0.1; // ms
+constexpr Bitu idle_poll_count = 16;
+
+void CPU_Idle(Bit32s max_cycles) {
+	const Bit32s cycles = std::min(CPU_Cycles, max_cycles);
+	if (cycles <= 0)
+		return;
+	CPU_Cycles -= cycles;
+	CPU_IODelayRemoved += cycles;
+	if (CPU_CycleMax > 0)
+		idle_ticks += static_cast<double>(cycles) / CPU_CycleMax;
+}
+
+bool CPU_IdlePoll(CPU_IdlePoller &poller) {
+	if (!CPU_IdlePolling)
+		return false;
+	const double now = PIC_FullIndex();
+	if (now - poller.last_poll > idle_poll_gap)
+		poller.polls = 0;
+	poller.last_poll = now;
+	if (poller.polls < idle_poll_count) {
+		poller.polls++;
+		return false;
+	}
+	return true;
+}
+
+CPU_IdleStats CPU_GetIdleStats() {
+	CPU_IdleStats stats;
+	const Bitu ticks = PIC_Ticks - idle_start_tick;
+	if (ticks) {
+		stats.emulated_s = ticks / 1000.0;
+		stats.guest_idle = idle_ticks / ticks;
+	}
+	using namespace std::chrono;
+	const auto wall = duration_cast<milliseconds>(steady_clock::now() -
+	                                              idle_start_time).count();
+	if (wall > 0) {
+		stats.wall_s = wall / 1000.0;
+		stats.host_sleep = static_cast<double>(ticksSlept - idle_start_slept) / wall;
+	}
+	return stats;
+}
+
+static void CPU_LogIdleStats(void) {
+	const CPU_IdleStats stats = CPU_GetIdleStats();
+	if (stats.emulated_s <= 0)
+		return;
+	LOG_MSG("CPU: Guest was idle for %.1f%% of %.1f s emulated",
+	        100.0 * stats.guest_idle, stats.emulated_s);
+	if (stats.wall_s > 0)
+		LOG_MSG("CPU: Host slept for %.1f%% of %.1f s",
+		        100.0 * stats.host_sleep, stats.wall_s);
+}
+
 static Bits HLT_Decode(void) {
 	/* Once an interrupt occurs, it should change cpu core */
 	if (reg_eip!=cpu.hlt.eip || SegValue(cs) != cpu.hlt.cs) {
 		cpudecoder=cpu.hlt.old_decoder;
 	} else {
-		CPU_IODelayRemoved += CPU_Cycles;
-		CPU_Cycles=0;
+		CPU_Idle();
 	}
 	return 0;
 }
 
 void CPU_HLT(Bitu oldeip) {
 	reg_eip=oldeip;
-	CPU_IODelayRemoved += CPU_Cycles;
-	CPU_Cycles=0;
+	CPU_Idle();
 	cpu.hlt.cs=SegValue(cs);
 	cpu.hlt.eip=reg_eip;
 	cpu.hlt.old_decoder=cpudecoder;
@@ -2172,6 +2246,7 @@ void CPU_Reset_AutoAdjust(void) {
 	CPU_IODelayRemoved = 0;
 	ticksDone = 0;
 	ticksScheduled = 0;
+	cycle_governor.ResetWindow();
 }
 
 class CPU final : public Module_base {
@@ -2185,6 +2260,9 @@ public:
 		}
 //		Section_prop * section=static_cast<Section_prop *>(configuration);
 		inited=true;
+		idle_start_tick = PIC_Ticks;
+		idle_start_slept = ticksSlept;
+		idle_start_time = std::chrono::steady_clock::now();
 		reg_eax=0;
 		reg_ebx=0;
 		reg_ecx=0;
@@ -2249,6 +2327,7 @@ public:
 		//CPU_CycleLeft=0;//needed ?
 		CPU_Cycles=0;
 		CPU_SkipCycleAutoAdjust=false;
+		CPU_IdlePolling = section->Get_bool("idle_polling");
 
 		Prop_multival* p = section->Get_multival("cycles");
 		std::string type = p->GetSection()->Get_string("type");
@@ -2328,6 +2407,8 @@ public:
 
 		CPU_CycleUp=section->Get_int("cycleup");
 		CPU_CycleDown=section->Get_int("cycledown");
+		CPU_CycleGovernor = (std::string(section->Get_string("cycle_governor")) == "pi");
+		cycle_governor.ResetWindow();
 		std::string core(section->Get_string("core"));
 		cpudecoder=&CPU_Core_Normal_Run;
 		if (core == "normal") {
@@ -2357,10 +2438,18 @@ public:
 #endif
 		}
 
+		const auto cache_size = static_cast<Bitu>(section->Get_int("dynamic_cache_size"));
+		const auto cache_pages = static_cast<Bitu>(section->Get_int("dynamic_cache_pages"));
 #if (C_DYNAMIC_X86)
+		CPU_Core_Dyn_X86_Cache_Configure(cache_size, cache_pages);
 		CPU_Core_Dyn_X86_Cache_Init((core == "dynamic") || (core == "dynamic_nodhfpu"));
 #elif (C_DYNREC)
+		CPU_Core_Dynrec_Cache_Configure(cache_size, cache_pages);
+		CPU_Core_Dynrec_Cache_Profile(section->Get_path("dynamic_cache_file")->realpath);
 		CPU_Core_Dynrec_Cache_Init( core == "dynamic" );
+#else
+		(void)cache_size;
+		(void)cache_pages;
 #endif
 
 		CPU_ArchitectureType = CPU_ARCHTYPE_MIXED;
@@ -2418,6 +2507,7 @@ public:
 static CPU * test;
 
 void CPU_ShutDown(Section* sec) {
+	CPU_LogIdleStats();
 #if (C_DYNAMIC_X86)
 	CPU_Core_Dyn_X86_Cache_Close();
 #elif (C_DYNREC)
@@ -0,0 +1,99 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "cycle_governor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Gains of the controller, on the log of the load. The measurement reflects
+// the cycles set at the end of the previous window, so the error evolves as
+// e' = (1 - kp - ki) * e + kp * e_prev, which settles with poles around
+// 0.62 and -0.32: within a handful of windows and without ringing.
+constexpr double kp = 0.2;
+constexpr double ki = 0.5;
+
+// The most the cycles can change in one window, either way
+constexpr double max_step = 0.6931471805599453; // ln(2)
+
+// Windows where less than this share of the cycles ran are skipped
+constexpr double min_busy_share = 0.05;
+
+// A window taking longer than this means the host stalled (suspended,
+// window dragged); its measurement says nothing about the emulator
+constexpr int64_t stall_us = 1000000;
+
+constexpr int32_t min_cycles = 200; // CPU_CYCLES_LOWER_LIMIT
+constexpr int32_t max_cycles = std::numeric_limits<int32_t>::max() / 2;
+
+void CycleGovernor::ResetWindow()
+{
+	window_start_us = -1;
+	window_slept_us = 0;
+	window_ticks = 0;
+}
+
+CycleGovernor::Outcome CycleGovernor::Update(int64_t now_us, int32_t &cycles,
+                                             int64_t idle_cycles,
+                                             int32_t percentage, int32_t limit)
+{
+	state.target = 0.9 * percentage / 100.0;
+	if (window_start_us < 0) {
+		ResetWindow();
+		window_start_us = now_us;
+		return Outcome::Restarted;
+	}
+	const int64_t elapsed_us = now_us - window_start_us;
+	if (elapsed_us < window_us || window_ticks == 0)
+		return Outcome::Measuring;
+
+	const int64_t busy_us = std::max<int64_t>(elapsed_us - window_slept_us, 0);
+	const double scheduled = static_cast<double>(std::max(cycles, min_cycles)) *
+	                         window_ticks;
+	const double busy_share = 1.0 - std::min(idle_cycles / scheduled, 1.0);
+	const uint32_t ticks = window_ticks;
+	ResetWindow();
+	window_start_us = now_us;
+
+	if (elapsed_us > stall_us || busy_share < min_busy_share)
+		return Outcome::Restarted;
+
+	// Projected to all the cycles running, and kept off zero so the log
+	// stays finite on a host too fast for the clock to notice
+	const double load = std::max(busy_us / (ticks * 1000.0) / busy_share, 1e-4);
+	state.load = load;
+	state.error = state.target - load;
+
+	const double error = std::log(state.target / load);
+	const double step = std::min(std::max(kp * (error - last_error) + ki * error,
+	                                      -max_step),
+	                             max_step);
+	last_error = error;
+
+	double next = std::max(cycles, min_cycles) * std::exp(step);
+	next = std::min(std::max(next, static_cast<double>(min_cycles)),
+	                static_cast<double>(max_cycles));
+	if (limit > 0)
+		next = std::min(next, static_cast<double>(limit));
+	cycles = static_cast<int32_t>(next);
+	state.cycles = cycles;
+	return Outcome::Adjusted;
+}
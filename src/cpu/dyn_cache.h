@@ -28,6 +28,14 @@
 
 class CodePageHandler;
 
+// Every time a block is entered, its code sets the hits of the block and of
+// its page to this value. Blocks reached through links are counted too, as
+// well as those started from the run loop. When space runs out the cache
+// sweeps them like a clock, halving the hits of anything that ran since the
+// last sweep and evicting the first one that didn't, so code that keeps
+// running survives a couple of sweeps.
+constexpr uint8_t CACHE_MAX_HITS = 3;
+
 // basic cache block representation
 class CacheBlock {
 public:
@@ -79,6 +87,8 @@ public:
 	} link[2];                // maximum two links (conditional jumps)
 
 	CacheBlock *crossblock;
+
+	uint32_t hits; // set on entry, halved by eviction sweeps
 };
 
 static struct {
@@ -100,8 +110,21 @@ static struct {
 	CodePageHandler *free_pages; // pointer to the free list
 	CodePageHandler *used_pages; // pointer to the list of used pages
 	CodePageHandler *last_page;  // the last used page
+
+	struct {
+		uint64_t translations;   // blocks translated
+		uint64_t evicted_blocks; // blocks overwritten to make room
+		uint64_t evicted_pages;  // code pages released to make room
+		uint64_t invalidations;  // blocks cleared by self-modifying code
+	} stats;
 } cache;
 
+// Cache dimensions; the defaults can be changed by cache_configure before
+// the cache is first initialized
+static Bitu cache_total = CACHE_TOTAL;   // bytes of translated code
+static Bitu cache_pages = CACHE_PAGES;   // code page handlers
+static Bitu cache_num_blocks = CACHE_BLOCKS;
+
 // cache memory pointers, to be malloc'd later
 static uint8_t *cache_code_start_ptr = nullptr;
 static uint8_t *cache_code = nullptr;
@@ -132,6 +155,9 @@ public:
 
 		active_blocks=0;
 		active_count=16;
+		hits = 0;
+		profile_key = 0;
+		profile_checked = false;
 
 		// initialize the maps with zero (no cache blocks as well as
 		// code present)
@@ -169,6 +195,7 @@ public:
 					block->Clear(); // clear the block,
 					                // decrements the
 					                // write_map accordingly
+					cache.stats.invalidations++;
 				}
 				block=nextblock;
 			}
@@ -457,6 +484,22 @@ public:
 		return 0; // none found
 	}
 
+	// the guest code of this page, as it is now
+	const uint8_t *GetCode()
+	{
+		return GetHostReadPt(phys_page);
+	}
+
+	// have the instruction at addr run by the normal core right away,
+	// as if it had already been modified too often
+	void MarkModified(Bitu addr)
+	{
+		if (!invalidation_map)
+			invalidation_map = alloc_invalidation_map();
+		if (invalidation_map[addr] < 4)
+			invalidation_map[addr] = 4;
+	}
+
 	HostPt GetHostReadPt(Bitu phys_page) override
 	{
 		hostmem = old_pagehandler->GetHostReadPt(phys_page);
@@ -477,6 +520,12 @@ public:
 	CodePageHandler *prev = nullptr;
 	CodePageHandler *next = nullptr;
 
+	uint32_t hits = 0; // set when one of its blocks is entered
+
+	// translation profile of the page's code when it first ran
+	uint64_t profile_key = 0;
+	bool profile_checked = false;
+
 private:
 	PageHandler *old_pagehandler = nullptr;
 
@@ -508,6 +557,42 @@ static CacheBlock *cache_getblock()
 	return ret;
 }
 
+// move a used code page to the back of the list
+static void cache_requeue_page(CodePageHandler *page)
+{
+	if (page == cache.last_page)
+		return;
+	if (page->prev) page->prev->next=page->next;
+	else cache.used_pages=page->next;
+	page->next->prev=page->prev;
+	page->prev=cache.last_page;
+	page->next=0;
+	cache.last_page->next=page;
+	cache.last_page=page;
+}
+
+// Picks the code page to release when all of them are in use. The used
+// pages are swept in list order; a page that ran code since the last sweep
+// has its hits halved and goes to the back, and the first cold page is
+// picked. Never picks 'keep' (the page being decoded), and returns nullptr
+// if there is no other page.
+static CodePageHandler *cache_pick_victim_page(const CodePageHandler *keep)
+{
+	// every page is cold once its hits have been halved to zero
+	Bitu budget = cache_pages * 3 + 1;
+	for (; budget && cache.used_pages; budget--) {
+		CodePageHandler *page = cache.used_pages;
+		if (page != keep && !page->hits)
+			return page;
+		if (page == keep && page == cache.last_page)
+			return nullptr;
+		page->hits >>= 1;
+		cache_requeue_page(page);
+	}
+	const auto first = cache.used_pages;
+	return (first == keep) ? (first ? first->next : nullptr) : first;
+}
+
 void CacheBlock::Clear()
 {
 	Bitu ind;
@@ -557,14 +642,46 @@ void CacheBlock::Clear()
 	}
 }
 
+// the block following this one in the cache memory, wrapping around to the
+// start once the end is reached
+static CacheBlock *cache_next_active(const CacheBlock *block)
+{
+#if (C_DYNAMIC_X86)
+	const bool cache_is_full = !block->cache.next;
+#elif (C_DYNREC)
+	const uint8_t *limit = (cache_code_start_ptr + cache_total - CACHE_MAXSIZE);
+	const bool cache_is_full = (!block->cache.next ||
+	                            (block->cache.next->cache.start > limit));
+#endif
+	if (cache_is_full) {
+		// DEBUG_LOG_MSG("Cache full; restarting");
+		return cache.block.first;
+	}
+	return block->cache.next;
+}
+
 static CacheBlock *cache_openblock()
 {
+	// skip over blocks that ran since the last sweep, up to a limit so
+	// a cache full of hot code still makes progress
+	constexpr int max_skipped = 64;
+	for (int i = 0; i < max_skipped; i++) {
+		CacheBlock *active = cache.block.active;
+		if (!active->page.handler || !active->hits)
+			break;
+		active->hits >>= 1;
+		cache.block.active = cache_next_active(active);
+	}
 	CacheBlock *block = cache.block.active;
+	cache.stats.translations++;
 	// check for enough space in this block
 	Bitu size=block->cache.size;
 	CacheBlock *nextblock = block->cache.next;
-	if (block->page.handler)
+	if (block->page.handler) {
 		block->Clear();
+		cache.stats.evicted_blocks++;
+	}
+	block->hits = 0;
 	// block size must be at least CACHE_MAXSIZE
 	while (size<CACHE_MAXSIZE) {
 		if (!nextblock)
@@ -572,8 +689,10 @@ static CacheBlock *cache_openblock()
 		// merge blocks
 		size+=nextblock->cache.size;
 		CacheBlock *tempblock = nextblock->cache.next;
-		if (nextblock->page.handler)
+		if (nextblock->page.handler) {
 			nextblock->Clear();
+			cache.stats.evicted_blocks++;
+		}
 		// block is free now
 		cache_add_unused_block(nextblock);
 		nextblock=tempblock;
@@ -623,19 +742,7 @@ static void cache_closeblock()
 		}
 	}
 	// advance the active block pointer
-#if (C_DYNAMIC_X86)
-	const bool cache_is_full = !block->cache.next;
-#elif (C_DYNREC)
-	const uint8_t *limit = (cache_code_start_ptr + CACHE_TOTAL - CACHE_MAXSIZE);
-	const bool cache_is_full = (!block->cache.next ||
-	                            (block->cache.next->cache.start > limit));
-#endif
-	if (cache_is_full) {
-		// DEBUG_LOG_MSG("Cache full; restarting");
-		cache.block.active=cache.block.first;
-	} else {
-		cache.block.active=block->cache.next;
-	}
+	cache.block.active = cache_next_active(block);
 }
 
 // TODO functions cache_addb, cache_addw, cache_addd, cache_addq definitely
@@ -718,6 +825,32 @@ static void cache_block_closing(const uint8_t *block_start, Bitu block_size);
 
 static bool cache_initialized = false;
 
+// Sets the cache size in MB and the number of code pages it can hold;
+// only has an effect before the cache memory is allocated
+static void cache_configure(Bitu size_mb, Bitu pages)
+{
+	if (cache_code_start_ptr || cache_blocks)
+		return;
+	cache_total = size_mb * 1024 * 1024;
+	cache_pages = pages;
+	// keep the default ratio of blocks to code memory
+	cache_num_blocks = CACHE_BLOCKS / (CACHE_TOTAL / (1024 * 1024)) * size_mb;
+}
+
+static void cache_log_stats(const char *core)
+{
+	if (!cache.stats.translations)
+		return;
+	LOG_MSG("%s: Code cache of %u MB and %u pages: %llu translations, "
+	        "%llu blocks and %llu pages evicted, %llu blocks invalidated",
+	        core, static_cast<unsigned>(cache_total / (1024 * 1024)),
+	        static_cast<unsigned>(cache_pages),
+	        static_cast<unsigned long long>(cache.stats.translations),
+	        static_cast<unsigned long long>(cache.stats.evicted_blocks),
+	        static_cast<unsigned long long>(cache.stats.evicted_pages),
+	        static_cast<unsigned long long>(cache.stats.invalidations));
+}
+
 static void cache_init(bool enable) {
 	Bits i;
 	if (enable) {
@@ -726,13 +859,13 @@ static void cache_init(bool enable) {
 		cache_initialized = true;
 		if (cache_blocks == NULL) {
 			// allocate the cache blocks memory
-			cache_blocks = (CacheBlock *)malloc(CACHE_BLOCKS * sizeof(CacheBlock));
+			cache_blocks = (CacheBlock *)malloc(cache_num_blocks * sizeof(CacheBlock));
 			if (!cache_blocks)
 				E_Exit("Allocating cache_blocks has failed");
-			memset(cache_blocks, 0, sizeof(CacheBlock) * CACHE_BLOCKS);
+			memset(cache_blocks, 0, sizeof(CacheBlock) * cache_num_blocks);
 			cache.block.free=&cache_blocks[0];
 			// initialize the cache blocks
-			for (i=0;i<CACHE_BLOCKS-1;i++) {
+			for (i=0;i<static_cast<Bits>(cache_num_blocks)-1;i++) {
 				cache_blocks[i].link[0].to = (CacheBlock *)1;
 				cache_blocks[i].link[1].to = (CacheBlock *)1;
 				cache_blocks[i].cache.next = &cache_blocks[i + 1];
@@ -741,12 +874,12 @@ static void cache_init(bool enable) {
 		if (cache_code_start_ptr==NULL) {
 			// allocate the code cache memory
 #if defined (WIN32)
-			cache_code_start_ptr=(Bit8u*)VirtualAlloc(0,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP,
+			cache_code_start_ptr=(Bit8u*)VirtualAlloc(0,cache_total+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP,
 				MEM_COMMIT,PAGE_EXECUTE_READWRITE);
 			if (!cache_code_start_ptr)
-				cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
+				cache_code_start_ptr=(Bit8u*)malloc(cache_total+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
 #else
-			cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
+			cache_code_start_ptr=(Bit8u*)malloc(cache_total+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
 #endif
 			if (!cache_code_start_ptr)
 				E_Exit("Allocating dynamic core cache memory failed");
@@ -763,14 +896,14 @@ static void cache_init(bool enable) {
 			cache_code=cache_code+PAGESIZE_TEMP;
 
 #if defined(HAVE_MPROTECT)
-			if(mprotect(cache_code_link_blocks,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP,PROT_WRITE|PROT_READ|PROT_EXEC))
+			if(mprotect(cache_code_link_blocks,cache_total+CACHE_MAXSIZE+PAGESIZE_TEMP,PROT_WRITE|PROT_READ|PROT_EXEC))
 				LOG_MSG("Setting execute permission on the code cache has failed");
 #endif
 			CacheBlock *block = cache_getblock();
 			cache.block.first=block;
 			cache.block.active=block;
 			block->cache.start=&cache_code[0];
-			block->cache.size=CACHE_TOTAL;
+			block->cache.size=cache_total;
 			block->cache.next = 0; // last block in the list
 		}
 		// setup the default blocks for block linkage returns
@@ -794,7 +927,7 @@ static void cache_init(bool enable) {
 		cache.last_page=0;
 		cache.used_pages=0;
 		// setup the code pages
-		for (i=0;i<CACHE_PAGES;i++) {
+		for (i=0;i<static_cast<Bits>(cache_pages);i++) {
 			CodePageHandler *newpage = new CodePageHandler();
 			newpage->next=cache.free_pages;
 			cache.free_pages=newpage;
@@ -675,6 +675,22 @@ void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 	}
 }
 
+void PAGING_UnlinkPhysPages(Bitu phys_page,Bitu pages) {
+	Bitu kept=0;
+	for (Bitu i=0;i<paging.links.used;i++) {
+		const Bitu page=paging.links.entries[i];
+		if (paging.tlb.phys_page[page]-phys_page<pages) {
+			paging.tlb.read[page]=0;
+			paging.tlb.write[page]=0;
+			paging.tlb.readhandler[page]=&init_page_handler;
+			paging.tlb.writehandler[page]=&init_page_handler;
+		} else {
+			paging.links.entries[kept++]=page;
+		}
+	}
+	paging.links.used=kept;
+}
+
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 	if (lin_page<LINK_START) {
 		paging.firstmb[lin_page]=phys_page;
@@ -778,6 +794,23 @@ void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 	}
 }
 
+void PAGING_UnlinkPhysPages(Bitu phys_page,Bitu pages) {
+	Bitu kept=0;
+	for (Bitu i=0;i<paging.links.used;i++) {
+		const Bitu page=paging.links.entries[i];
+		tlb_entry *entry = get_tlb_entry(page<<12);
+		if (entry->phys_page-phys_page<pages) {
+			entry->read=0;
+			entry->write=0;
+			entry->readhandler=&init_page_handler;
+			entry->writehandler=&init_page_handler;
+		} else {
+			paging.links.entries[kept++]=page;
+		}
+	}
+	paging.links.used=kept;
+}
+
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 	if (lin_page<LINK_START) {
 		paging.firstmb[lin_page]=phys_page;
@@ -0,0 +1,154 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "translation_profile.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#define XXH_INLINE_ALL
+#include "../libs/decoders/xxhash.h"
+#include "../libs/decoders/archive.h"
+
+// Bump this when the layout of the file or the meaning of its offsets changes
+#define TRANSLATION_PROFILE_IDENTIFIER "tp-v1"
+
+constexpr size_t page_size = 4096;
+
+uint64_t TranslationProfile::PageKey(const uint8_t *page, bool code_big)
+{
+	return XXH64(page, page_size, code_big ? 32 : 16);
+}
+
+constexpr size_t TranslationProfile::max_pages;
+
+const TranslationProfile::Page *TranslationProfile::Find(uint64_t key)
+{
+	const auto it = pages.find(key);
+	if (it == pages.end())
+		return nullptr;
+	it->second.used = true;
+	return &it->second;
+}
+
+TranslationProfile::Page *TranslationProfile::Use(uint64_t key)
+{
+	auto it = pages.find(key);
+	if (it == pages.end()) {
+		if (pages.size() >= max_pages && !DropUnused())
+			return nullptr;
+		it = pages.emplace(key, Page()).first;
+	}
+	it->second.used = true;
+	return &it->second;
+}
+
+bool TranslationProfile::DropUnused()
+{
+	const size_t count = pages.size();
+	for (auto it = pages.begin(); it != pages.end();) {
+		if (it->second.used)
+			++it;
+		else
+			it = pages.erase(it);
+	}
+	if (pages.size() == count)
+		return false;
+	dirty = true;
+	return true;
+}
+
+void TranslationProfile::AddEntry(uint64_t key, uint16_t offset)
+{
+	Page *page = Use(key);
+	if (page && page->entries.insert(offset).second)
+		dirty = true;
+}
+
+void TranslationProfile::AddModified(uint64_t key, uint16_t offset)
+{
+	Page *page = Use(key);
+	if (page && page->modified.insert(offset).second)
+		dirty = true;
+}
+
+void TranslationProfile::Clear()
+{
+	pages.clear();
+	dirty = false;
+}
+
+bool TranslationProfile::Load(const std::string &filename,
+                              const std::string &host_signature)
+{
+	Clear();
+	std::ifstream infile(filename, std::ios_base::binary);
+	if (!infile.is_open())
+		return false;
+
+	std::map<uint64_t, Page> loaded;
+	try {
+		Archive<std::ifstream> deserialize(infile);
+
+		// Bail if the file was written in a different format, or by a
+		// different backend or version of the core
+		std::string identifier, signature;
+		deserialize >> identifier;
+		if (identifier != TRANSLATION_PROFILE_IDENTIFIER)
+			return false;
+		deserialize >> signature;
+		if (signature != host_signature)
+			return false;
+
+		deserialize >> loaded;
+	} catch (const std::runtime_error &) {
+		return false; // truncated or otherwise malformed
+	}
+
+	// Offsets have to lie within the page
+	for (const auto &page : loaded) {
+		const auto &p = page.second;
+		if ((!p.entries.empty() && *p.entries.rbegin() >= page_size) ||
+		    (!p.modified.empty() && *p.modified.rbegin() >= page_size))
+			return false;
+	}
+	pages.swap(loaded);
+	return true;
+}
+
+bool TranslationProfile::Save(const std::string &filename,
+                              const std::string &host_signature)
+{
+	DropUnused();
+	std::ofstream outfile(filename, std::ios_base::trunc | std::ios_base::binary);
+	if (!outfile.is_open())
+		return false;
+
+	// Written as a string; a bare literal would be stored with its
+	// terminating null and never match on load
+	const std::string identifier = TRANSLATION_PROFILE_IDENTIFIER;
+	Archive<std::ofstream> serialize(outfile);
+	serialize << identifier << host_signature << pages;
+	outfile.close();
+	if (outfile.fail())
+		return false;
+	dirty = false;
+	return true;
+}
@@ -24,13 +24,17 @@
 
 #include "dosbox.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <SDL.h>
@@ -39,6 +43,7 @@
 #include "support.h"
 #include "mem.h"
 #include "mixer.h"
+#include "spsc_ring.h"
 #include "../libs/decoders/SDL_sound.h"
 
 // CDROM data and audio format constants
@@ -61,6 +66,10 @@
 #define MAX_REDBOOK_BYTES (MAX_REDBOOK_FRAMES * BYTES_PER_RAW_REDBOOK_FRAME) // length of a CDROM in bytes
 #define MAX_REDBOOK_DURATION_MS (99 * 60 * 1000) // 99 minute CDROM in milliseconds
 
+// CD audio playback decodes ahead of the mixer in chunks of this many frames
+#define CDDA_DECODE_CHUNK_FRAMES       1024u
+#define CDDA_DECODE_AHEAD_CHUNKS         16u // about 370 ms of 44.1 kHz audio
+
 
 struct TMSF
 {
@@ -160,6 +169,10 @@ private:
 		virtual int      getLength() = 0;
 		virtual void setAudioPosition(uint32_t pos) = 0;
 		const Bit16u chunkSize = 0;
+
+		// Held around reads, seeks, and decodes because CD audio is
+		// decoded on its own thread while data sectors are read
+		std::mutex streamMutex = {};
 	};
 
 	class BinaryFile final : public TrackFile {
@@ -183,7 +196,10 @@ private:
 		void setAudioPosition(uint32_t pos) { audio_pos = pos; }
 
 	private:
-		std::ifstream   *file;
+		std::ifstream        *file;
+		std::vector<uint8_t> readahead        = {}; // window of file data
+		uint32_t             readahead_offset = 0;  // file offset of the window
+		uint32_t             readahead_bytes  = 0;  // valid bytes in the window
 	};
 
 	class AudioFile final : public TrackFile {
@@ -258,9 +274,27 @@ private:
 		uint32_t                 totalTrackFrames   = 0;
 		uint32_t                 startSector        = 0;
 		uint32_t                 totalRedbookFrames = 0;
-		int16_t                  buffer[MIXER_BUFSIZE * REDBOOK_CHANNELS] = {0};
 		bool                     isPlaying          = false;
 		bool                     isPaused           = false;
+
+		// Decode-ahead: the decoder thread fills the ring with chunks of
+		// PCM samples (an empty chunk marks the end of the track), which
+		// the mixer callback copies out. The request fields are guarded
+		// by decodeMutex and hand the decoder a new position to play.
+		SPSCRing<std::vector<int16_t>> decoded = {
+		        CDDA_DECODE_AHEAD_CHUNKS,
+		        std::vector<int16_t>(CDDA_DECODE_CHUNK_FRAMES * REDBOOK_CHANNELS)};
+		std::thread                decoder          = {};
+		std::mutex                 decodeMutex      = {};
+		std::condition_variable    decodeRequested  = {};
+		std::shared_ptr<TrackFile> requestFile      = {};
+		std::vector<int16_t>       *playChunk       = nullptr;
+		size_t                     playChunkPos     = 0;
+		uint32_t                   requestOffset    = 0;
+		bool                       hasRequest       = false;
+		bool                       stopDecoder      = false;
+		bool                       isDecoding       = false; // until the end chunk is played
+		std::atomic_bool           decodeFailed     = {false};
 	} player;
 
 	// Private utility functions
@@ -269,7 +303,15 @@ private:
 	                 const uint16_t sectorSize,
 	                 const bool mode2);
 	std::vector<Track>::iterator GetTrack(const uint32_t sector);
+	uint32_t ReadTrackSectors(uint8_t *buffer,
+	                          const bool raw,
+	                          const uint32_t sector,
+	                          const uint32_t num);
 	static void CDAudioCallBack (Bitu desired_frames);
+	static void DecodeAhead();
+	static void RequestDecode(std::shared_ptr<TrackFile> track_file,
+	                          const uint32_t byte_offset);
+	static void StopDecoder();
 
 	// Private functions for cue sheet processing
 	bool  LoadCueSheet(char *cuefile);
@@ -285,6 +327,7 @@ private:
 	// member variables
 	std::vector<Track>   tracks;
 	std::vector<uint8_t> readBuffer;
+	std::vector<uint8_t> sectorBuffer;
 	std::string          mcn;
 	static int           refCount;
 };
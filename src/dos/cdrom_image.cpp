@@ -23,11 +23,13 @@
 
 #include "cdrom.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -37,8 +39,6 @@
 
 #if !defined(WIN32)
 #include <libgen.h>
-#else
-#include <cstring>
 #endif
 
 #include "drives.h"
@@ -58,6 +58,13 @@ using track_iter       = vector<CDROM_Interface_Image::Track>::iterator;
 using track_const_iter = vector<CDROM_Interface_Image::Track>::const_iterator;
 using tracks_size_t    = vector<CDROM_Interface_Image::Track>::size_type;
 
+// Bytes of read-ahead kept per binary track file, set from the configuration
+static uint32_t readahead_size = 64 * 1024;
+
+// Upper limit on the sectors gathered per read when the track's sector size
+// differs from the requested size, which bounds the scratch buffer's size
+constexpr uint32_t MAX_STRIDED_SECTORS = 32;
+
 // Report bad seeks that would go beyond the end of the track
 bool CDROM_Interface_Image::TrackFile::offsetInsideTrack(const uint32_t offset)
 {
@@ -127,12 +134,34 @@ bool CDROM_Interface_Image::BinaryFile::read(uint8_t *buffer,
 	if (adjusted_bytes == 0) // no work to do!
 		return true;
 
-	// Reposition if needed
-	if (!seek(offset))
-		return false;
+	// Large reads (or a disabled read-ahead) go straight to the file
+	if (adjusted_bytes >= readahead_size) {
+		if (!seek(offset))
+			return false;
+		file->read((char *)buffer, adjusted_bytes);
+		return !file->fail();
+	}
 
-	file->read((char *)buffer, adjusted_bytes);
-	return !file->fail();
+	// Refill the read-ahead window if the request isn't entirely inside it
+	if (offset < readahead_offset ||
+	    offset + adjusted_bytes > readahead_offset + readahead_bytes) {
+		if (readahead.size() != readahead_size)
+			readahead.resize(readahead_size);
+		readahead_bytes = 0;
+		if (!seek(offset))
+			return false;
+
+		// adjustOverRead confirmed the file reaches past offset
+		const uint32_t fill_bytes = std::min(readahead_size,
+		        static_cast<uint32_t>(getLength()) - offset);
+		file->read((char *)readahead.data(), fill_bytes);
+		if (file->fail())
+			return false;
+		readahead_offset = offset;
+		readahead_bytes = fill_bytes;
+	}
+	memcpy(buffer, readahead.data() + (offset - readahead_offset), adjusted_bytes);
+	return true;
 }
 
 int CDROM_Interface_Image::BinaryFile::getLength()
@@ -484,6 +513,7 @@ CDROM_Interface_Image::imagePlayer CDROM_Interface_Image::player;
 CDROM_Interface_Image::CDROM_Interface_Image(uint8_t sub_unit)
         : tracks{},
           readBuffer{},
+          sectorBuffer{},
           mcn("")
 {
 	images[sub_unit] = this;
@@ -515,6 +545,8 @@ CDROM_Interface_Image::~CDROM_Interface_Image()
 		LOG_MSG("CDROM: Released CD Player resources");
 #endif
 	}
+	if (refCount == 0)
+		StopDecoder();
 	if (player.cd == this) {
 		player.cd = nullptr;
 	}
@@ -726,17 +758,20 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 	const auto sector_offset = start - track->start;
 	const auto byte_offset = track->skip + sector_offset * track->sectorSize;
 
-	// Guard: Bail if our track could not be seeked
-	if (!track_file->seek(byte_offset)) {
+	// Guard: Bail if the offset lies beyond the track. The seek itself
+	// happens on the decoder thread.
+	bool is_inside_track = false;
+	{
+		std::lock_guard<std::mutex> lock(track_file->streamMutex);
+		is_inside_track = static_cast<int>(byte_offset) < track_file->getLength();
+	}
+	if (!is_inside_track) {
 		LOG_MSG("CDROM: Track %d failed to seek to byte %u, so cancelling playback",
 		        track->number, byte_offset);
 		StopAudio();
 		return false;
 	}
 
-	// We're performing an audio-task, so update the audio position
-	track_file->setAudioPosition(byte_offset);
-
 	// Get properties about the current track
 	const uint8_t track_channels = track_file->getChannels();
 	const uint32_t track_rate = track_file->getRate();
@@ -779,6 +814,9 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 	player.totalTrackFrames = player.totalRedbookFrames *
 	                          (track_rate / REDBOOK_FRAMES_PER_SECOND);
 
+	// Hand the new position to the decoder, dropping what it decoded ahead
+	RequestDecode(track_file, byte_offset);
+
 #ifdef DEBUG
 	if (start < track->start) {
 		LOG_MSG("CDROM: Play sector %u to %u in the pregap of track %d [pregap %d,"
@@ -889,14 +927,19 @@ bool CDROM_Interface_Image::ReadSectors(PhysPt buffer,
 	uint32_t current_sector = sector;
 	uint8_t* buffer_position = readBuffer.data();
 
-	// Read until we have enough or fail
+	// Read until we have enough or fail, taking as many sectors as the
+	// current track provides per pass
 	while (bytes_read < requested_bytes) {
-		success = ReadSector(buffer_position, raw, current_sector);
-		if (!success)
+		const uint32_t remaining = (requested_bytes - bytes_read) / sectorSize;
+		const uint32_t sectors_read = ReadTrackSectors(buffer_position, raw,
+		                                               current_sector, remaining);
+		if (sectors_read == 0) {
+			success = false;
 			break;
-		current_sector++;
-		bytes_read += sectorSize;
-		buffer_position += sectorSize;
+		}
+		current_sector += sectors_read;
+		bytes_read += sectors_read * sectorSize;
+		buffer_position += sectors_read * sectorSize;
 	}
 	// Write only the successfully read bytes
 	MEM_BlockWrite(buffer, readBuffer.data(), bytes_read);
@@ -927,20 +970,17 @@ track_iter CDROM_Interface_Image::GetTrack(const uint32_t sector)
 	}
 
 	/**
-	 *  Walk the tracks checking if the desired sector falls inside of a given
-	 *  track's range, which starts at the end of the prior track and goes to
-	 *  the current track's (start + length).
+	 *  A track's range starts at the end of the prior track and goes to the
+	 *  current track's (start + length), so the tracks are ordered by their
+	 *  ends. Binary search for the first track ending beyond the sector; only
+	 *  the first track has a lower bound (its start) that needs checking.
 	 */
-	track_iter track = tracks.begin();
-	uint32_t lower_bound = track->start;
-	while (track != tracks.end()) {
-		const uint32_t upper_bound = track->start + track->length;
-		if (lower_bound <= sector && sector < upper_bound) {
-			break;
-		}
-		++track;
-		lower_bound = upper_bound;
-	}
+	track_iter track = upper_bound(tracks.begin(), tracks.end(), sector,
+	                               [](const uint32_t s, const Track &t) {
+		                               return s < t.start + t.length;
+	                               });
+	if (track == tracks.begin() && sector < track->start)
+		track = tracks.end();
 #ifdef DEBUG
 	if (track != tracks.end() && track->number != 1) {
 		if (sector < track->start) {
@@ -964,6 +1004,16 @@ track_iter CDROM_Interface_Image::GetTrack(const uint32_t sector)
 }
 
 bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const uint32_t sector)
+{
+	return ReadTrackSectors(buffer, raw, sector, 1) == 1;
+}
+
+// Reads up to num consecutive sectors, stopping at the end of the track that
+// holds the first one. Returns the number of sectors read, or zero on failure.
+uint32_t CDROM_Interface_Image::ReadTrackSectors(uint8_t *buffer,
+                                                 const bool raw,
+                                                 const uint32_t sector,
+                                                 const uint32_t num)
 {
 	track_const_iter track = GetTrack(sector);
 
@@ -974,12 +1024,12 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 		        "in an invalid track or track->file",
 		        sector);
 #endif
-		return false;
+		return 0;
 	}
 	uint32_t offset = track->skip + (sector - track->start) * track->sectorSize;
 	const uint16_t length = (raw ? BYTES_PER_RAW_REDBOOK_FRAME : BYTES_PER_COOKED_REDBOOK_FRAME);
 	if (track->sectorSize != BYTES_PER_RAW_REDBOOK_FRAME && raw) {
-		return false;
+		return 0;
 	}
 	if (track->sectorSize == BYTES_PER_RAW_REDBOOK_FRAME && !track->mode2 && !raw)
 		offset += 16;
@@ -995,7 +1045,26 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 	        length);
 #endif
 #endif
-	return track->file->read(buffer, offset, length);
+	// The track's sectors are consecutive in its file, so take as many as
+	// were asked for in one read
+	uint32_t count = std::min(num, track->start + track->length - sector);
+	if (count == 0)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(track->file->streamMutex);
+	if (track->sectorSize == length)
+		return track->file->read(buffer, offset, count * length) ? count : 0;
+
+	// Otherwise read the span holding the sectors and gather their payloads
+	count = std::min(count, MAX_STRIDED_SECTORS);
+	const uint32_t span_bytes = (count - 1) * track->sectorSize + length;
+	if (sectorBuffer.size() < span_bytes)
+		sectorBuffer.resize(span_bytes);
+	if (!track->file->read(sectorBuffer.data(), offset, span_bytes))
+		return 0;
+	for (uint32_t i = 0; i < count; ++i)
+		memcpy(buffer + i * length, sectorBuffer.data() + i * track->sectorSize, length);
+	return count;
 }
 
 
@@ -1035,15 +1104,42 @@ void CDROM_Interface_Image::CDAudioCallBack(Bitu desired_track_frames)
 		return;
 	}
 
-	const uint32_t decoded_track_frames = track_file->decode(player.buffer,
-	                                                         static_cast<uint32_t>(desired_track_frames));
-	player.playedTrackFrames += decoded_track_frames;
-
 	/**
-	 *  Uses either the stereo or mono and native or nonnative
-	 *  AddSamples call assigned during construction
+	 *  Copy out the frames the decoder thread has prepared ahead of us,
+	 *  using either the stereo or mono and native or nonnative AddSamples
+	 *  call assigned during construction. We only wait on the decoder
+	 *  when it has fallen behind, such as right after a seek.
 	 */
-	(player.channel->*player.addFrames)(decoded_track_frames, player.buffer);
+	const uint8_t channels = track_file->getChannels();
+	uint32_t decoded_track_frames = 0;
+	bool has_track_ended = !player.isDecoding;
+	while (!has_track_ended && decoded_track_frames < desired_track_frames) {
+		if (!player.playChunk) {
+			player.playChunk = player.decoded.AcquireRead();
+			player.playChunkPos = 0;
+			if (!player.playChunk)
+				break;
+		}
+		const std::vector<int16_t> &chunk = *player.playChunk;
+		if (chunk.empty()) {
+			has_track_ended = true;
+			player.isDecoding = false;
+		} else {
+			const uint32_t chunk_frames = static_cast<uint32_t>(
+			        (chunk.size() - player.playChunkPos) / channels);
+			const uint32_t frames = std::min(chunk_frames,
+			        static_cast<uint32_t>(desired_track_frames) - decoded_track_frames);
+			(player.channel->*player.addFrames)(frames,
+			                                    chunk.data() + player.playChunkPos);
+			player.playChunkPos += frames * channels;
+			decoded_track_frames += frames;
+			if (player.playChunkPos < chunk.size())
+				continue;
+		}
+		player.decoded.ReleaseRead();
+		player.playChunk = nullptr;
+	}
+	player.playedTrackFrames += decoded_track_frames;
 
 	if (player.playedTrackFrames >= player.totalTrackFrames) {
 #ifdef DEBUG
@@ -1053,6 +1149,10 @@ void CDROM_Interface_Image::CDAudioCallBack(Bitu desired_track_frames)
 #endif
 		player.cd->StopAudio();
 
+	} else if (decoded_track_frames == 0 && player.decodeFailed) {
+		// The decoder couldn't position the track, so give up like a seek
+		player.cd->StopAudio();
+
 	} else if (decoded_track_frames == 0) {
 		// Our track has run dry but we still have more music left to play!
 		const double percent_played = static_cast<double>(
@@ -1077,6 +1177,125 @@ void CDROM_Interface_Image::CDAudioCallBack(Bitu desired_track_frames)
 	}
 }
 
+/**
+ *  Runs on the decoder thread. Waits for PlayAudioSector to request a
+ *  position, then decodes the track from there into the ring until the track
+ *  ends or a newer request supersedes it. Chunks decoded for a superseded
+ *  request are never committed, so the callback only ever sees audio from
+ *  the latest position.
+ */
+void CDROM_Interface_Image::DecodeAhead()
+{
+	std::unique_lock<std::mutex> lock(player.decodeMutex);
+	while (true) {
+		player.decodeRequested.wait(lock, [] {
+			return player.hasRequest || player.stopDecoder;
+		});
+		if (player.stopDecoder)
+			break;
+		std::shared_ptr<TrackFile> track_file = std::move(player.requestFile);
+		const uint32_t offset = player.requestOffset;
+		player.hasRequest = false;
+		lock.unlock();
+
+		const uint8_t channels = track_file->getChannels();
+		bool is_positioned = false;
+		{
+			std::lock_guard<std::mutex> stream_lock(track_file->streamMutex);
+			is_positioned = track_file->seek(offset);
+			if (is_positioned)
+				track_file->setAudioPosition(offset);
+		}
+		if (!is_positioned)
+			LOG_MSG("CDROM: Failed to seek to byte %u, so cancelling playback",
+			        offset);
+
+		bool is_superseded = false;
+		while (!is_superseded) {
+			std::vector<int16_t> *chunk = player.decoded.AcquireWrite();
+			if (!chunk)
+				break; // the ring was stopped
+
+			lock.lock();
+			is_superseded = player.hasRequest || player.stopDecoder;
+			lock.unlock();
+			if (is_superseded)
+				break;
+
+			uint32_t frames = 0;
+			if (is_positioned) {
+				chunk->resize(CDDA_DECODE_CHUNK_FRAMES * REDBOOK_CHANNELS);
+				std::lock_guard<std::mutex> stream_lock(track_file->streamMutex);
+				frames = track_file->decode(chunk->data(),
+				                            CDDA_DECODE_CHUNK_FRAMES);
+			}
+			// An empty chunk tells the callback the track has ended
+			chunk->resize(frames * channels);
+
+			lock.lock();
+			is_superseded = player.hasRequest || player.stopDecoder;
+			if (!is_superseded) {
+				player.decodeFailed = !is_positioned;
+				player.decoded.CommitWrite();
+			}
+			lock.unlock();
+			if (frames == 0)
+				break;
+		}
+		track_file.reset();
+		lock.lock();
+	}
+}
+
+// Points the decoder at a new position and drops the chunks it had decoded
+// ahead. Runs on the callback's side of the ring, with the player locked.
+void CDROM_Interface_Image::RequestDecode(std::shared_ptr<TrackFile> track_file,
+                                          const uint32_t byte_offset)
+{
+	if (!player.decoder.joinable()) {
+		player.decoder = std::thread(DecodeAhead);
+		set_thread_name(player.decoder, "dosbox:cdaudio");
+	}
+	{
+		// The decoder only commits while holding this lock and never
+		// once a request is pending, so the ring can be emptied of
+		// the prior position's chunks before it picks the request up
+		std::lock_guard<std::mutex> lock(player.decodeMutex);
+		player.requestFile = std::move(track_file);
+		player.requestOffset = byte_offset;
+		player.hasRequest = true;
+
+		if (player.playChunk) {
+			player.decoded.ReleaseRead();
+			player.playChunk = nullptr;
+		}
+		while (player.decoded.AcquireRead(false))
+			player.decoded.ReleaseRead();
+	}
+	player.isDecoding = true;
+	player.decodeRequested.notify_one();
+}
+
+void CDROM_Interface_Image::StopDecoder()
+{
+	if (!player.decoder.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(player.decodeMutex);
+		player.stopDecoder = true;
+	}
+	player.decodeRequested.notify_one();
+	player.decoded.Stop();
+	player.decoder.join();
+
+	player.decoded.Reset();
+	player.playChunk = nullptr;
+	player.requestFile.reset();
+	player.hasRequest = false;
+	player.stopDecoder = false;
+	player.isDecoding = false;
+}
+
 bool CDROM_Interface_Image::LoadIsoFile(char* filename)
 {
 	tracks.clear();
@@ -1477,6 +1696,8 @@ void CDROM_Image_Destroy(Section*) {
 void CDROM_Image_Init(Section* sec) {
 	if (sec != nullptr) {
 		sec->AddDestroyFunction(CDROM_Image_Destroy, false);
+		const auto section = static_cast<Section_prop *>(sec);
+		readahead_size = static_cast<uint32_t>(section->Get_int("cdrom_readahead")) * 1024;
 	}
 	Sound_Init();
 }
@@ -691,8 +691,7 @@ static Bitu DOS_21Handler(void) {
 		{ 
 			Bit16u toread=DOS_GetAmount();
 			dos.echo=true;
-			if (DOS_ReadFile(reg_bx,dos_copybuf,&toread)) {
-				MEM_BlockWrite(SegPhys(ds)+reg_dx,dos_copybuf,toread);
+			if (DOS_ReadFileToMem(reg_bx,SegPhys(ds)+reg_dx,&toread)) {
 				reg_ax=toread;
 				CALLBACK_SCF(false);
 			} else {
@@ -706,8 +705,7 @@ static Bitu DOS_21Handler(void) {
 	case 0x40:					/* WRITE Write to file or device */
 		{
 			Bit16u towrite=DOS_GetAmount();
-			MEM_BlockRead(SegPhys(ds)+reg_dx,dos_copybuf,towrite);
-			if (DOS_WriteFile(reg_bx,dos_copybuf,&towrite)) {
+			if (DOS_WriteFileFromMem(reg_bx,SegPhys(ds)+reg_dx,&towrite)) {
 				reg_ax=towrite;
 	   			CALLBACK_SCF(false);
 			} else {
@@ -1224,6 +1222,14 @@ static Bitu DOS_27Handler(void) {
 	return CBRET_NONE;
 }
 
+static CPU_IdlePoller idle_poller;
+
+static Bitu DOS_28Handler(void) {
+	// DOS idle interrupt, called by programs when they have nothing to do
+	if (CPU_IdlePoll(idle_poller)) CPU_Idle();
+	return CBRET_NONE;
+}
+
 static Bitu DOS_25Handler(void) {
 	if (reg_al >= DOS_DRIVES || !Drives[reg_al] || Drives[reg_al]->isRemovable()) {
 		reg_ax = 0x8002;
@@ -1323,7 +1329,7 @@ public:
 		callback[4].Install(DOS_27Handler,CB_IRET,"DOS Int 27");
 		callback[4].Set_RealVec(0x27);
 
-		callback[5].Install(NULL,CB_IRET,"DOS Int 28");
+		callback[5].Install(DOS_28Handler,CB_IRET,"DOS Int 28");
 		callback[5].Set_RealVec(0x28);
 
 		callback[6].Install(NULL,CB_INT29,"CON Output Int 29");
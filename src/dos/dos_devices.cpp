@@ -106,6 +106,36 @@ DOS_File & DOS_File::operator= (const DOS_File & orig) {
 	return *this;
 }
 
+bool DOS_File::ReadSpans(const DOS_IoSpan *spans, Bitu count, Bit16u *size)
+{
+	Bit16u total = 0;
+	for (Bitu i = 0; i < count; i++) {
+		Bit16u amount = spans[i].size;
+		if (!Read(spans[i].data, &amount))
+			return false;
+		total += amount;
+		if (amount != spans[i].size)
+			break;
+	}
+	*size = total;
+	return true;
+}
+
+bool DOS_File::WriteSpans(const DOS_IoSpan *spans, Bitu count, Bit16u *size)
+{
+	Bit16u total = 0;
+	for (Bitu i = 0; i < count; i++) {
+		Bit16u amount = spans[i].size;
+		if (!Write(spans[i].data, &amount))
+			return false;
+		total += amount;
+		if (amount != spans[i].size)
+			break;
+	}
+	*size = total;
+	return true;
+}
+
 Bit8u DOS_FindDevice(char const * name) {
 	/* should only check for the names before the dot and spacepadded */
 	char fullname[DOS_PATHLENGTH];Bit8u drive;
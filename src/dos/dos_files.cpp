@@ -18,6 +18,7 @@
 
 #include "dos_inc.h"
 
+#include <algorithm>
 #include <climits>
 #include <ctype.h>
 #include <stdlib.h>
@@ -27,6 +28,7 @@
 #include "dosbox.h"
 #include "bios.h"
 #include "mem.h"
+#include "paging.h"
 #include "regs.h"
 #include "drives.h"
 #include "cross.h"
@@ -427,6 +429,71 @@ bool DOS_WriteFile(Bit16u entry,Bit8u * data,Bit16u * amount,bool fcb) {
 	return ret;
 }
 
+/* A 64 KiB transfer touches at most 17 pages, and page runs are merged */
+#define DOS_MAX_TRANSFER_RUNS (0x10000 / MEM_PAGE_SIZE + 2)
+
+/* Files other than devices are handed the guest memory itself, so their
+ * data lands in (or comes from) it without a copy. Only runs that need the
+ * page handlers, such as VGA memory or code pages watched by the dynamic
+ * cores, bounce through dos_copybuf. Devices always bounce, as reading or
+ * writing them can run guest code that remaps the pages. */
+static bool use_memory_spans(Bit16u entry) {
+	Bit32u handle = RealHandle(entry);
+	return handle < DOS_FILES && Files[handle] && Files[handle]->IsOpen() &&
+	       !dynamic_cast<DOS_Device *>(Files[handle]);
+}
+
+static Bitu build_transfer_spans(PhysPt pt, Bit16u amount, bool for_write,
+                                 MemHostRun *runs, DOS_IoSpan *spans) {
+	const Bitu count = MEM_GetHostRuns(pt, amount, for_write, runs);
+	Bitu offset = 0;
+	for (Bitu i = 0; i < count; i++) {
+		spans[i].data = runs[i].host ? runs[i].host : dos_copybuf + offset;
+		spans[i].size = static_cast<Bit16u>(runs[i].size);
+		offset += runs[i].size;
+	}
+	return count;
+}
+
+bool DOS_ReadFileToMem(Bit16u entry, PhysPt pt, Bit16u *amount) {
+	if (!use_memory_spans(entry)) {
+		if (!DOS_ReadFile(entry, dos_copybuf, amount)) return false;
+		MEM_BlockWrite(pt, dos_copybuf, *amount);
+		return true;
+	}
+	MemHostRun runs[DOS_MAX_TRANSFER_RUNS];
+	DOS_IoSpan spans[DOS_MAX_TRANSFER_RUNS];
+	const Bitu count = build_transfer_spans(pt, *amount, true, runs, spans);
+	Bit16u done = *amount;
+	if (!Files[RealHandle(entry)]->ReadSpans(spans, count, &done)) return false;
+
+	// Hand the bounced part of what was read to the page handlers
+	Bitu offset = 0;
+	for (Bitu i = 0; i < count && offset < done; i++) {
+		if (!runs[i].host)
+			MEM_BlockWrite(runs[i].pt, dos_copybuf + offset,
+			               std::min<Bitu>(runs[i].size, done - offset));
+		offset += runs[i].size;
+	}
+	*amount = done;
+	return true;
+}
+
+bool DOS_WriteFileFromMem(Bit16u entry, PhysPt pt, Bit16u *amount) {
+	if (!use_memory_spans(entry) || *amount == 0) {
+		MEM_BlockRead(pt, dos_copybuf, *amount);
+		return DOS_WriteFile(entry, dos_copybuf, amount);
+	}
+	MemHostRun runs[DOS_MAX_TRANSFER_RUNS];
+	DOS_IoSpan spans[DOS_MAX_TRANSFER_RUNS];
+	const Bitu count = build_transfer_spans(pt, *amount, false, runs, spans);
+	for (Bitu i = 0; i < count; i++) {
+		if (!runs[i].host)
+			MEM_BlockRead(runs[i].pt, spans[i].data, runs[i].size);
+	}
+	return Files[RealHandle(entry)]->WriteSpans(spans, count, amount);
+}
+
 bool DOS_SeekFile(Bit16u entry,Bit32u * pos,Bit32u type,bool fcb) {
 	Bit32u handle = fcb?entry:RealHandle(entry);
 	if (handle>=DOS_FILES) {
@@ -18,6 +18,7 @@
 
 #include "drives.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -129,6 +130,7 @@ bool fatFile::Read(Bit8u * data, Bit16u *size) {
 		loadedSector = true;
 	}
 
+	const Bit32u sectorSize = myDrive->getSectorSize();
 	sizedec = *size;
 	sizecount = 0;
 	while(sizedec != 0) {
@@ -136,6 +138,28 @@ bool fatFile::Read(Bit8u * data, Bit16u *size) {
 			*size = sizecount;
 			return true; 
 		}
+		/* Whole sectors still wanted past the loaded one are read straight
+		 * into the caller's buffer, one run of adjacent sectors at a time */
+		if (curSectOff == 0 && sizedec > sectorSize &&
+		    filelength - seekpos > sectorSize) {
+			const Bit32u wanted = std::min<Bit32u>(sizedec, filelength - seekpos) / sectorSize;
+			Bit32u run = 1;
+			while (run < wanted &&
+			       myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos + run * sectorSize) == currentSector + run)
+				++run;
+			if (run > 1) {
+				const Bit32u bytes = run * sectorSize;
+				memcpy(data + sizecount, sectorBuffer, sectorSize);
+				myDrive->readSectors(currentSector + 1, run - 1, data + sizecount + sectorSize);
+				/* Keep the last sector of the run loaded, as if read byte by byte */
+				currentSector += run - 1;
+				memcpy(sectorBuffer, data + sizecount + bytes - sectorSize, sectorSize);
+				sizecount += bytes - 1;
+				sizedec -= bytes - 1;
+				seekpos += bytes - 1;
+				curSectOff = sectorSize - 1;
+			}
+		}
 		data[sizecount++] = sectorBuffer[curSectOff++];
 		seekpos++;
 		if(curSectOff >= myDrive->getSectorSize()) {
@@ -354,6 +378,9 @@ void fatDrive::setClusterValue(Bit32u clustNum, Bit32u clustValue) {
 	Bit32u fatsectnum;
 	Bit32u fatentoff;
 
+	/* Any chain passing through this cluster may change */
+	clusterChains.clear();
+
 	switch(fattype) {
 		case FAT12:
 			fatoffset = clustNum + (clustNum / 2);
@@ -530,6 +557,24 @@ Bit8u fatDrive::readSector(Bit32u sectnum, void * data) {
 	return loadedDisk->Read_Sector(head, cylinder, sector, data);
 }
 
+Bit8u fatDrive::readSectors(Bit32u sectnum, Bit32u count, void *data) {
+	// Guard
+	if (!loadedDisk) {
+		return 0;
+	}
+
+	if (absolute) {
+		return loadedDisk->Read_AbsoluteSectors(sectnum, count, data);
+	}
+	auto buffer = static_cast<Bit8u *>(data);
+	for (Bit32u i = 0; i < count; ++i) {
+		const Bit8u status = readSector(sectnum + i, buffer + i * getSectorSize());
+		if (status != 0)
+			return status;
+	}
+	return 0;
+}
+
 Bit8u fatDrive::writeSector(Bit32u sectnum, void * data) {
 	// Guard
 	if (!loadedDisk) {
@@ -559,40 +604,49 @@ Bit32u fatDrive::getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos
 	return  getAbsoluteSectFromChain(startClustNum, bytePos / bootbuffer.bytespersector);
 }
 
-Bit32u fatDrive::getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSector) {
-	Bit32s skipClust = logicalSector / bootbuffer.sectorspercluster;
-	Bit32u sectClust = logicalSector % bootbuffer.sectorspercluster;
-
-	Bit32u currentClust = startClustNum;
-	Bit32u testvalue;
+bool fatDrive::isEndOfChain(Bit32u clustValue) const {
+	switch(fattype) {
+		case FAT12: return clustValue >= 0xff8;
+		case FAT16: return clustValue >= 0xfff8;
+		case FAT32: return clustValue >= 0xfffffff8;
+	}
+	return false;
+}
 
-	while(skipClust!=0) {
-		bool isEOF = false;
-		testvalue = getClusterValue(currentClust);
-		switch(fattype) {
-			case FAT12:
-				if(testvalue >= 0xff8) isEOF = true;
-				break;
-			case FAT16:
-				if(testvalue >= 0xfff8) isEOF = true;
-				break;
-			case FAT32:
-				if(testvalue >= 0xfffffff8) isEOF = true;
-				break;
-		}
-		if((isEOF) && (skipClust>=1)) {
-			//LOG_MSG("End of cluster chain reached before end of logical sector seek!");
-			if (skipClust == 1 && fattype == FAT12) {
-				//break;
-				LOG(LOG_DOSMISC, LOG_ERROR)("End of cluster chain reached, but maybe good after all ?");
-			}
-			return 0;
+Bit32u fatDrive::getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSector) {
+	const Bit32u skipClust = logicalSector / bootbuffer.sectorspercluster;
+	const Bit32u sectClust = logicalSector % bootbuffer.sectorspercluster;
+
+	/* Keep the index bounded when many different files are accessed */
+	constexpr size_t max_cached_chains = 256;
+	if (clusterChains.size() >= max_cached_chains &&
+	    clusterChains.find(startClustNum) == clusterChains.end())
+		clusterChains.clear();
+
+	ClusterChain &chain = clusterChains[startClustNum];
+	auto &clusters = chain.clusters;
+	if (clusters.empty())
+		clusters.push_back(startClustNum);
+
+	/* Follow the FAT only past the part of the chain already known */
+	while (clusters.size() <= skipClust && !chain.complete) {
+		const Bit32u testvalue = getClusterValue(clusters.back());
+		if (isEndOfChain(testvalue))
+			chain.complete = true;
+		else
+			clusters.push_back(testvalue);
+	}
+
+	if (skipClust >= clusters.size()) {
+		//LOG_MSG("End of cluster chain reached before end of logical sector seek!");
+		if (skipClust - (clusters.size() - 1) == 1 && fattype == FAT12) {
+			//break;
+			LOG(LOG_DOSMISC, LOG_ERROR)("End of cluster chain reached, but maybe good after all ?");
 		}
-		currentClust = testvalue;
-		--skipClust;
+		return 0;
 	}
 
-	return (getClustFirstSect(currentClust) + sectClust);
+	return (getClustFirstSect(clusters[skipClust]) + sectClust);
 }
 
 void fatDrive::deleteClustChain(Bit32u startCluster, Bit32u bytePos) {
@@ -18,8 +18,10 @@
 
 #include "drives.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstring>
+#include <deque>
 
 #include "cdrom.h"
 #include "dos_mscdex.h"
@@ -145,6 +147,11 @@ Bit16u isoFile::GetInformation(void) {
 
 isoDrive::isoDrive(char driveLetter, const char *fileName, Bit8u mediaid, int &error)
         : nextFreeDirIterator(0),
+          sectorCache(ISO_SECTOR_CACHE_SETS * ISO_SECTOR_CACHE_WAYS),
+          sectorCacheClock(0),
+          indexEntries(),
+          indexPaths(),
+          indexDirs(),
           iso(false),
           dataCD(false),
           rootEntry{},
@@ -155,7 +162,6 @@ isoDrive::isoDrive(char driveLetter, const char *fileName, Bit8u mediaid, int &e
 	this->fileName[0]  = '\0';
 	this->discLabel[0] = '\0';
 	memset(dirIterators, 0, sizeof(dirIterators));
-	memset(sectorHashEntries, 0, sizeof(sectorHashEntries));
 	memset(&rootEntry, 0, sizeof(isoDirEntry));
 
 	safe_strcpy(this->fileName, fileName);
@@ -404,6 +410,16 @@ int isoDrive::GetDirIterator(const isoDirEntry* de) {
 	dirIterators[dirIterator].pos = 0;
 	dirIterators[dirIterator].valid = true;
 
+	// directories in the index are listed from there instead
+	dirIterators[dirIterator].indexed = false;
+	const auto dir = indexDirs.find(EXTENT_LOCATION(*de));
+	if (dir != indexDirs.end()) {
+		const IndexEntry &entry = indexEntries[dir->second];
+		dirIterators[dirIterator].indexed = true;
+		dirIterators[dirIterator].indexPos = entry.firstChild;
+		dirIterators[dirIterator].indexEnd = entry.firstChild + entry.numChildren;
+	}
+
 	// advance to next directory iterator (wrap around if necessary)
 	nextFreeDirIterator = (nextFreeDirIterator + 1) % MAX_OPENDIRS;
 
@@ -415,6 +431,13 @@ bool isoDrive::GetNextDirEntry(const int dirIteratorHandle, isoDirEntry* de) {
 	Bit8u* buffer = NULL;
 	DirIterator& dirIterator = dirIterators[dirIteratorHandle];
 
+	if (dirIterator.indexed) {
+		if (!dirIterator.valid || dirIterator.indexPos >= dirIterator.indexEnd)
+			return false;
+		indexToDirEntry(de, indexEntries[dirIterator.indexPos++]);
+		return true;
+	}
+
 	// check if the directory entry is valid
 	if (dirIterator.valid && ReadCachedSector(&buffer, dirIterator.currentSector)) {
 		// check if the next sector has to be read
@@ -458,20 +481,30 @@ void isoDrive::FreeDirIterator(const int dirIterator) {
 }
 
 bool isoDrive::ReadCachedSector(Bit8u** buffer, const Bit32u sector) {
-	// get hash table entry
-	int pos = sector % ISO_MAX_HASH_TABLE_SIZE;
-	SectorHashEntry& he = sectorHashEntries[pos];
-
-	// check if the entry is valid and contains the correct sector
-	if (!he.valid || he.sector != sector) {
-		if (!CDROM_Interface_Image::images[subUnit]->ReadSector(he.data, false, sector)) {
-			return false;
+	// consecutive sectors, like those of one directory, go to different sets
+	const auto set = sectorCache.begin() +
+	                 (sector % ISO_SECTOR_CACHE_SETS) * ISO_SECTOR_CACHE_WAYS;
+
+	// look for the sector, and for the least recently used way to replace
+	auto victim = set;
+	for (auto way = set; way != set + ISO_SECTOR_CACHE_WAYS; ++way) {
+		if (way->valid && way->sector == sector) {
+			way->lastUse = ++sectorCacheClock;
+			*buffer = way->data;
+			return true;
 		}
-		he.valid = true;
-		he.sector = sector;
+		if (victim->valid && (!way->valid || way->lastUse < victim->lastUse))
+			victim = way;
 	}
 
-	*buffer = he.data;
+	if (!CDROM_Interface_Image::images[subUnit]->ReadSector(victim->data, false, sector)) {
+		victim->valid = false;
+		return false;
+	}
+	victim->valid = true;
+	victim->sector = sector;
+	victim->lastUse = ++sectorCacheClock;
+	*buffer = victim->data;
 	return true;
 }
 
@@ -534,16 +567,145 @@ bool isoDrive :: loadImage() {
 	Bit16u offset = iso ? 156 : 180;
 	if (readDirEntry(&this->rootEntry, &pvd[offset])>0) {
 		dataCD = true;
+		if (!buildIndex())
+			LOG(LOG_DOSMISC, LOG_WARN)("ISO: Directory tree of %s not indexed, reading directories as needed", fileName);
 		return true;
 	}
 	return false;
 }
 
+// The key of a path in the index: upper-cased, elements without trailing
+// dots, separated by single backslashes
+static std::string index_key(const char *path)
+{
+	std::string key;
+	std::string name;
+	for (const char *c = path;; ++c) {
+		if (*c == '\\' || *c == '/' || *c == '\0') {
+			if (!name.empty() && name.back() == '.')
+				name.pop_back();
+			if (!name.empty()) {
+				if (!key.empty())
+					key += '\\';
+				key += name;
+				name.clear();
+			}
+			if (*c == '\0')
+				break;
+		} else {
+			name += static_cast<char>(toupper(static_cast<unsigned char>(*c)));
+		}
+	}
+	return key;
+}
+
+bool isoDrive::buildIndex() {
+	indexEntries.clear();
+	indexPaths.clear();
+	indexDirs.clear();
+
+	auto make_entry = [this](const isoDirEntry &de) {
+		IndexEntry entry = {};
+		entry.ident = reinterpret_cast<const char *>(de.ident);
+		entry.extent = EXTENT_LOCATION(de);
+		entry.length = DATA_LENGTH(de);
+		entry.flags = FLAGS1;
+		entry.dateYear = de.dateYear;
+		entry.dateMonth = de.dateMonth;
+		entry.dateDay = de.dateDay;
+		entry.timeHour = de.timeHour;
+		entry.timeMin = de.timeMin;
+		entry.timeSec = de.timeSec;
+		return entry;
+	};
+
+	// Built aside, so the directories are read from disc meanwhile
+	std::vector<IndexEntry> entries = {make_entry(rootEntry)};
+	std::unordered_map<std::string, Bit32u> paths;
+	std::unordered_map<Bit32u, Bit32u> dirs = {{entries[0].extent, 0}};
+
+	// Breadth first, so every directory's entries end up together
+	std::deque<std::pair<Bit32u, std::string>> pending = {{0, ""}};
+	std::vector<IndexEntry> children;
+	while (!pending.empty()) {
+		const Bit32u dir = pending.front().first;
+		const std::string path = pending.front().second;
+		pending.pop_front();
+
+		isoDirEntry de;
+		indexToDirEntry(&de, entries[dir]);
+		children.clear();
+		const int dirIterator = GetDirIterator(&de);
+		while (GetNextDirEntry(dirIterator, &de)) {
+			if (!IS_ASSOC(FLAGS1))
+				children.push_back(make_entry(de));
+		}
+		FreeDirIterator(dirIterator);
+
+		if (entries.size() + children.size() > ISO_MAX_INDEX_ENTRIES)
+			return false;
+		entries[dir].firstChild = static_cast<Bit32u>(entries.size());
+		entries[dir].numChildren = static_cast<Bit32u>(children.size());
+
+		for (const auto &child : children) {
+			const auto index = static_cast<Bit32u>(entries.size());
+			entries.push_back(child);
+			if (child.ident.empty() || child.ident == "." || child.ident == "..")
+				continue;
+
+			// The first of several entries with the same name is the
+			// one found, as when searching the directory
+			const std::string key = path.empty() ? index_key(child.ident.c_str())
+			                                     : path + '\\' + index_key(child.ident.c_str());
+			if (!paths.emplace(key, index).second)
+				continue;
+
+			// A directory reachable twice is only read once, which also
+			// keeps a malformed image from sending us round in circles
+			if (IS_DIR(child.flags) && dirs.emplace(child.extent, index).second)
+				pending.emplace_back(index, key);
+		}
+	}
+
+	indexEntries.swap(entries);
+	indexPaths.swap(paths);
+	indexDirs.swap(dirs);
+	return true;
+}
+
+void isoDrive::indexToDirEntry(isoDirEntry *de, const IndexEntry &entry) const {
+	memset(de, 0, sizeof(isoDirEntry));
+	de->extentLocationL = de->extentLocationM = entry.extent;
+	de->dataLengthL = de->dataLengthM = entry.length;
+	// FLAGS1 reads one or the other depending on the format
+	de->fileFlags = de->timeZone = entry.flags;
+	de->dateYear = entry.dateYear;
+	de->dateMonth = entry.dateMonth;
+	de->dateDay = entry.dateDay;
+	de->timeHour = entry.timeHour;
+	de->timeMin = entry.timeMin;
+	de->timeSec = entry.timeSec;
+	const size_t length = std::min(entry.ident.size(), ARRAY_LEN(de->ident) - 1);
+	memcpy(de->ident, entry.ident.data(), length);
+	de->fileIdentLength = static_cast<Bit8u>(length);
+}
+
 bool isoDrive :: lookup(isoDirEntry *de, const char *path) {
 	if (!dataCD) return false;
 	*de = this->rootEntry;
 	if (!strcmp(path, "")) return true;
 
+	if (!indexEntries.empty()) {
+		const std::string key = index_key(path);
+		if (key.empty())
+			return true;
+		const auto found = indexPaths.find(key);
+		if (found == indexPaths.end())
+			return false;
+		indexToDirEntry(de, indexEntries[found->second]);
+		return true;
+	}
+
 	char isoPath[ISO_MAXPATHNAME];
 	safe_strcpy(isoPath, path);
 	strreplace(isoPath, '\\', '/');
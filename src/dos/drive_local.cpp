@@ -559,6 +559,12 @@ void localFile::fseek_and_check(int whence)
 
 //TODO Maybe use fflush, but that seemed to fuck up in visual c
 bool localFile::Read(uint8_t *data, uint16_t *size)
+{
+	const DOS_IoSpan span = {data, *size};
+	return localFile::ReadSpans(&span, 1, size);
+}
+
+bool localFile::ReadSpans(const DOS_IoSpan *spans, Bitu count, uint16_t *size)
 {
 	// check if the file is opened in write-only mode
 	if ((this->flags & 0xf) == OPEN_WRITE) {
@@ -572,8 +578,15 @@ bool localFile::Read(uint8_t *data, uint16_t *size)
 			fseek_and_check(SEEK_SET);
 
 	last_action = READ;
-	const auto requested = *size;
-	const auto actual = static_cast<uint16_t>(fread(data, 1, requested, fhandle));
+	uint16_t actual = 0;
+	for (Bitu i = 0; i < count; i++) {
+		const auto requested = spans[i].size;
+		const auto got = static_cast<uint16_t>(
+		        fread(spans[i].data, 1, requested, fhandle));
+		actual += got;
+		if (got != requested)
+			break;
+	}
 	*size = actual; // always save the actual
 
 	// if (actual != requested)
@@ -591,6 +604,12 @@ bool localFile::Read(uint8_t *data, uint16_t *size)
 }
 
 bool localFile::Write(uint8_t *data, uint16_t *size)
+{
+	const DOS_IoSpan span = {data, *size};
+	return localFile::WriteSpans(&span, 1, size);
+}
+
+bool localFile::WriteSpans(const DOS_IoSpan *spans, Bitu count, uint16_t *size)
 {
 	Bit32u lastflags = this->flags & 0xf;
 	if (lastflags == OPEN_READ || lastflags == OPEN_READ_NO_MOD) {	// check if file opened in read-only mode
@@ -625,7 +644,14 @@ bool localFile::Write(uint8_t *data, uint16_t *size)
 
 	// Otherwise we have some data to write
 	const auto requested = *size;
-	const auto actual = static_cast<uint16_t>(fwrite(data, 1, requested, fhandle));
+	uint16_t actual = 0;
+	for (Bitu i = 0; i < count; i++) {
+		const auto wrote = static_cast<uint16_t>(
+		        fwrite(spans[i].data, 1, spans[i].size, fhandle));
+		actual += wrote;
+		if (wrote != spans[i].size)
+			break;
+	}
 	if (actual != requested)
 		DEBUG_LOG_MSG("FS: Only wrote %u of %u requested bytes to file %s",
 		              actual, requested, name.c_str());
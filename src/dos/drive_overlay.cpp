@@ -203,10 +203,18 @@ public:
 	}
 
 	bool Write(Bit8u * data,Bit16u * size) {
+		if (!switch_on_write(data)) return false;
+		return localFile::Write(data,size);
+	}
+	bool WriteSpans(const DOS_IoSpan *spans, Bitu count, Bit16u *size) {
+		if (!switch_on_write(count ? spans[0].data : nullptr)) return false;
+		return localFile::WriteSpans(spans,count,size);
+	}
+	bool switch_on_write(const Bit8u *data) {
 		Bit32u f = flags&0xf;
 		if (!overlay_active && (f == OPEN_READWRITE || f == OPEN_WRITE)) {
 			if (logoverlay) LOG_MSG("write detected, switching file for %s",GetName());
-			if (*data == 0) {
+			if (data && *data == 0) {
 				if (logoverlay) LOG_MSG("OPTIMISE: truncate on switch!!!!");
 			}
 			Bit32u a = GetTicks();
@@ -218,7 +226,7 @@ public:
 			overlay_active = true;
 			
 		}
-		return localFile::Write(data,size);
+		return true;
 	}
 	bool create_copy();
 //private:
@@ -32,6 +32,7 @@
 #include "video.h"
 #include "pic.h"
 #include "cpu.h"
+#include "cycle_governor.h"
 #include "callback.h"
 #include "inout.h"
 #include "mixer.h"
@@ -138,8 +139,11 @@ static Bit32u ticksLast;
 static Bit32u ticksAdded;
 Bit32s ticksDone;
 Bit32u ticksScheduled;
+Bit32u ticksSlept; // total time spent waiting for the next tick, in ms
 bool ticksLocked;
+CycleGovernor cycle_governor;
 void increaseticks();
+extern void GFX_SetTitle(Bit32s cycles, int frameskip, bool paused);
 bool mono_cga=false;
 
 static Bitu Normal_Loop()
@@ -192,10 +196,16 @@ void increaseticks() { //Make it return ticksRemain and set it in the function a
 	Bit32u ticksNew;
 	ticksNew = GetTicks();
 	ticksScheduled += ticksAdded;
+	cycle_governor.AddTicks(ticksAdded);
 	if (ticksNew <= ticksLast) { //lower should not be possible, only equal.
 		ticksAdded = 0;
 
-		if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust || sleep1count < 3) {
+		if (CPU_CycleGovernor) {
+			// The governor measures the sleep itself, no need for jitter
+			const int64_t sleepStart = GetTicksUs();
+			wrap_delay(1);
+			cycle_governor.AddSleep(GetTicksUs() - sleepStart);
+		} else if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust || sleep1count < 3) {
 			wrap_delay(1);
 		} else {
 			/* Certain configurations always give an exact sleepingtime of 1, this causes problems due to the fact that
@@ -212,6 +222,7 @@ void increaseticks() { //Make it return ticksRemain and set it in the function a
 		// Count how many times in the current block (of 250 ms) the time slept was 1 ms
 		if (CPU_CycleAutoAdjust && !CPU_SkipCycleAutoAdjust && timeslept == 1) sleep1count++;
 		lastsleepDone = ticksDone;
+		ticksSlept += timeslept;
 
 		// Update ticksDone with the time spent sleeping
 		ticksDone -= timeslept;
@@ -239,7 +250,37 @@ void increaseticks() { //Make it return ticksRemain and set it in the function a
 	ticksAdded = ticksRemain;
 
 	// Is the system in auto cycle mode guessing ? If not just exit. (It can be temporary disabled)
-	if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust) return;
+	if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust) {
+		cycle_governor.ResetWindow();
+		return;
+	}
+
+	if (CPU_CycleGovernor) {
+		const auto outcome = cycle_governor.Update(GetTicksUs(), CPU_CycleMax,
+		                                           CPU_IODelayRemoved,
+		                                           CPU_CyclePercUsed,
+		                                           CPU_CycleLimit);
+		if (outcome == CycleGovernor::Outcome::Measuring)
+			return;
+		CPU_IODelayRemoved = 0;
+		ticksDone = 0;
+		ticksScheduled = 0;
+		if (outcome != CycleGovernor::Outcome::Adjusted)
+			return;
+
+		const auto &state = cycle_governor.GetState();
+		LOG(LOG_CPU, LOG_NORMAL)("Cycle governor: target %.1f%%, load %.1f%%, error %+.1f%%, %d cycles/ms",
+		                         state.target * 100, state.load * 100,
+		                         state.error * 100, state.cycles);
+
+		// Refresh the cycles and load shown in the title bar about once a second
+		static Bit32u lastTitle = 0;
+		if (ticksNew - lastTitle >= 1000) {
+			lastTitle = ticksNew;
+			GFX_SetTitle(-1, -1, false);
+		}
+		return;
+	}
 
 	if (ticksScheduled >= 250 || ticksDone >= 250 || (ticksAdded > 15 && ticksScheduled >= 5) ) {
 		if(ticksDone < 1) ticksDone = 1; // Protect against div by zero
@@ -441,6 +482,19 @@ void DOSBOX_Init(void) {
 	Pstring = secprop->Add_path("captures",Property::Changeable::Always,"capture");
 	Pstring->Set_help("Directory where things like wave, midi, screenshot get captured.");
 
+	pint = secprop->Add_int("capture_queue", always, 8);
+	pint->SetMinMax(1, 64);
+	pint->Set_help("Number of frames buffered between the emulator and the video\n"
+	               "capture encoder, which runs on its own thread.");
+
+	const char *capture_overflow_modes[] = {"drop", "wait", 0};
+	pstring = secprop->Add_string("capture_overflow", always, "drop");
+	pstring->Set_values(capture_overflow_modes);
+	pstring->Set_help("What to do when the video capture encoder falls behind:\n"
+	                  "  drop:  Skip frames, stored as repeats of the previous one so\n"
+	                  "         the video stays in sync (default).\n"
+	                  "  wait:  Pause emulation until the encoder catches up.");
+
 #if C_DEBUG
 	LOG_StartUp();
 #endif
@@ -525,6 +579,13 @@ void DOSBOX_Init(void) {
 	pstring = pmulti->GetSection()->Add_string("force", always, "");
 	pstring->Set_values(force);
 
+	Pint = secprop->Add_int("scaler_threads", Property::Changeable::OnlyAtStart, 0);
+	Pint->SetMinMax(0, 8);
+	Pint->Set_help("Number of worker threads that scale the changed lines of each frame\n"
+	               "in bands when a complex scaler (advmame, advinterp, hq, sai and\n"
+	               "supereagle) is used. 0 scales on the emulation thread, which is\n"
+	               "fast enough for the other scalers.");
+
 #if C_OPENGL
 	pstring = secprop->Add_path("glshader", always, "default");
 	pstring->Set_help("Either 'none' or a GLSL shader name. Works only with\n"
@@ -581,6 +642,37 @@ void DOSBOX_Init(void) {
 	Pint->SetMinMax(1,1000000);
 	Pint->Set_help("Setting it lower than 100 will be a percentage.");
 
+	const char *governors[] = {"classic", "pi", 0};
+	Pstring = secprop->Add_string("cycle_governor", Property::Changeable::Always, "classic");
+	Pstring->Set_values(governors);
+	Pstring->Set_help("How 'auto' and 'max' cycles follow the host's speed.\n"
+	                  "  classic:  Adjust every 250 ms from millisecond timings (default).\n"
+	                  "  pi:       Measure with a microsecond clock every 25 ms and steer the\n"
+	                  "            cycles with a PI controller. Has no built-in upper bound,\n"
+	                  "            use 'limit' in the cycles setting to set one.");
+
+	Pint = secprop->Add_int("dynamic_cache_size", Property::Changeable::OnlyAtStart, 8);
+	Pint->SetMinMax(8, 256);
+	Pint->Set_help("Size of the dynamic core's code cache in MB (8 to 256).\n"
+	               "Large protected mode programs may need to translate their\n"
+	               "code again and again if it doesn't fit.");
+
+	Pint = secprop->Add_int("dynamic_cache_pages", Property::Changeable::OnlyAtStart, 512);
+	Pint->SetMinMax(64, 16384);
+	Pint->Set_help("Number of 4 KB memory pages the dynamic core can hold\n"
+	               "translated code for at once (64 to 16384).");
+
+	pstring = secprop->Add_path("dynamic_cache_file", Property::Changeable::OnlyAtStart, "");
+	pstring->Set_help("File where the dynamic core (dynrec) remembers which code it translated,\n"
+	                  "so that it can prepare it in one go when a program runs again.\n"
+	                  "Leave empty to disable (default). Only used by the dynrec core.");
+
+	Pbool = secprop->Add_bool("idle_polling", Property::Changeable::Always, false);
+	Pbool->Set_help("Let the host idle while a program polls the keyboard BIOS, the DOS idle\n"
+	                "interrupt or the VGA status register in a tight loop, as if it had\n"
+	                "halted the CPU. Saves host CPU time at prompts and in menus, but\n"
+	                "can upset programs that time themselves with such loops.");
+
 #if C_FPU
 	secprop->AddInitFunction(&FPU_Init);
 #endif
@@ -612,6 +704,12 @@ void DOSBOX_Init(void) {
 	Pint->SetMinMax(0,100);
 	Pint->Set_help("How many milliseconds of data to keep on top of the blocksize.");
 
+	Pint = secprop->Add_int("threads", Property::Changeable::OnlyAtStart, 0);
+	Pint->SetMinMax(0, 8);
+	Pint->Set_help("Number of worker threads used to render sound devices that support it\n"
+	               "(OPL and GUS) alongside the emulation. 0 renders all devices on the\n"
+	               "emulation thread. The mixed output is identical either way.");
+
 	secprop = control->AddSection_prop("midi", &MIDI_Init, true);
 	secprop->AddInitFunction(&MPU401_Init, true);
 
@@ -901,6 +999,11 @@ void DOSBOX_Init(void) {
 	secprop->AddInitFunction(&MSCDEX_Init);
 	secprop->AddInitFunction(&DRIVES_Init);
 	secprop->AddInitFunction(&CDROM_Image_Init);
+	Pint = secprop->Add_int("cdrom_readahead", only_at_start, 64);
+	Pint->SetMinMax(0, 1024);
+	Pint->Set_help("Size of the read-ahead buffer kept for each CD-ROM image track file,\n"
+	               "in KB (64 by default). Sequential sector reads from BIN/ISO images\n"
+	               "are then served from memory. Set to 0 to read every sector directly.");
 #if C_IPX
 	secprop=control->AddSection_prop("ipx",&IPX_Init,true);
 	Pbool = secprop->Add_bool("ipx",Property::Changeable::WhenIdle, false);
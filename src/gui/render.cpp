@@ -113,6 +113,8 @@ static void RENDER_StartLineHandler(const void * s) {
 			if (GCC_UNLIKELY(src[0] != cache[0])) {
 				if (!GFX_StartUpdate( render.scale.outWrite, render.scale.outPitch )) {
 					RENDER_DrawLine = RENDER_EmptyLineHandler;
+					/* Changed lines of this frame are lost, redraw the next one */
+					render.scale.clearCache = true;
 					return;
 				}
 				render.scale.outWrite += render.scale.outPitch * Scaler_ChangedLines[0];
@@ -228,6 +230,12 @@ void RENDER_EndUpdate( bool abort ) {
 			flags, fps, (Bit8u *)&scalerSourceCache, (Bit8u*)&render.pal.rgb );
 	}
 	if ( render.scale.outWrite ) {
+#if RENDER_USE_ADVANCED_SCALERS>1
+		if (!abort && render.scale.complexHandler == Scaler_ComplexDeferred)
+			Scaler_ComplexBands();
+#endif
+		/* Redraw everything after an aborted frame */
+		if (abort) render.scale.clearCache = true;
 		GFX_EndUpdate( abort? NULL : Scaler_ChangedLines );
 		render.frameskip.hadSkip[render.frameskip.index] = 0;
 	} else {
@@ -476,11 +484,14 @@ forcenormal:
 	else
 		E_Exit("Failed to create a rendering output");
 	ScalerLineBlock_t *lineBlock;
+	render.scale.complexLineHandler = 0;
 	if (gfx_flags & GFX_HARDWARE) {
 #if RENDER_USE_ADVANCED_SCALERS>1
 		if (complexBlock) {
 			lineBlock = &ScalerCache;
 			render.scale.complexHandler = complexBlock->Linear[ render.scale.outMode ];
+			render.scale.complexLineHandler = complexBlock->LinearLine[ render.scale.outMode ];
+			render.scale.complexLines = complexBlock->yscale;
 		} else
 #endif
 		{
@@ -492,6 +503,8 @@ forcenormal:
 		if (complexBlock) {
 			lineBlock = &ScalerCache;
 			render.scale.complexHandler = complexBlock->Random[ render.scale.outMode ];
+			render.scale.complexLineHandler = complexBlock->RandomLine[ render.scale.outMode ];
+			render.scale.complexLines = 0;
 		} else
 #endif
 		{
@@ -499,6 +512,11 @@ forcenormal:
 			lineBlock = &simpleBlock->Random;
 		}
 	}
+#if RENDER_USE_ADVANCED_SCALERS>1
+	/* Only the complex scalers are worth scaling on the threads */
+	if (render.scale.complexHandler && Scaler_HasThreads())
+		render.scale.complexHandler = Scaler_ComplexDeferred;
+#endif
 	switch (render.src.bpp) {
 	case 8:
 		render.scale.lineHandler = (*lineBlock)[0][render.scale.outMode];
@@ -702,6 +720,14 @@ void RENDER_Init(Section * sec) {
 	render.aspect=section->Get_bool("aspect");
 	render.frameskip.max=section->Get_int("frameskip");
 	render.frameskip.count=0;
+#if RENDER_USE_ADVANCED_SCALERS>1
+	const int scaler_threads = section->Get_int("scaler_threads");
+	if (!running && scaler_threads > 0) {
+		Scaler_StartThreads(scaler_threads);
+		LOG_MSG("RENDER: Scaling with %d worker thread%s", scaler_threads,
+		        scaler_threads > 1 ? "s" : "");
+	}
+#endif
 	VGA_SetMonoPalette(section->Get_string("monochrome_palette"));
 	std::string cline;
 	std::string scaler;
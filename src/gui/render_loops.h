@@ -16,33 +16,19 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+/* Scales the changed blocks of one line of the frame cache to outWrite, the
+   write cache holds the extra lines of the linear version. Only touches this
+   line's change cache and output, so lines can be scaled on any thread. */
 #if defined (SCALERLINEAR)
-static void conc3d(SCALERNAME,SBPP,L)(void) {
-#else
-static void conc3d(SCALERNAME,SBPP,R)(void) {
-#endif
-//Skip the first one for multiline input scalers
-	if (!render.scale.outLine) {
-		render.scale.outLine++;
-		return;
-	}
-lastagain:
-	if (!CC[render.scale.outLine][0]) {
-#if defined(SCALERLINEAR) 
-		Bitu scaleLines = SCALERHEIGHT;
+static void conc3d(SCALERNAME,SBPP,LLine)(Bitu outLine, Bit8u *outWrite, scalerWriteCache_t &writeCache) {
 #else
-		Bitu scaleLines = Scaler_Aspect[ render.scale.outLine ];
+static void conc3d(SCALERNAME,SBPP,RLine)(Bitu outLine, Bit8u *outWrite, scalerWriteCache_t &) {
 #endif
-		ScalerAddLines( 0, scaleLines );
-		if (++render.scale.outLine == render.scale.inHeight)
-			goto lastagain;
-		return;
-	}
 	/* Clear the complete line marker */
-	CC[render.scale.outLine][0] = 0;
-	const PTYPE * fc = &FC[render.scale.outLine][1];
-	PTYPE * line0=(PTYPE *)(render.scale.outWrite);
-	Bit8u * changed = &CC[render.scale.outLine][1];
+	CC[outLine][0] = 0;
+	const PTYPE * fc = &FC[outLine][1];
+	PTYPE * line0=(PTYPE *)(outWrite);
+	Bit8u * changed = &CC[outLine][1];
 	Bitu b;
 	for (b=0;b<render.scale.blocks;b++) {
 #if (SCALERHEIGHT > 1) 
@@ -131,16 +117,16 @@ lastagain:
 		default:
 #if defined(SCALERLINEAR)
 #if (SCALERHEIGHT > 1) 
-			line1 = WC[0];
+			line1 = WCP[0];
 #endif
 #if (SCALERHEIGHT > 2) 
-			line2 = WC[1];
+			line2 = WCP[1];
 #endif
 #if (SCALERHEIGHT > 3) 
-			line3 = WC[2];
+			line3 = WCP[2];
 #endif
 #if (SCALERHEIGHT > 4) 
-			line4 = WC[3];
+			line4 = WCP[3];
 #endif
 #else
 #if (SCALERHEIGHT > 1) 
@@ -175,30 +161,57 @@ lastagain:
 			}
 #if defined(SCALERLINEAR)
 #if (SCALERHEIGHT > 1) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch  ,WC[0], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch  ,WCP[0], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #if (SCALERHEIGHT > 2) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*2,WC[1], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*2,WCP[1], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #if (SCALERHEIGHT > 3) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*3,WC[2], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*3,WCP[2], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #if (SCALERHEIGHT > 4) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*4,WC[3], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*4,WCP[3], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #endif //defined(SCALERLINEAR)
 			break;
 		}
 	}
+#if !defined(SCALERLINEAR) 
+	Bitu scaleLines = Scaler_Aspect[ outLine ];
+	if ( ((Bits)(scaleLines - SCALERHEIGHT)) > 0 ) {
+		BituMove( outWrite + render.scale.outPitch * SCALERHEIGHT,
+			outWrite + render.scale.outPitch * (SCALERHEIGHT-1),
+			render.src.width * SCALERWIDTH * PSIZE);
+	}
+#endif
+}
+
+#if defined (SCALERLINEAR)
+static void conc3d(SCALERNAME,SBPP,L)(void) {
+#else
+static void conc3d(SCALERNAME,SBPP,R)(void) {
+#endif
+//Skip the first one for multiline input scalers
+	if (!render.scale.outLine) {
+		render.scale.outLine++;
+		return;
+	}
+lastagain:
 #if defined(SCALERLINEAR) 
 	Bitu scaleLines = SCALERHEIGHT;
 #else
 	Bitu scaleLines = Scaler_Aspect[ render.scale.outLine ];
-	if ( ((Bits)(scaleLines - SCALERHEIGHT)) > 0 ) {
-		BituMove( render.scale.outWrite + render.scale.outPitch * SCALERHEIGHT,
-			render.scale.outWrite + render.scale.outPitch * (SCALERHEIGHT-1),
-			render.src.width * SCALERWIDTH * PSIZE);
+#endif
+	if (!CC[render.scale.outLine][0]) {
+		ScalerAddLines( 0, scaleLines );
+		if (++render.scale.outLine == render.scale.inHeight)
+			goto lastagain;
+		return;
 	}
+#if defined(SCALERLINEAR) 
+	conc3d(SCALERNAME,SBPP,LLine)(render.scale.outLine, render.scale.outWrite, scalerWriteCache);
+#else
+	conc3d(SCALERNAME,SBPP,RLine)(render.scale.outLine, render.scale.outWrite, scalerWriteCache);
 #endif
 	ScalerAddLines( 1, scaleLines );
 	if (++render.scale.outLine == render.scale.inHeight)
@@ -23,18 +23,22 @@
 
 #include "dosbox.h"
 #include "render.h"
+#include "support.h"
 #include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 Bit8u Scaler_Aspect[SCALER_MAXHEIGHT];
 Bit16u Scaler_ChangedLines[SCALER_MAXHEIGHT];
 Bitu Scaler_ChangedLineIndex;
 
-static union {
-	 //The +1 is a at least for the normal scalers not needed. (-1 is enough)
-	Bit32u b32 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-	Bit16u b16 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-	Bit8u   b8 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-} scalerWriteCache;
+static scalerWriteCache_t scalerWriteCache;
 //scalerFrameCache_t scalerFrameCache;
 scalerSourceCache_t scalerSourceCache;
 #if RENDER_USE_ADVANCED_SCALERS>1
@@ -370,7 +374,9 @@ ScalerComplexBlock_t ScaleAdvMame2x ={
 	GFX_CAN_8|GFX_CAN_15|GFX_CAN_16|GFX_CAN_32,
 	2,2,
 {	AdvMame2x_8_L,AdvMame2x_16_L,AdvMame2x_16_L,AdvMame2x_32_L},
-{	AdvMame2x_8_R,AdvMame2x_16_R,AdvMame2x_16_R,AdvMame2x_32_R}
+{	AdvMame2x_8_R,AdvMame2x_16_R,AdvMame2x_16_R,AdvMame2x_32_R},
+{	AdvMame2x_8_LLine,AdvMame2x_16_LLine,AdvMame2x_16_LLine,AdvMame2x_32_LLine},
+{	AdvMame2x_8_RLine,AdvMame2x_16_RLine,AdvMame2x_16_RLine,AdvMame2x_32_RLine}
 };
 
 ScalerComplexBlock_t ScaleAdvMame3x = {
@@ -378,7 +384,9 @@ ScalerComplexBlock_t ScaleAdvMame3x = {
 	GFX_CAN_8|GFX_CAN_15|GFX_CAN_16|GFX_CAN_32,
 	3,3,
 {	AdvMame3x_8_L,AdvMame3x_16_L,AdvMame3x_16_L,AdvMame3x_32_L},
-{	AdvMame3x_8_R,AdvMame3x_16_R,AdvMame3x_16_R,AdvMame3x_32_R}
+{	AdvMame3x_8_R,AdvMame3x_16_R,AdvMame3x_16_R,AdvMame3x_32_R},
+{	AdvMame3x_8_LLine,AdvMame3x_16_LLine,AdvMame3x_16_LLine,AdvMame3x_32_LLine},
+{	AdvMame3x_8_RLine,AdvMame3x_16_RLine,AdvMame3x_16_RLine,AdvMame3x_32_RLine}
 };
 
 /* These need specific 15bpp versions */
@@ -387,7 +395,9 @@ ScalerComplexBlock_t ScaleHQ2x ={
 	GFX_CAN_15|GFX_CAN_16|GFX_CAN_32|GFX_RGBONLY,
 	2,2,
 {	0,HQ2x_16_L,HQ2x_16_L,HQ2x_32_L},
-{	0,HQ2x_16_R,HQ2x_16_R,HQ2x_32_R}
+{	0,HQ2x_16_R,HQ2x_16_R,HQ2x_32_R},
+{	0,HQ2x_16_LLine,HQ2x_16_LLine,HQ2x_32_LLine},
+{	0,HQ2x_16_RLine,HQ2x_16_RLine,HQ2x_32_RLine}
 };
 
 ScalerComplexBlock_t ScaleHQ3x ={
@@ -395,7 +405,9 @@ ScalerComplexBlock_t ScaleHQ3x ={
 	GFX_CAN_15|GFX_CAN_16|GFX_CAN_32|GFX_RGBONLY,
 	3,3,
 {	0,HQ3x_16_L,HQ3x_16_L,HQ3x_32_L},
-{	0,HQ3x_16_R,HQ3x_16_R,HQ3x_32_R}
+{	0,HQ3x_16_R,HQ3x_16_R,HQ3x_32_R},
+{	0,HQ3x_16_LLine,HQ3x_16_LLine,HQ3x_32_LLine},
+{	0,HQ3x_16_RLine,HQ3x_16_RLine,HQ3x_32_RLine}
 };
 
 ScalerComplexBlock_t ScaleSuper2xSaI ={
@@ -403,7 +415,9 @@ ScalerComplexBlock_t ScaleSuper2xSaI ={
 	GFX_CAN_15|GFX_CAN_16|GFX_CAN_32|GFX_RGBONLY,
 	2,2,
 {	0,Super2xSaI_16_L,Super2xSaI_16_L,Super2xSaI_32_L},
-{	0,Super2xSaI_16_R,Super2xSaI_16_R,Super2xSaI_32_R}
+{	0,Super2xSaI_16_R,Super2xSaI_16_R,Super2xSaI_32_R},
+{	0,Super2xSaI_16_LLine,Super2xSaI_16_LLine,Super2xSaI_32_LLine},
+{	0,Super2xSaI_16_RLine,Super2xSaI_16_RLine,Super2xSaI_32_RLine}
 };
 
 ScalerComplexBlock_t Scale2xSaI ={
@@ -411,7 +425,9 @@ ScalerComplexBlock_t Scale2xSaI ={
 	GFX_CAN_15|GFX_CAN_16|GFX_CAN_32|GFX_RGBONLY,
 	2,2,
 {	0,_2xSaI_16_L,_2xSaI_16_L,_2xSaI_32_L},
-{	0,_2xSaI_16_R,_2xSaI_16_R,_2xSaI_32_R}
+{	0,_2xSaI_16_R,_2xSaI_16_R,_2xSaI_32_R},
+{	0,_2xSaI_16_LLine,_2xSaI_16_LLine,_2xSaI_32_LLine},
+{	0,_2xSaI_16_RLine,_2xSaI_16_RLine,_2xSaI_32_RLine}
 };
 
 ScalerComplexBlock_t ScaleSuperEagle ={
@@ -419,7 +435,9 @@ ScalerComplexBlock_t ScaleSuperEagle ={
 	GFX_CAN_15|GFX_CAN_16|GFX_CAN_32|GFX_RGBONLY,
 	2,2,
 {	0,SuperEagle_16_L,SuperEagle_16_L,SuperEagle_32_L},
-{	0,SuperEagle_16_R,SuperEagle_16_R,SuperEagle_32_R}
+{	0,SuperEagle_16_R,SuperEagle_16_R,SuperEagle_32_R},
+{	0,SuperEagle_16_LLine,SuperEagle_16_LLine,SuperEagle_32_LLine},
+{	0,SuperEagle_16_RLine,SuperEagle_16_RLine,SuperEagle_32_RLine}
 };
 
 ScalerComplexBlock_t ScaleAdvInterp2x = {
@@ -427,7 +445,9 @@ ScalerComplexBlock_t ScaleAdvInterp2x = {
 	GFX_CAN_15|GFX_CAN_16|GFX_CAN_32|GFX_RGBONLY,
 	2,2,
 {	0,AdvInterp2x_15_L,AdvInterp2x_16_L,AdvInterp2x_32_L},
-{	0,AdvInterp2x_15_R,AdvInterp2x_16_R,AdvInterp2x_32_R}
+{	0,AdvInterp2x_15_R,AdvInterp2x_16_R,AdvInterp2x_32_R},
+{	0,AdvInterp2x_15_LLine,AdvInterp2x_16_LLine,AdvInterp2x_32_LLine},
+{	0,AdvInterp2x_15_RLine,AdvInterp2x_16_RLine,AdvInterp2x_32_RLine}
 };
 
 ScalerComplexBlock_t ScaleAdvInterp3x = {
@@ -435,7 +455,175 @@ ScalerComplexBlock_t ScaleAdvInterp3x = {
 	GFX_CAN_15|GFX_CAN_16|GFX_CAN_32|GFX_RGBONLY,
 	3,3,
 {	0,AdvInterp3x_15_L,AdvInterp3x_16_L,AdvInterp3x_32_L},
-{	0,AdvInterp3x_15_R,AdvInterp3x_16_R,AdvInterp3x_32_R}
+{	0,AdvInterp3x_15_R,AdvInterp3x_16_R,AdvInterp3x_32_R},
+{	0,AdvInterp3x_15_LLine,AdvInterp3x_16_LLine,AdvInterp3x_32_LLine},
+{	0,AdvInterp3x_15_RLine,AdvInterp3x_16_RLine,AdvInterp3x_32_RLine}
 };
 
 #endif
+
+#if RENDER_USE_ADVANCED_SCALERS>1
+struct ScalerLineJob {
+	Bitu line;
+	Bit8u *outWrite;
+};
+
+// A small pool of threads that scale the changed lines of a frame in bands.
+// The emulation thread hands over the lines, helps scaling them and waits
+// for the last band before the frame is presented.
+class ScalerWorkers {
+public:
+	ScalerWorkers() = default;
+	ScalerWorkers(const ScalerWorkers &) = delete; // prevent copying
+	ScalerWorkers &operator=(const ScalerWorkers &) = delete; // prevent assignment
+	~ScalerWorkers() { Stop(); }
+
+	bool IsRunning() const { return !threads.empty(); }
+
+	void Start(const int num_threads)
+	{
+		Stop();
+		for (int i = 0; i < num_threads; ++i) {
+			writeCaches.emplace_back(new scalerWriteCache_t);
+			threads.emplace_back(&ScalerWorkers::Work, this, writeCaches.back().get());
+			set_thread_name(threads.back(), "dosbox:scaler");
+		}
+	}
+
+	void Stop()
+	{
+		{
+			const std::lock_guard<std::mutex> lock(mutex);
+			should_quit = true;
+		}
+		has_batch.notify_all();
+		for (auto &thread : threads)
+			thread.join();
+		threads.clear();
+		writeCaches.clear();
+		should_quit = false;
+	}
+
+	// Scales the lines and returns once all of them are done
+	void Run(const std::vector<ScalerLineJob> &lines)
+	{
+		assert(remaining_bands == 0);
+		const size_t workers = threads.size() + 1;
+		{
+			// Workers that were late to the previous batch may still be
+			// looking at it, so let them finish before replacing it
+			std::unique_lock<std::mutex> lock(mutex);
+			batch_done.wait(lock, [this]() { return active_workers == 0; });
+			batch = lines;
+			// A few bands per thread evens out lines with more changes
+			band_size = std::max<size_t>(4, lines.size() / (workers * 4));
+			next_band = 0;
+			remaining_bands = (lines.size() + band_size - 1) / band_size;
+			++batch_id;
+		}
+		has_batch.notify_all();
+		while (RunNextBand(scalerWriteCache))
+			;
+		std::unique_lock<std::mutex> lock(mutex);
+		batch_done.wait(lock, [this]() { return remaining_bands == 0; });
+	}
+
+private:
+	// Claims and scales the next unclaimed band of lines
+	bool RunNextBand(scalerWriteCache_t &writeCache)
+	{
+		const size_t first = (next_band++) * band_size;
+		if (first >= batch.size())
+			return false;
+		const size_t last = std::min(first + band_size, batch.size());
+		const ScalerComplexLineHandler_t handler = render.scale.complexLineHandler;
+		for (size_t i = first; i < last; ++i)
+			handler(batch[i].line, batch[i].outWrite, writeCache);
+		if (--remaining_bands == 0) {
+			{ const std::lock_guard<std::mutex> lock(mutex); }
+			batch_done.notify_all();
+		}
+		return true;
+	}
+
+	void Work(scalerWriteCache_t *writeCache)
+	{
+		uint64_t last_batch_id = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				has_batch.wait(lock, [&]() {
+					return should_quit || batch_id != last_batch_id;
+				});
+				if (should_quit)
+					return;
+				last_batch_id = batch_id;
+				++active_workers;
+			}
+			while (RunNextBand(*writeCache))
+				;
+			{
+				const std::lock_guard<std::mutex> lock(mutex);
+				--active_workers;
+			}
+			batch_done.notify_all();
+		}
+	}
+
+	std::vector<std::thread> threads = {};
+	std::vector<std::unique_ptr<scalerWriteCache_t>> writeCaches = {};
+	std::mutex mutex = {};
+	std::condition_variable has_batch = {};
+	std::condition_variable batch_done = {};
+	std::vector<ScalerLineJob> batch = {};
+	size_t band_size = 0;
+	std::atomic<size_t> next_band{0};
+	std::atomic<size_t> remaining_bands{0};
+	uint64_t batch_id = 0;
+	int active_workers = 0;
+	bool should_quit = false;
+};
+
+static ScalerWorkers scaler_workers;
+
+void Scaler_StartThreads(int num_threads) {
+	if (num_threads > 0)
+		scaler_workers.Start(num_threads);
+	else
+		scaler_workers.Stop();
+}
+
+bool Scaler_HasThreads(void) {
+	return scaler_workers.IsRunning();
+}
+
+/* Stands in for the complex handler, the lines are scaled at the frame end */
+void Scaler_ComplexDeferred(void) {
+}
+
+/* Scales the lines the complex cache handler collected this frame. The
+   output layout and changed line list are made here like the line by line
+   handler does, then the changed lines get scaled on the workers. */
+void Scaler_ComplexBands(void) {
+	static std::vector<ScalerLineJob> jobs;
+	jobs.clear();
+	/* Like the line handler: skip the first line, and do the last one
+	   only once its input line was drawn */
+	Bitu line = render.scale.outLine ? render.scale.outLine : 1;
+	const Bitu end = render.scale.inLine >= render.scale.inHeight ?
+		render.scale.inHeight + 1 : render.scale.inLine;
+	for (; line < end; line++) {
+		const Bitu scaleLines = render.scale.complexLines ?
+			render.scale.complexLines : Scaler_Aspect[line];
+		if (CC[line][0]) {
+			jobs.push_back({line, render.scale.outWrite});
+			ScalerAddLines(1, scaleLines);
+		} else {
+			ScalerAddLines(0, scaleLines);
+		}
+	}
+	render.scale.outLine = line;
+	if (!jobs.empty())
+		scaler_workers.Run(jobs);
+}
+#endif
@@ -72,8 +72,16 @@ typedef enum scalerOperation {
 	scalerLast
 } scalerOperation_t;
 
+typedef union {
+	 //The +1 is a at least for the normal scalers not needed. (-1 is enough)
+	Bit32u b32 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+	Bit16u b16 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+	Bit8u   b8 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+} scalerWriteCache_t;
+
 typedef void (*ScalerLineHandler_t)(const void *src);
 typedef void (*ScalerComplexHandler_t)(void);
+typedef void (*ScalerComplexLineHandler_t)(Bitu outLine, Bit8u *outWrite, scalerWriteCache_t &writeCache);
 
 extern Bit8u Scaler_Aspect[];
 extern Bit8u diff_table[];
@@ -105,6 +113,8 @@ typedef struct {
 	Bitu xscale,yscale;
 	ScalerComplexHandler_t Linear[4];
 	ScalerComplexHandler_t Random[4];
+	ScalerComplexLineHandler_t LinearLine[4];
+	ScalerComplexLineHandler_t RandomLine[4];
 } ScalerComplexBlock_t;
 
 typedef struct {
@@ -148,5 +158,11 @@ extern ScalerComplexBlock_t ScaleAdvInterp3x;
 #endif
 #if RENDER_USE_ADVANCED_SCALERS>1
 extern ScalerLineBlock_t ScalerCache;
+/* Threaded complex scalers: the cache handler only collects the frame and
+   the changed lines get scaled in bands when the frame ends */
+void Scaler_StartThreads(int num_threads);
+bool Scaler_HasThreads(void);
+void Scaler_ComplexDeferred(void);
+void Scaler_ComplexBands(void);
 #endif
 #endif
@@ -20,6 +20,7 @@
 #define PSIZE 1
 #define PTYPE Bit8u
 #define WC scalerWriteCache.b8
+#define WCP writeCache.b8
 //#define FC scalerFrameCache.b8
 #define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b8
 #define redMask		0
@@ -35,6 +36,7 @@
 #define PSIZE 2
 #define PTYPE Bit16u
 #define WC scalerWriteCache.b16
+#define WCP writeCache.b16
 //#define FC scalerFrameCache.b16
 #define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b16
 #if DBPP == 15
@@ -62,6 +64,7 @@
 #define PSIZE 4
 #define PTYPE Bit32u
 #define WC scalerWriteCache.b32
+#define WCP writeCache.b32
 //#define FC scalerFrameCache.b32
 #define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b32
 #define redMask		0xff0000
@@ -603,6 +606,7 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #undef PTYPE
 #undef PMAKE
 #undef WC
+#undef WCP
 #undef LC
 #undef FC
 #undef SC
@@ -65,6 +65,10 @@ static inline void conc2d(InitLUTs,SBPP)(void)
 	int r, g, b;
 	int Y, u, v;
 
+	// The 16 and 32 bpp tables are the same, build them once
+	if (_RGBtoYUV != nullptr)
+		return;
+
 	_RGBtoYUV = (Bit32u *)malloc(65536 * sizeof(Bit32u));
 	if (_RGBtoYUV == nullptr) {
 		return;
@@ -86,3 +90,10 @@ static inline void conc2d(InitLUTs,SBPP)(void)
 		_RGBtoYUV[color] = (Y << 16) | (u << 8) | v;
 	}
 }
+
+// Several scaler threads can get here at once, only the first builds the table
+static inline void conc2d(CheckLUTs,SBPP)(void)
+{
+	static const bool built = (conc2d(InitLUTs,SBPP)(), true);
+	(void)built;
+}
@@ -87,7 +87,7 @@
 
 inline void conc2d(Hq2x,SBPP)(PTYPE * line0, PTYPE * line1, const PTYPE * fc)
 {
-	if (_RGBtoYUV == 0) conc2d(InitLUTs,SBPP)();
+	conc2d(CheckLUTs,SBPP)();
 
 	Bit32u pattern = 0;
 	const Bit32u YUV4 = RGBtoYUV(C4);
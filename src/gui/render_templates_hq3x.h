@@ -89,7 +89,7 @@
 
 inline void conc2d(Hq3x,SBPP)(PTYPE * line0, PTYPE * line1, PTYPE * line2, const PTYPE * fc)
 {
-	if (_RGBtoYUV == 0) conc2d(InitLUTs,SBPP)();
+	conc2d(CheckLUTs,SBPP)();
 
 	Bit32u pattern = 0;
 	const Bit32u YUV4 = RGBtoYUV(C4);
@@ -21,16 +21,21 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
 #include <chrono>
 #include <cstdlib>
+#include <future>
+#include <memory>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include <thread>
 #include <tuple>
 #include <math.h>
 #ifdef WIN32
@@ -46,6 +51,7 @@
 #include "control.h"
 #include "cpu.h"
 #include "cross.h"
+#include "cycle_governor.h"
 #include "debug.h"
 #include "fs_utils.h"
 #include "gui_msgs.h"
@@ -59,6 +65,7 @@
 #include "string_utils.h"
 #include "support.h"
 #include "timer.h"
+#include "triple_buffer.h"
 #include "vga.h"
 #include "video.h"
 
@@ -301,6 +308,7 @@ struct SDL_Block {
 		bool packed_pixel;
 		bool paletted_texture;
 		bool pixel_buffer_object = false;
+		bool use_presenter = false;
 		bool use_shader;
 		GLuint program_object;
 		const char *shader_src;
@@ -391,6 +399,139 @@ void OPENGL_ERROR(const char*) {
 #endif
 #endif
 
+// Frames finished by the renderer versus frames that reached the screen.
+// They only differ when the presenter thread falls behind and a newer frame
+// replaces one it hasn't drawn yet.
+struct FrameStats {
+	std::atomic<uint64_t> emulated{0};
+	std::atomic<uint64_t> presented{0};
+	std::atomic<uint64_t> dropped{0};
+};
+
+static FrameStats frame_stats;
+
+#if C_OPENGL
+/* Presents OpenGL frames from a thread of its own, so texture uploads and
+ * buffer swaps (which block with vsync) never hold up the emulation.
+ *
+ * The thread owns the GL context while it runs. GFX_EndUpdate copies each
+ * finished frame into a triple buffer and returns straight away; the
+ * presenter draws the newest frame whenever it's ready for one. Anything
+ * else touching the context (GFX_SetSize, shader changes, window resizes
+ * and cleanup) first stops the presenter, which hands the context back.
+ */
+class GLPresenter {
+public:
+	GLPresenter() = default;
+	GLPresenter(const GLPresenter &) = delete;
+	GLPresenter &operator=(const GLPresenter &) = delete;
+	~GLPresenter();
+
+	void Start();
+	void Stop();
+	bool IsRunning() const { return thread.joinable(); }
+
+	void Submit(const uint8_t *pixels);
+	void Tick() { pending_ticks++; }
+
+private:
+	void Run(std::promise<bool> took_over);
+
+	std::thread thread = {};
+	std::unique_ptr<TripleBuffer<std::vector<uint8_t>>> frames = {};
+	std::atomic<GLuint> pending_ticks{0};
+};
+
+static GLPresenter presenter;
+
+static void DrawGLFrame()
+{
+	if (sdl.opengl.program_object) {
+		glUniform1i(sdl.opengl.ruby.frame_count, sdl.opengl.actual_frame_count++);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	} else {
+		glCallList(sdl.opengl.displaylist);
+	}
+	SDL_GL_SwapWindow(sdl.window);
+}
+
+// Only reached with the thread still running when exiting abnormally, so
+// just let it finish without touching the context again
+GLPresenter::~GLPresenter()
+{
+	if (!IsRunning())
+		return;
+	frames->Stop();
+	thread.join();
+}
+
+void GLPresenter::Start()
+{
+	assert(!IsRunning());
+	const auto frame_bytes = static_cast<size_t>(sdl.opengl.pitch) * sdl.draw.height;
+	frames = std::make_unique<TripleBuffer<std::vector<uint8_t>>>(
+	        std::vector<uint8_t>(frame_bytes));
+	pending_ticks = 0;
+
+	// A context can only be current on one thread at a time
+	SDL_GL_MakeCurrent(sdl.window, nullptr);
+	std::promise<bool> took_over;
+	auto result = took_over.get_future();
+	thread = std::thread(&GLPresenter::Run, this, std::move(took_over));
+	if (!result.get()) {
+		thread.join();
+		SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context);
+		LOG_MSG("SDL:OPENGL: Can't present from a separate thread, presenting inline");
+		return;
+	}
+	set_thread_name(thread, "dosbox:present");
+}
+
+void GLPresenter::Stop()
+{
+	if (!IsRunning())
+		return;
+	frames->Stop();
+	thread.join();
+	if (frames->HasNew())
+		frame_stats.dropped++;
+	SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context);
+}
+
+void GLPresenter::Submit(const uint8_t *pixels)
+{
+	// The renderer only rewrites the lines that changed, and the slot we
+	// get back holds an older frame, so the whole frame has to be copied
+	auto &frame = frames->WriteSlot();
+	std::copy(pixels, pixels + frame.size(), frame.begin());
+	if (!frames->Publish())
+		frame_stats.dropped++;
+}
+
+void GLPresenter::Run(std::promise<bool> took_over)
+{
+	if (SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context) != 0) {
+		LOG_MSG("SDL:OPENGL: %s", SDL_GetError());
+		took_over.set_value(false);
+		return;
+	}
+	took_over.set_value(true);
+
+	while (const auto frame = frames->AcquireRead()) {
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sdl.draw.width,
+		                sdl.draw.height, GL_BGRA_EXT,
+		                GL_UNSIGNED_INT_8_8_8_8_REV, frame->data());
+		// Forced updates without new contents still advance the shader
+		sdl.opengl.actual_frame_count += pending_ticks.exchange(0);
+		DrawGLFrame();
+		frame_stats.presented++;
+	}
+	SDL_GL_MakeCurrent(sdl.window, nullptr);
+}
+#endif
+
 static void QuitSDL()
 {
 	if (sdl.initialized)
@@ -417,11 +558,20 @@ void GFX_SetTitle(Bit32s cycles, int /*frameskip*/, bool paused)
 	if (cycles != -1)
 		internal_cycles = cycles;
 
-	const char *msg = CPU_CycleAutoAdjust
-	                          ? "%8s - max %d%% - DOSBox Staging%s%s"
-	                          : "%8s - %d cycles/ms - DOSBox Staging%s%s";
-	snprintf(title, sizeof(title), msg, RunningProgram, internal_cycles,
-	         build_type, paused ? " (PAUSED)" : "");
+	if (CPU_CycleAutoAdjust && CPU_CycleGovernor) {
+		const auto &state = cycle_governor.GetState();
+		snprintf(title, sizeof(title),
+		         "%8s - max %d%% - %d cycles/ms, %d%% load - DOSBox Staging%s%s",
+		         RunningProgram, internal_cycles, state.cycles,
+		         static_cast<int>(state.load * 100 + 0.5), build_type,
+		         paused ? " (PAUSED)" : "");
+	} else {
+		const char *msg = CPU_CycleAutoAdjust
+		                          ? "%8s - max %d%% - DOSBox Staging%s%s"
+		                          : "%8s - %d cycles/ms - DOSBox Staging%s%s";
+		snprintf(title, sizeof(title), msg, RunningProgram, internal_cycles,
+		         build_type, paused ? " (PAUSED)" : "");
+	}
 	SDL_SetWindowTitle(sdl.window, title);
 }
 
@@ -964,6 +1114,9 @@ Bitu GFX_SetSize(Bitu width, Bitu height, Bitu flags,
 	Bitu retFlags = 0;
 	if (sdl.updating)
 		GFX_EndUpdate( 0 );
+#if C_OPENGL
+	presenter.Stop();
+#endif
 
 	sdl.draw.width = static_cast<int>(width);
 	sdl.draw.height = static_cast<int>(height);
@@ -1356,6 +1509,8 @@ dosurface:
 			retFlags |= GFX_HARDWARE;
 
 		sdl.desktop.type = SCREEN_OPENGL;
+		if (sdl.opengl.use_presenter)
+			presenter.Start();
 		break; // SCREEN_OPENGL
 	}
 #endif // C_OPENGL
@@ -1373,6 +1528,7 @@ void GFX_SetShader(const char* src) {
 
 	sdl.opengl.shader_src = src;
 	if (sdl.opengl.program_object) {
+		presenter.Stop();
 		glDeleteProgram(sdl.opengl.program_object);
 		sdl.opengl.program_object = 0;
 	}
@@ -1592,16 +1748,40 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 		return;
 	bool actually_updating = sdl.updating;
 	sdl.updating=false;
+	const bool new_frame = actually_updating && changedLines;
+	if (new_frame)
+		frame_stats.emulated++;
 	switch (sdl.desktop.type) {
 	case SCREEN_TEXTURE:
 		assert(sdl.texture.input_surface);
-		SDL_UpdateTexture(sdl.texture.texture,
-		                  nullptr, // update entire texture
-		                  sdl.texture.input_surface->pixels,
-		                  sdl.texture.input_surface->pitch);
+		if (changedLines) {
+			// Upload only the bands of lines the renderer changed
+			const int pitch = sdl.texture.input_surface->pitch;
+			const Bit8u *pixels = static_cast<Bit8u *>(sdl.texture.input_surface->pixels);
+			int y = 0;
+			size_t index = 0;
+			while (y < sdl.draw.height) {
+				const int height = changedLines[index];
+				if (index & 1) {
+					const SDL_Rect rect = {0, y, sdl.draw.width,
+					                       std::min(height, sdl.draw.height - y)};
+					SDL_UpdateTexture(sdl.texture.texture, &rect,
+					                  pixels + y * pitch, pitch);
+				}
+				y += height;
+				index++;
+			}
+		} else {
+			SDL_UpdateTexture(sdl.texture.texture,
+			                  nullptr, // update entire texture
+			                  sdl.texture.input_surface->pixels,
+			                  sdl.texture.input_surface->pitch);
+		}
 		SDL_RenderClear(sdl.renderer);
 		SDL_RenderCopy(sdl.renderer, sdl.texture.texture, NULL, &sdl.clip);
 		SDL_RenderPresent(sdl.renderer);
+		if (new_frame)
+			frame_stats.presented++;
 		break;
 #if C_OPENGL
 	case SCREEN_OPENGL:
@@ -1613,7 +1793,15 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 			 * with VSync...
 			 * (Think of 60Hz on the host with 70Hz on the client.)
 			 */
-			sdl.opengl.actual_frame_count++;
+			if (presenter.IsRunning())
+				presenter.Tick();
+			else
+				sdl.opengl.actual_frame_count++;
+			return;
+		}
+		if (presenter.IsRunning()) {
+			if (changedLines)
+				presenter.Submit(static_cast<uint8_t *>(sdl.opengl.framebuf));
 			return;
 		}
 		glClearColor (0.0f, 0.0f, 0.0f, 1.0f);
@@ -1646,13 +1834,9 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 			return;
 		}
 
-		if (sdl.opengl.program_object) {
-			glUniform1i(sdl.opengl.ruby.frame_count, sdl.opengl.actual_frame_count++);
-			glDrawArrays(GL_TRIANGLES, 0, 3);
-		} else {
-			glCallList(sdl.opengl.displaylist);
-		}
-		SDL_GL_SwapWindow(sdl.window);
+		DrawGLFrame();
+		if (new_frame)
+			frame_stats.presented++;
 		break;
 #endif
 	case SCREEN_SURFACE:
@@ -1678,6 +1862,8 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 				                             sdl.updateRects,
 				                             rect_count);
 		}
+		if (new_frame)
+			frame_stats.presented++;
 		break;
 	}
 }
@@ -1749,6 +1935,7 @@ static void CleanupSDLResources()
 		sdl.renderer = nullptr;
 	}
 #if C_OPENGL
+	presenter.Stop();
 	if (sdl.opengl.context) {
 		SDL_GL_DeleteContext(sdl.opengl.context);
 		sdl.opengl.context = 0;
@@ -1766,6 +1953,11 @@ static void GUI_ShutDown(Section *)
 	if (mouse_is_captured)
 		GFX_ToggleMouseCapture();
 	CleanupSDLResources();
+
+	LOG_MSG("SDL: Frames emulated: %llu, presented: %llu, dropped: %llu",
+	        static_cast<unsigned long long>(frame_stats.emulated),
+	        static_cast<unsigned long long>(frame_stats.presented),
+	        static_cast<unsigned long long>(frame_stats.dropped));
 }
 
 static void SetPriority(PRIORITY_LEVELS level)
@@ -2327,6 +2519,11 @@ static void GUI_StartUp(Section *sec)
 #ifdef DB_DISABLE_DBO
 			sdl.opengl.pixel_buffer_object = false;
 #endif
+			// The presenter thread owns the context, so the emulation
+			// can't map a buffer object; it renders to memory instead
+			sdl.opengl.use_presenter = section->Get_bool("presenter_thread");
+			if (sdl.opengl.use_presenter)
+				sdl.opengl.pixel_buffer_object = false;
 			LOG_MSG("OPENGL: Pixel buffer object extension: %s",
 			        sdl.opengl.pixel_buffer_object ? "available"
 			                                       : "missing");
@@ -2490,8 +2687,12 @@ static void HandleVideoResize(int width, int height)
 
 #if C_OPENGL
 	if (sdl.desktop.window.resizable && sdl.desktop.type == SCREEN_OPENGL) {
+		const bool was_presenting = presenter.IsRunning();
+		presenter.Stop();
 		sdl.clip = calc_viewport(width, height);
 		glViewport(sdl.clip.x, sdl.clip.y, sdl.clip.w, sdl.clip.h);
+		if (was_presenting)
+			presenter.Start();
 		return;
 	}
 #endif
@@ -2943,6 +3144,13 @@ void Config_Add_SDL() {
 	                  "Use texture_renderer=auto for an automatic choice.");
 	pstring->Set_values(Get_SDL_TextureRenderers());
 
+#if C_OPENGL
+	pbool = sdl_sec->Add_bool("presenter_thread", on_start, false);
+	pbool->Set_help("Present frames from a separate thread, so slow buffer swaps\n"
+	                "don't hold up the emulation (output=opengl* only).\n"
+	                "Frames the screen can't keep up with are skipped.");
+#endif
+
 	// Define mouse control settings
 	Pmulti = sdl_sec->Add_multi("capture_mouse", always, " ");
 	const char *mouse_controls[] = {
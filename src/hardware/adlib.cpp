@@ -742,6 +742,10 @@ static Adlib::Module* module = 0;
 
 static void OPL_CallBack(Bitu len) {
 	module->handler->Generate( module->mixerChan, len );
+}
+
+// Runs on the emulation thread once the mixer has taken the generated samples
+static void OPL_AfterCallBack() {
 	//Disable the sound generation after 30 seconds of silence
 	if ((PIC_Ticks - module->lastUsed) > 30000) {
 		Bitu i;
@@ -860,6 +864,8 @@ Module::Module(Section *configuration)
 	ctrl.mixer = section->Get_bool("sbmixer");
 
 	mixerChan = mixerObject.Install(OPL_CallBack, 0, "FM");
+	// The emulators only touch their own chip state while generating
+	mixerChan->EnableThreadedRendering(OPL_AfterCallBack);
 	//Used to be 2.0, which was measured to be too high. Exact value depends on card/clone.
 	mixerChan->SetScale( 1.5f );  
 
@@ -41,45 +41,72 @@ static void UpdateEMSMapping(void) {
 	}
 }
 
-/* read a block from physical memory */
+/* care for EMS pageframe etc. */
+static inline Bitu DMA_TranslatePage(Bitu page) {
+	if (page < EMM_PAGEFRAME4K) return paging.firstmb[page];
+	else if (page < EMM_PAGEFRAME4K+0x10) return ems_board_mapping[page];
+	else if (page < LINK_START) return paging.firstmb[page];
+	return page;
+}
+
+/* Bytes of a transfer at offset that can be done in one go: up to the end of
+   the page or the wrap, whichever comes first, and no more than size */
+static inline Bitu DMA_RunLength(PhysPt offset,Bit32u dma_wrap,Bitu size) {
+	Bitu run = MEM_PAGE_SIZE - (offset & (MEM_PAGE_SIZE-1));
+	const Bitu to_wrap = dma_wrap - offset;
+	if (run - 1 > to_wrap) run = to_wrap + 1;
+	return (run < size) ? run : size;
+}
+
+/* read a block from physical memory, a page at a time; data can be NULL
+   to only advance past it */
 static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
 	Bit8u * write=(Bit8u *) data;
 	Bitu highpart_addr_page = spage>>12;
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	const Bitu total_pages = MEM_TotalPages();
+	while (size) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (read): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
 		offset &= dma_wrap;
-		Bitu page = highpart_addr_page+(offset >> 12);
-		/* care for EMS pageframe etc. */
-		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
-		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
-		else if (page < LINK_START) page = paging.firstmb[page];
-		*write++=phys_readb(page*4096 + (offset & 4095));
+		const Bitu run = DMA_RunLength(offset,dma_wrap,size);
+		if (write) {
+			const Bitu page = DMA_TranslatePage(highpart_addr_page+(offset >> 12));
+			/* there's no memory behind pages past the end of RAM */
+			if (page < total_pages)
+				memcpy(write,MemBase + page*4096 + (offset & 4095),run);
+			else
+				memset(write,0xff,run);
+			write+=run;
+		}
+		size-=run;
+		offset+=run;
 	}
 }
 
-/* write a block into physical memory */
+/* write a block into physical memory, a page at a time */
 static void DMA_BlockWrite(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
 	Bit8u * read=(Bit8u *) data;
 	Bitu highpart_addr_page = spage>>12;
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	const Bitu total_pages = MEM_TotalPages();
+	while (size) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (write): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
 		offset &= dma_wrap;
-		Bitu page = highpart_addr_page+(offset >> 12);
-		/* care for EMS pageframe etc. */
-		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
-		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
-		else if (page < LINK_START) page = paging.firstmb[page];
-		phys_writeb(page*4096 + (offset & 4095), *read++);
+		const Bitu run = DMA_RunLength(offset,dma_wrap,size);
+		const Bitu page = DMA_TranslatePage(highpart_addr_page+(offset >> 12));
+		if (page < total_pages)
+			memcpy(MemBase + page*4096 + (offset & 4095),read,run);
+		read+=run;
+		size-=run;
+		offset+=run;
 	}
 }
 
@@ -300,8 +327,8 @@ again:
 		curraddr+=want;
 		currcnt-=want;
 	} else {
-		DMA_BlockRead(pagebase,curraddr,buffer,want,DMA16);
-		buffer+=left << DMA16;
+		DMA_BlockRead(pagebase,curraddr,buffer,left,DMA16);
+		if (buffer) buffer+=left << DMA16;
 		want-=left;
 		done+=left;
 		ReachedTC();
@@ -321,6 +348,29 @@ again:
 	return done;
 }
 
+Bitu DmaChannel::Peek(Bitu want, const Bit8u ** data) const {
+	*data=NULL;
+	Bitu left=(currcnt+1);
+	if (want>left) want=left;
+	Bitu size=want << DMA16;
+	Bitu highpart_addr_page = pagebase>>12;
+	Bit32u dma_wrap = ((0xffff<<DMA16)+DMA16) | dma_wrapping;
+	PhysPt offset = ((curraddr & dma_wrapping) << DMA16) & dma_wrap;
+	const Bitu total_pages = MEM_TotalPages();
+	Bitu page = DMA_TranslatePage(highpart_addr_page+(offset >> 12));
+	if (!size || page >= total_pages) return 0;
+	Bitu avail = DMA_RunLength(offset,dma_wrap,size);
+	/* carry on as long as the following pages come next in memory too */
+	while (avail<size && avail<=dma_wrap-offset) {
+		PhysPt next = offset+avail;
+		Bitu next_page = DMA_TranslatePage(highpart_addr_page+(next >> 12));
+		if (next_page != page+(((offset & 4095)+avail) >> 12) || next_page >= total_pages) break;
+		avail += DMA_RunLength(next,dma_wrap,size-avail);
+	}
+	*data = MemBase + page*4096 + (offset & 4095);
+	return avail >> DMA16;
+}
+
 Bitu DmaChannel::Write(Bitu want, Bit8u * buffer) {
 	Bitu done=0;
 	curraddr &= dma_wrapping;
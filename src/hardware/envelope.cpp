@@ -31,6 +31,7 @@ void Envelope::Reactivate()
 	edge = 0u;
 	frames_done = 0u;
 	process = &Envelope::Apply;
+	is_active = true;
 }
 
 void Envelope::Update(const uint32_t frame_rate,
@@ -103,6 +104,7 @@ void Envelope::Apply(const bool is_stereo,
 	// Should we deactivate the envelope?
 	if (++frames_done > expire_after_frames || edge >= edge_limit) {
 		process = &Envelope::Skip;
+		is_active = false;
 		(void)channel_name; // MAYBE_UNUSED in release builds
 		DEBUG_LOG_MSG("ENVELOPE: %s done after %u frames, peak sample was %u",
 		              channel_name, frames_done, edge);
@@ -226,10 +226,12 @@ private:
 	Gus &operator=(const Gus &) = delete; // prevent assignment
 
 	void ActivateVoices(uint8_t requested_voices);
+	void AfterAudioCallback();
 	void AudioCallback(uint16_t requested_frames);
 	void BeginPlayback();
 	void CheckIrq();
 	void CheckVoiceIrq();
+	bool UpdateVoiceIrqStatus();
 	uint32_t Dma8Addr() noexcept;
 	uint32_t Dma16Addr() noexcept;
 	void DmaCallback(DmaChannel *chan, DMAEvent event);
@@ -311,6 +313,7 @@ private:
 	bool dac_enabled = false;
 	bool irq_enabled = false;
 	bool is_running = false;
+	bool has_pending_voice_irq = false; // raised by the audio callback
 	bool should_change_irq_dma = false;
 };
 
@@ -605,6 +608,10 @@ Gus::Gus(uint16_t port, uint8_t dma, uint8_t irq, const std::string &ultradir)
 	// Let the mixer command adjust the GUS's internal amplitude level's
 	const auto set_level_callback = std::bind(&Gus::SetLevelCallback, this, _1);
 	audio_channel->RegisterLevelCallBack(set_level_callback);
+	// Voice rendering only touches the GUS's own state, so it can run on
+	// the mixer's threads; IRQs are raised after the mix instead
+	const auto after_callback = std::bind(&Gus::AfterAudioCallback, this);
+	audio_channel->EnableThreadedRendering(after_callback);
 
 	UpdateDmaAddress(dma);
 
@@ -656,11 +663,23 @@ void Gus::AudioCallback(const uint16_t requested_frames)
 		}
 		soft_limiter.Process(render_buffer, frames, play_buffer);
 		audio_channel->AddSamples_s16(frames, play_buffer.data());
-		CheckVoiceIrq();
+		if (UpdateVoiceIrqStatus())
+			has_pending_voice_irq = true;
 		generated_frames += frames;
 	}
 }
 
+// Raises the voice IRQ, if the audio callback found one, once the mixer is
+// done with the channel. The voice status bits only accumulate during the
+// callback, so checking once here matches checking after every block.
+void Gus::AfterAudioCallback()
+{
+	if (!has_pending_voice_irq)
+		return;
+	has_pending_voice_irq = false;
+	CheckIrq();
+}
+
 void Gus::BeginPlayback()
 {
 	dac_enabled = ((register_data & 0x200) != 0);
@@ -695,22 +714,30 @@ bool Gus::CheckTimer(const size_t t)
 }
 
 void Gus::CheckVoiceIrq()
+{
+	if (UpdateVoiceIrqStatus())
+		CheckIrq();
+}
+
+// Updates the voice IRQ status bits, returning true if the IRQ lines should
+// be checked
+bool Gus::UpdateVoiceIrqStatus()
 {
 	irq_status &= 0x9f;
 	const Bitu totalmask = (voice_irq.vol_state | voice_irq.wave_state) &
 	                       active_voice_mask;
 	if (!totalmask)
-		return;
+		return false;
 	if (voice_irq.vol_state)
 		irq_status |= 0x40;
 	if (voice_irq.wave_state)
 		irq_status |= 0x20;
-	CheckIrq();
 	while (!(totalmask & 1ULL << voice_irq.status)) {
 		voice_irq.status++;
 		if (voice_irq.status >= active_voices)
 			voice_irq.status = 0;
 	}
+	return true;
 }
 
 uint32_t Gus::Dma8Addr() noexcept
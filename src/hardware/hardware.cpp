@@ -18,10 +18,15 @@
 
 #include "hardware.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <memory>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 #include "cross.h"
 #include "dosbox.h"
@@ -31,6 +36,7 @@
 #include "pic.h"
 #include "render.h"
 #include "setup.h"
+#include "spsc_ring.h"
 #include "string_utils.h"
 #include "support.h"
 
@@ -46,6 +52,23 @@ Bitu CaptureState;
 #define WAVE_BUF 16*1024
 #define MIDI_BUF 4*1024
 #define AVI_HEADER_SIZE	500
+#define AVI_KEYFRAME_INTERVAL 300
+#define CAPTURE_PALETTE_SIZE (256 * 4)
+
+#if (C_SSHOT)
+/* Video frames travel to the encoder thread as one flat buffer: this header
+ * followed by the palette, the undoubled source rows and the audio gathered
+ * since the previous queued frame. */
+struct CaptureFrameHeader {
+	Bitu width, height, bpp, flags;
+	Bitu row_bytes;    // bytes per source row as stored in the buffer
+	Bitu audio_frames; // stereo 16-bit frames following the rows
+	Bitu skipped;      // frames dropped in front of this one
+	bool end;          // no frame; tells the encoder to finish up
+};
+
+typedef SPSCRing<std::vector<Bit8u>> CaptureFrameQueue;
+#endif
 
 static struct {
 	struct {
@@ -80,10 +103,26 @@ static struct {
 		void		*buf;
 		Bit8u		*index;
 		Bitu		indexsize, indexused;
+		Bitu		lastkeyframe;
+		Bitu		queue_frames;
+		bool		overflow_wait;
+		Bitu		skipped;
+		/* Counters, reported when the recording stops */
+		Bitu		queued, dropped, stalls, peak_queued;
 	} video;
 #endif
 } capture;
 
+#if (C_SSHOT)
+/* While it runs, the encoder thread owns the codec, buf, index, frames,
+ * lastkeyframe, written and audiowritten fields of capture.video */
+static struct {
+	std::unique_ptr<CaptureFrameQueue> queue = {};
+	std::thread thread = {};
+	std::atomic_bool failed{false};
+} video_encoder;
+#endif
+
 FILE * OpenCaptureFile(const char * type,const char * ext) {
 	if(capturedir.empty()) {
 		LOG_MSG("Please specify a capture directory");
@@ -170,13 +209,166 @@ static void CAPTURE_AddAviChunk(const char * tag, Bit32u size, void * data, Bit3
 #endif
 
 #if (C_SSHOT)
+/* Frames that were dropped while the encoder was behind are stored as empty
+ * chunks, which players show as a repeat of the previous frame */
+static void CAPTURE_AddDroppedFrames(Bitu count) {
+	for (Bitu i = 0; i < count; i++) {
+		CAPTURE_AddAviChunk("00dc", 0, nullptr, 0);
+		capture.video.frames++;
+	}
+}
+
+static bool CAPTURE_EncodeFrame(const CaptureFrameHeader &header, const Bit8u *payload) {
+	const Bit8u *pal = payload;
+	const Bit8u *data = pal + CAPTURE_PALETTE_SIZE;
+	const Bit8u *audio = data + header.row_bytes * ((header.flags & CAPTURE_FLAG_DBLH) ? header.height / 2 : header.height);
+	Bit8u doubleRow[SCALER_MAXWIDTH*4];
+	zmbv_format_t format;
+	switch (header.bpp) {
+	case 8:format = ZMBV_FORMAT_8BPP;break;
+	case 15:format = ZMBV_FORMAT_15BPP;break;
+	case 16:format = ZMBV_FORMAT_16BPP;break;
+	default:format = ZMBV_FORMAT_32BPP;break;
+	}
+	CAPTURE_AddDroppedFrames(header.skipped);
+	int codecFlags = 0;
+	if (capture.video.frames == 0 ||
+	    capture.video.frames - capture.video.lastkeyframe >= AVI_KEYFRAME_INTERVAL)
+		codecFlags = 1;
+	if (!capture.video.codec->PrepareCompressFrame( codecFlags, format, (char *)pal, capture.video.buf, capture.video.bufSize))
+		return false;
+
+	for (Bitu i=0;i<header.height;i++) {
+		void * rowPointer;
+		const Bit8u *srcLine = data + ((header.flags & CAPTURE_FLAG_DBLH) ? (i >> 1) : i) * header.row_bytes;
+		if (header.flags & CAPTURE_FLAG_DBLW) {
+			Bitu x;
+			Bitu countWidth = header.width >> 1;
+			switch (header.bpp) {
+			case 8:
+				for (x=0;x<countWidth;x++)
+					((Bit8u *)doubleRow)[x*2+0] =
+					((Bit8u *)doubleRow)[x*2+1] = ((const Bit8u *)srcLine)[x];
+				break;
+			case 15:
+			case 16:
+				for (x=0;x<countWidth;x++)
+					((Bit16u *)doubleRow)[x*2+0] =
+					((Bit16u *)doubleRow)[x*2+1] = ((const Bit16u *)srcLine)[x];
+				break;
+			case 32:
+				for (x=0;x<countWidth;x++)
+					((Bit32u *)doubleRow)[x*2+0] =
+					((Bit32u *)doubleRow)[x*2+1] = ((const Bit32u *)srcLine)[x];
+				break;
+			}
+			rowPointer=doubleRow;
+		} else {
+			rowPointer=const_cast<Bit8u *>(srcLine);
+		}
+		capture.video.codec->CompressLines( 1, &rowPointer );
+	}
+	int written = capture.video.codec->FinishCompressFrame();
+	if (written < 0)
+		return false;
+	CAPTURE_AddAviChunk( "00dc", written, capture.video.buf, codecFlags & 1 ? 0x10 : 0x0);
+	if (codecFlags & 1)
+		capture.video.lastkeyframe = capture.video.frames;
+	capture.video.frames++;
+	if (header.audio_frames) {
+		CAPTURE_AddAviChunk( "01wb", header.audio_frames * 4, const_cast<Bit8u *>(audio), 0);
+		capture.video.audiowritten += header.audio_frames * 4;
+	}
+	return true;
+}
+
+static void CAPTURE_EncodeVideo() {
+	CaptureFrameQueue &queue = *video_encoder.queue;
+	while (std::vector<Bit8u> *frame = queue.AcquireRead()) {
+		CaptureFrameHeader header;
+		memcpy(&header, frame->data(), sizeof(header));
+		if (header.end) {
+			CAPTURE_AddDroppedFrames(header.skipped);
+			queue.ReleaseRead();
+			break;
+		}
+		/* After a failure keep draining so the producer never stalls */
+		if (!video_encoder.failed &&
+		    !CAPTURE_EncodeFrame(header, frame->data() + sizeof(header)))
+			video_encoder.failed = true;
+		queue.ReleaseRead();
+	}
+}
+
+// Returns a zeroed header at the start of a free queue slot, or nullptr when
+// the frame should be dropped because the encoder is behind
+static CaptureFrameHeader *CAPTURE_QueueFrame(Bitu payload_size) {
+	CaptureFrameQueue &queue = *video_encoder.queue;
+	/* Dropped frames leave their audio behind for the next queued frame;
+	 * once that backlog gets large stall instead so no audio is lost */
+	const bool wait = capture.video.overflow_wait ||
+	                  capture.video.audioused > WAVE_BUF / 2;
+	std::vector<Bit8u> *frame = queue.AcquireWrite(false);
+	if (!frame) {
+		if (!wait)
+			return nullptr;
+		capture.video.stalls++;
+		frame = queue.AcquireWrite(true);
+		if (!frame)
+			return nullptr;
+	}
+	frame->resize(sizeof(CaptureFrameHeader) + payload_size);
+	CaptureFrameHeader *header = reinterpret_cast<CaptureFrameHeader *>(frame->data());
+	memset(header, 0, sizeof(*header));
+	return header;
+}
+
+/* The emulator and the encoder thread already keep two cores busy, so the
+ * motion search only gets the cores beyond those */
+static int CAPTURE_SearchThreads() {
+	const int cores = static_cast<int>(std::thread::hardware_concurrency());
+	return std::max(1, std::min(cores - 2, 4));
+}
+
+static void CAPTURE_StartEncoder() {
+	video_encoder.queue.reset(new CaptureFrameQueue(capture.video.queue_frames));
+	video_encoder.failed = false;
+	capture.video.skipped = 0;
+	capture.video.queued = 0;
+	capture.video.dropped = 0;
+	capture.video.stalls = 0;
+	capture.video.peak_queued = 0;
+	video_encoder.thread = std::thread(CAPTURE_EncodeVideo);
+	set_thread_name(video_encoder.thread, "dosbox:capture");
+}
+
+// Lets the encoder finish every queued frame, then waits for it to exit
+static void CAPTURE_StopEncoder() {
+	if (!video_encoder.thread.joinable())
+		return;
+	std::vector<Bit8u> *frame = video_encoder.queue->AcquireWrite(true);
+	frame->assign(sizeof(CaptureFrameHeader), 0);
+	CaptureFrameHeader *header = reinterpret_cast<CaptureFrameHeader *>(frame->data());
+	header->skipped = capture.video.skipped;
+	header->end = true;
+	video_encoder.queue->CommitWrite();
+	video_encoder.thread.join();
+	video_encoder.queue.reset();
+}
+
 static void CAPTURE_VideoEvent(bool pressed) {
 	if (!pressed)
 		return;
 	if (CaptureState & CAPTURE_VIDEO) {
 		/* Close the video */
 		CaptureState &= ~CAPTURE_VIDEO;
-		LOG_MSG("Stopped capturing video.");	
+		CAPTURE_StopEncoder();
+		LOG_MSG("Stopped capturing video: %u frames, %u dropped, %u stalls, up to %u of %u frames queued.",
+		        static_cast<unsigned>(capture.video.frames),
+		        static_cast<unsigned>(capture.video.dropped),
+		        static_cast<unsigned>(capture.video.stalls),
+		        static_cast<unsigned>(capture.video.peak_queued),
+		        static_cast<unsigned>(capture.video.queue_frames));
 
 		Bit8u avi_header[AVI_HEADER_SIZE];
 		Bitu main_list;
@@ -502,6 +694,11 @@ skip_shot:
 		{
 			CAPTURE_VideoEvent(true);
 		}
+		/* Stop the recording if the encoder ran into trouble */
+		if (capture.video.handle && video_encoder.failed) {
+			LOG_MSG("Video encoding failed.");
+			CAPTURE_VideoEvent(true);
+		}
 		CaptureState &= ~CAPTURE_VIDEO;
 		switch (bpp) {
 		case 8:format = ZMBV_FORMAT_8BPP;break;
@@ -520,6 +717,7 @@ skip_shot:
 				goto skip_video;
 			if (!capture.video.codec->SetupCompress( width, height)) 
 				goto skip_video;
+			capture.video.codec->SetSearchThreads(CAPTURE_SearchThreads());
 			capture.video.bufSize = capture.video.codec->NeededSize(width, height, format);
 			capture.video.buf = malloc( capture.video.bufSize );
 			if (!capture.video.buf)
@@ -540,61 +738,38 @@ skip_shot:
 			capture.video.written = 0;
 			capture.video.audioused = 0;
 			capture.video.audiowritten = 0;
+			capture.video.lastkeyframe = 0;
+			CAPTURE_StartEncoder();
 		}
-		int codecFlags;
-		if (capture.video.frames % 300 == 0)
-			codecFlags = 1;
-		else codecFlags = 0;
-		if (!capture.video.codec->PrepareCompressFrame( codecFlags, format, (char *)pal, capture.video.buf, capture.video.bufSize))
-			goto skip_video;
-
-		for (i=0;i<height;i++) {
-			void * rowPointer;
-			if (flags & CAPTURE_FLAG_DBLW) {
-				void *srcLine;
-				Bitu x;
-				Bitu countWidth = width >> 1;
-				if (flags & CAPTURE_FLAG_DBLH)
-					srcLine=(data+(i >> 1)*pitch);
-				else
-					srcLine=(data+(i >> 0)*pitch);
-				switch ( bpp) {
-				case 8:
-					for (x=0;x<countWidth;x++)
-						((Bit8u *)doubleRow)[x*2+0] =
-						((Bit8u *)doubleRow)[x*2+1] = ((Bit8u *)srcLine)[x];
-					break;
-				case 15:
-				case 16:
-					for (x=0;x<countWidth;x++)
-						((Bit16u *)doubleRow)[x*2+0] =
-						((Bit16u *)doubleRow)[x*2+1] = ((Bit16u *)srcLine)[x];
-					break;
-				case 32:
-					for (x=0;x<countWidth;x++)
-						((Bit32u *)doubleRow)[x*2+0] =
-						((Bit32u *)doubleRow)[x*2+1] = ((Bit32u *)srcLine)[x];
-					break;
-				}
-                rowPointer=doubleRow;
-			} else {
-				if (flags & CAPTURE_FLAG_DBLH)
-					rowPointer=(data+(i >> 1)*pitch);
-				else
-					rowPointer=(data+(i >> 0)*pitch);
-			}
-			capture.video.codec->CompressLines( 1, &rowPointer );
-		}
-		int written = capture.video.codec->FinishCompressFrame();
-		if (written < 0)
-			goto skip_video;
-		CAPTURE_AddAviChunk( "00dc", written, capture.video.buf, codecFlags & 1 ? 0x10 : 0x0);
-		capture.video.frames++;
-//		LOG_MSG("Frame %d video %d audio %d",capture.video.frames, written, capture.video.audioused *4 );
-		if ( capture.video.audioused ) {
-			CAPTURE_AddAviChunk( "01wb", capture.video.audioused * 4, capture.video.audiobuf, 0);
-			capture.video.audiowritten = capture.video.audioused*4;
+		/* Hand a copy of the frame, palette and audio to the encoder */
+		const Bitu rows = (flags & CAPTURE_FLAG_DBLH) ? height / 2 : height;
+		const Bitu row_bytes = ((flags & CAPTURE_FLAG_DBLW) ? width / 2 : width) * ((bpp + 7) / 8);
+		const Bitu audio_frames = capture.video.audioused;
+		CaptureFrameHeader *header = CAPTURE_QueueFrame(CAPTURE_PALETTE_SIZE + rows * row_bytes + audio_frames * 4);
+		if (header) {
+			header->width = width;
+			header->height = height;
+			header->bpp = bpp;
+			header->flags = flags;
+			header->row_bytes = row_bytes;
+			header->audio_frames = audio_frames;
+			header->skipped = capture.video.skipped;
+			Bit8u *payload = reinterpret_cast<Bit8u *>(header + 1);
+			memcpy(payload, pal, CAPTURE_PALETTE_SIZE);
+			payload += CAPTURE_PALETTE_SIZE;
+			for (i = 0; i < rows; i++, payload += row_bytes)
+				memcpy(payload, data + i * pitch, row_bytes);
+			memcpy(payload, capture.video.audiobuf, audio_frames * 4);
+			video_encoder.queue->CommitWrite();
 			capture.video.audioused = 0;
+			capture.video.skipped = 0;
+			capture.video.queued++;
+			const Bitu pending = video_encoder.queue->Size();
+			if (pending > capture.video.peak_queued)
+				capture.video.peak_queued = pending;
+		} else {
+			capture.video.skipped++;
+			capture.video.dropped++;
 		}
 
 		/* Everything went okay, set flag again for next frame */
@@ -784,6 +959,10 @@ public:
 		Section_prop * section = static_cast<Section_prop *>(configuration);
 		Prop_path* proppath= section->Get_path("captures");
 		capturedir = proppath->realpath;
+#if (C_SSHOT)
+		capture.video.queue_frames = section->Get_int("capture_queue");
+		capture.video.overflow_wait = strcmp(section->Get_string("capture_overflow"), "wait") == 0;
+#endif
 		CaptureState = 0;
 		MAPPER_AddHandler(CAPTURE_WaveEvent, SDL_SCANCODE_F6,
 		                  PRIMARY_MOD, "recwave", "Rec. Audio");
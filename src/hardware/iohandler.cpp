@@ -32,8 +32,45 @@
 
 //#define ENABLE_PORTLOG
 
-std::unordered_map<io_port_t, IO_WriteHandler> io_writehandlers[IO_SIZES] = {};
-std::unordered_map<io_port_t, IO_ReadHandler> io_readhandlers[IO_SIZES] = {};
+// Port handlers are dispatched through flat, directly indexed tables holding
+// one entry per port for each access width, so an IN or OUT costs a single
+// array load followed by an indirect call.
+//
+// Each entry holds a call function and a context pointer to the slot that
+// owns the registered handler. A slot is shared by every port and width it
+// was registered for and is released once the last of them is freed or
+// overwritten. Handlers wrapping a plain function are called directly through
+// the function pointer kept in the slot, bypassing std::function. Ports
+// without a handler keep an empty entry and fall through to the default
+// handler, without allocating anything.
+
+using io_read_fn = io_val_t (*)(io_port_t port, Bitu iolen);
+using io_write_fn = void (*)(io_port_t port, io_val_t val, Bitu iolen);
+
+template <typename Handler, typename PlainFn>
+struct IO_HandlerSlot {
+	IO_HandlerSlot(Handler h, PlainFn p) : handler(std::move(h)), plain(p) {}
+
+	const Handler handler;
+	const PlainFn plain;
+	uint32_t refs = 0;
+};
+
+using IO_ReadSlot = IO_HandlerSlot<IO_ReadHandler, io_read_fn>;
+using IO_WriteSlot = IO_HandlerSlot<IO_WriteHandler, io_write_fn>;
+
+struct IO_ReadEntry {
+	io_val_t (*call)(const IO_ReadSlot *slot, io_port_t port, Bitu iolen);
+	IO_ReadSlot *slot;
+};
+
+struct IO_WriteEntry {
+	void (*call)(const IO_WriteSlot *slot, io_port_t port, io_val_t val, Bitu iolen);
+	IO_WriteSlot *slot;
+};
+
+static IO_ReadEntry io_read_table[IO_SIZES][IO_MAX_PORTS] = {};
+static IO_WriteEntry io_write_table[IO_SIZES][IO_MAX_PORTS] = {};
 
 void port_within_proposed(io_port_t port) {
 	assert(port < std::numeric_limits<io_port_t_proposed>::max());
@@ -43,37 +80,92 @@ void val_within_proposed(io_val_t val) {
 	assert(val <= std::numeric_limits<io_val_t_proposed>::max());
 }
 
-static io_val_t ReadBlocked(io_port_t /*port*/, Bitu /*iolen*/)
+// Wrap-around keeps split word and dword accesses at the top of the port
+// space inside the tables, as the 16-bit address bus would.
+static inline size_t port_index(io_port_t port)
+{
+	return port & (IO_MAX_PORTS - 1);
+}
+
+static io_val_t CallPlainRead(const IO_ReadSlot *slot, io_port_t port, Bitu iolen)
+{
+	return slot->plain(port, iolen);
+}
+
+static io_val_t CallWrappedRead(const IO_ReadSlot *slot, io_port_t port, Bitu iolen)
+{
+	return slot->handler(port, iolen);
+}
+
+static io_val_t CallBlockedRead(const IO_ReadSlot * /*slot*/,
+                                io_port_t /*port*/,
+                                Bitu /*iolen*/)
 {
 	return static_cast<io_val_t>(~0);
 }
 
-static void WriteBlocked(io_port_t /*port*/, io_val_t /*val*/, Bitu /*iolen*/)
+static void CallPlainWrite(const IO_WriteSlot *slot, io_port_t port, io_val_t val, Bitu iolen)
+{
+	slot->plain(port, val, iolen);
+}
+
+static void CallWrappedWrite(const IO_WriteSlot *slot, io_port_t port, io_val_t val, Bitu iolen)
+{
+	slot->handler(port, val, iolen);
+}
+
+static void CallBlockedWrite(const IO_WriteSlot * /*slot*/,
+                             io_port_t /*port*/,
+                             io_val_t /*val*/,
+                             Bitu /*iolen*/)
 {}
 
+// Drops the entry's reference on its slot and leaves the entry empty.
+template <typename Entry>
+static void ReleaseEntry(Entry &entry)
+{
+	if (entry.slot && --entry.slot->refs == 0)
+		delete entry.slot;
+	entry = {};
+}
+
+template <typename Entry, typename Call, typename Slot>
+static void AssignEntry(Entry &entry, Call call, Slot *slot)
+{
+	++slot->refs; // before release, in case the entry already owns slot
+	ReleaseEntry(entry);
+	entry.call = call;
+	entry.slot = slot;
+}
+
 static io_val_t ReadDefault(io_port_t port, Bitu iolen);
 static void WriteDefault(io_port_t port, io_val_t val, Bitu iolen);
 
 // The ReadPort and WritePort functions lookup and call the handler
 // at the desired port. If the port hasn't been assigned (and the
-// lookup is empty), then the default handler is assigned and called.
+// entry is empty), then the default handler is called.
 static io_val_t ReadPort(uint8_t req_bytes, io_port_t port)
 {
-	// Convert bytes to handler map index MB.0x1->0, MW.0x2->1, and MD.0x4->2
+	// Convert bytes to handler table index MB.0x1->0, MW.0x2->1, and MD.0x4->2
 	const uint8_t idx = req_bytes >> 1;
-	return io_readhandlers[idx].emplace(port, ReadDefault).first->second(port, req_bytes);
+	const IO_ReadEntry &entry = io_read_table[idx][port_index(port)];
+	if (GCC_UNLIKELY(!entry.call))
+		return ReadDefault(port, req_bytes);
+	return entry.call(entry.slot, port, req_bytes);
 }
 
 static void WritePort(uint8_t put_bytes, io_port_t port, io_val_t val)
 {
-	// Convert bytes to handler map index MB.0x1->0, MW.0x2->1, and MD.0x4->2
+	// Convert bytes to handler table index MB.0x1->0, MW.0x2->1, and MD.0x4->2
 	const uint8_t idx = put_bytes >> 1;
 
 	 // Convert bytes into a cut-off mask: 1->0xff, 2->0xffff, 4->0xffffff
 	const auto mask = (1ul << (put_bytes * 8)) - 1;
-	io_writehandlers[idx]
-	        .emplace(port, WriteDefault)
-	        .first->second(port, val & mask, put_bytes);
+	const IO_WriteEntry &entry = io_write_table[idx][port_index(port)];
+	if (GCC_UNLIKELY(!entry.call))
+		WriteDefault(port, val & mask, put_bytes);
+	else
+		entry.call(entry.slot, port, val & mask, put_bytes);
 }
 
 static io_val_t ReadDefault(io_port_t port, Bitu iolen)
@@ -84,7 +176,7 @@ static io_val_t ReadDefault(io_port_t port, Bitu iolen)
 	case 1:
 		LOG(LOG_IO, LOG_WARN)("IOBUS: Unexpected read from %04xh; blocking",
 		                      static_cast<uint32_t>(port));
-		io_readhandlers[0][port] = ReadBlocked;
+		io_read_table[0][port_index(port)] = {CallBlockedRead, nullptr};
 		return 0xff;
 	case 2: return ReadPort(IO_MB, port) | (ReadPort(IO_MB, port + 1) << 8);
 	case 4: return ReadPort(IO_MW, port) | (ReadPort(IO_MW, port + 2) << 16);
@@ -102,7 +194,7 @@ static void WriteDefault(io_port_t port, io_val_t val, Bitu iolen)
 		LOG(LOG_IO, LOG_WARN)("IOBUS: Unexpected write of %u to %04xh; blocking",
 		                      static_cast<uint32_t>(val),
 		                      static_cast<uint32_t>(port));
-		io_writehandlers[0][port] = WriteBlocked;
+		io_write_table[0][port_index(port)] = {CallBlockedWrite, nullptr};
 		break;
 	case 2:
 		WritePort(IO_MB, port, val);
@@ -119,24 +211,40 @@ void IO_RegisterReadHandler(io_port_t port, IO_ReadHandler handler, Bitu mask, B
 {
 	port_within_proposed(port);
 
+	const auto plain_ptr = handler.target<io_read_fn>();
+	const io_read_fn plain = plain_ptr ? *plain_ptr : nullptr;
+	const auto call = plain ? CallPlainRead : CallWrappedRead;
+	auto slot = new IO_ReadSlot(std::move(handler), plain);
+
 	while (range--) {
-		if (mask&IO_MB) io_readhandlers[0][port]=handler;
-		if (mask&IO_MW) io_readhandlers[1][port]=handler;
-		if (mask&IO_MD) io_readhandlers[2][port]=handler;
+		const auto idx = port_index(port);
+		if (mask&IO_MB) AssignEntry(io_read_table[0][idx], call, slot);
+		if (mask&IO_MW) AssignEntry(io_read_table[1][idx], call, slot);
+		if (mask&IO_MD) AssignEntry(io_read_table[2][idx], call, slot);
 		port++;
 	}
+	if (!slot->refs)
+		delete slot;
 }
 
 void IO_RegisterWriteHandler(io_port_t port, IO_WriteHandler handler, Bitu mask, Bitu range)
 {
 	port_within_proposed(port);
 
+	const auto plain_ptr = handler.target<io_write_fn>();
+	const io_write_fn plain = plain_ptr ? *plain_ptr : nullptr;
+	const auto call = plain ? CallPlainWrite : CallWrappedWrite;
+	auto slot = new IO_WriteSlot(std::move(handler), plain);
+
 	while (range--) {
-		if (mask&IO_MB) io_writehandlers[0][port]=handler;
-		if (mask&IO_MW) io_writehandlers[1][port]=handler;
-		if (mask&IO_MD) io_writehandlers[2][port]=handler;
+		const auto idx = port_index(port);
+		if (mask&IO_MB) AssignEntry(io_write_table[0][idx], call, slot);
+		if (mask&IO_MW) AssignEntry(io_write_table[1][idx], call, slot);
+		if (mask&IO_MD) AssignEntry(io_write_table[2][idx], call, slot);
 		port++;
 	}
+	if (!slot->refs)
+		delete slot;
 }
 
 void IO_FreeReadHandler(io_port_t port, Bitu mask, Bitu range)
@@ -144,12 +252,13 @@ void IO_FreeReadHandler(io_port_t port, Bitu mask, Bitu range)
 	port_within_proposed(port);
 
 	while (range--) {
+		const auto idx = port_index(port);
 		if (mask & IO_MB)
-			io_readhandlers[0].erase(port);
+			ReleaseEntry(io_read_table[0][idx]);
 		if (mask & IO_MW)
-			io_readhandlers[1].erase(port);
+			ReleaseEntry(io_read_table[1][idx]);
 		if (mask & IO_MD)
-			io_readhandlers[2].erase(port);
+			ReleaseEntry(io_read_table[2][idx]);
 		port++;
 	}
 }
@@ -159,12 +268,13 @@ void IO_FreeWriteHandler(io_port_t port, Bitu mask, Bitu range)
 	port_within_proposed(port);
 
 	while (range--) {
+		const auto idx = port_index(port);
 		if (mask & IO_MB)
-			io_writehandlers[0].erase(port);
+			ReleaseEntry(io_write_table[0][idx]);
 		if (mask & IO_MW)
-			io_writehandlers[1].erase(port);
+			ReleaseEntry(io_write_table[1][idx]);
 		if (mask & IO_MD)
-			io_writehandlers[2].erase(port);
+			ReleaseEntry(io_write_table[2][idx]);
 		port++;
 	}
 }
@@ -591,20 +701,22 @@ public:
 	}
 	~IO()
 	{
-		size_t total_bytes = 0u;
 		for (uint8_t i = 0; i < IO_SIZES; ++i) {
-			const size_t readers = io_readhandlers[i].size();
-			const size_t writers = io_writehandlers[i].size();
+			size_t readers = 0u;
+			size_t writers = 0u;
+			for (auto &entry : io_read_table[i]) {
+				readers += (entry.slot != nullptr);
+				ReleaseEntry(entry);
+			}
+			for (auto &entry : io_write_table[i]) {
+				writers += (entry.slot != nullptr);
+				ReleaseEntry(entry);
+			}
 			DEBUG_LOG_MSG("IOBUS: Releasing %lu read and %lu write %d-bit port handlers",
 			              readers, writers, 8 << i);
-			total_bytes += readers * sizeof(IO_ReadHandler) +
-			               sizeof(io_readhandlers[i]);
-			total_bytes += writers * sizeof(IO_WriteHandler) +
-			               sizeof(io_readhandlers[i]);
-			io_readhandlers[i].clear();
-			io_writehandlers[i].clear();
 		}
-		DEBUG_LOG_MSG("IOBUS: Handlers consumed %lu total bytes", total_bytes);
+		DEBUG_LOG_MSG("IOBUS: Handler tables consume %lu total bytes",
+		              sizeof(io_read_table) + sizeof(io_write_table));
 	}
 };
 
@@ -24,6 +24,7 @@
 #include "paging.h"
 #include "regs.h"
 
+#include <algorithm>
 #include <string.h>
 
 #define PAGES_IN_BLOCK	((1024*1024)/MEM_PAGE_SIZE)
@@ -173,22 +174,95 @@ void mem_strcpy(PhysPt dest,PhysPt src) {
 	mem_writeb_inline(dest,0);
 }
 
+/* The block transfer functions below move data a page at a time, using
+ * the host pointer from the TLB when the page is plain memory. Pages
+ * without one (device memory, code pages watched by the dynamic cores,
+ * or pages not yet in the TLB) go through the page handler one byte at a
+ * time; this may also fill in the TLB entry, so it is checked again for
+ * each byte until the page is done. */
+
+static INLINE Bitu bytes_left_in_page(PhysPt pt) {
+	return MEM_PAGE_SIZE - (pt & (MEM_PAGE_SIZE - 1));
+}
+
 void mem_memcpy(PhysPt dest,PhysPt src,Bitu size) {
-	while (size--) mem_writeb_inline(dest++,mem_readb_inline(src++));
+	while (size) {
+		const HostPt src_tlb = get_tlb_read(src);
+		const HostPt dest_tlb = get_tlb_write(dest);
+		if (!src_tlb || !dest_tlb) {
+			mem_writeb_inline(dest++,mem_readb_inline(src++));
+			size--;
+			continue;
+		}
+		const Bitu chunk = std::min({size, bytes_left_in_page(src), bytes_left_in_page(dest)});
+		const HostPt from = src_tlb + src;
+		const HostPt to = dest_tlb + dest;
+		if (to > from && to < from + chunk) {
+			/* Overlapping forward copy repeats the source pattern */
+			for (Bitu i = 0; i < chunk; i++)
+				to[i] = from[i];
+		} else {
+			memmove(to, from, chunk);
+		}
+		src += chunk;
+		dest += chunk;
+		size -= chunk;
+	}
+}
+
+size_t MEM_GetHostRuns(PhysPt pt, size_t size, bool for_write, MemHostRun *runs)
+{
+	size_t count = 0;
+	while (size) {
+		const HostPt tlb_addr = for_write ? get_tlb_write(pt) : get_tlb_read(pt);
+		const HostPt host = tlb_addr ? tlb_addr + pt : nullptr;
+		const size_t chunk = std::min(size, static_cast<size_t>(bytes_left_in_page(pt)));
+		MemHostRun *last = count ? &runs[count - 1] : nullptr;
+		const bool extends_last = last && (host ? last->host && last->host + last->size == host
+		                                        : !last->host);
+		if (extends_last) {
+			last->size += chunk;
+		} else {
+			runs[count++] = {host, pt, chunk};
+		}
+		pt += chunk;
+		size -= chunk;
+	}
+	return count;
 }
 
 void MEM_BlockRead(PhysPt pt,void * data,Bitu size) {
 	Bit8u * write=reinterpret_cast<Bit8u *>(data);
-	while (size--) {
-		*write++=mem_readb_inline(pt++);
+	while (size) {
+		const HostPt tlb_addr = get_tlb_read(pt);
+		if (!tlb_addr) {
+			*write++=mem_readb_inline(pt++);
+			size--;
+			continue;
+		}
+		const Bitu chunk = std::min(size, bytes_left_in_page(pt));
+		memcpy(write, tlb_addr + pt, chunk);
+		write += chunk;
+		pt += chunk;
+		size -= chunk;
 	}
 }
 
 void MEM_BlockWrite(PhysPt pt, const void *data, size_t size)
 {
 	const uint8_t *read = static_cast<const uint8_t *>(data);
-	while (size--) {
-		mem_writeb_inline(pt++,*read++);
+	while (size) {
+		const HostPt tlb_addr = get_tlb_write(pt);
+		if (!tlb_addr) {
+			mem_writeb_inline(pt++, *read++);
+			size--;
+			continue;
+		}
+		const size_t chunk = std::min(size, static_cast<size_t>(bytes_left_in_page(pt)));
+		memcpy(tlb_addr + pt, read, chunk);
+		read += chunk;
+		pt += chunk;
+		size -= chunk;
 	}
 }
 
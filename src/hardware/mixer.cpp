@@ -28,6 +28,11 @@
 #include <sys/types.h>
 #include <math.h>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 
 #if defined (WIN32)
 //Midi listing
@@ -51,6 +56,8 @@
 #include "hardware.h"
 #include "programs.h"
 #include "midi.h"
+#include "mix_kernels.h"
+#include "support.h"
 
 #define MIXER_SSIZE 4
 
@@ -106,12 +113,69 @@ static struct {
 
 Bit8u MixTemp[MIXER_BUFSIZE];
 
+// Accumulates 16-bit frames into a work buffer starting at mixpos,
+// splitting the run where the circular buffer wraps.
+static void mix_add_frames(int32_t (*work)[2],
+                           Bitu mixpos,
+                           const int16_t *data,
+                           Bitu frames,
+                           const bool stereo,
+                           const int32_t volmul[2])
+{
+	const Bitu samples_per_frame = stereo ? 2 : 1;
+	while (frames) {
+		mixpos &= MIXER_BUFMASK;
+		const Bitu run = std::min(frames, MIXER_BUFSIZE - mixpos);
+		if (stereo)
+			mix_add_stereo_s16(work[mixpos], data, run,
+			                   volmul[0], volmul[1]);
+		else
+			mix_add_mono_s16(work[mixpos], data, run,
+			                 volmul[0], volmul[1]);
+		data += run * samples_per_frame;
+		mixpos += run;
+		frames -= run;
+	}
+}
+
+// Converts frames from the work buffer into clipped 16-bit output,
+// optionally clearing them, and splitting the run where the buffer wraps.
+static void mix_read_frames(Bitu readpos, int16_t *output, Bitu frames, const bool clear)
+{
+	while (frames) {
+		readpos &= MIXER_BUFMASK;
+		const Bitu run = std::min(frames, MIXER_BUFSIZE - readpos);
+		if (clear)
+			mix_drain_to_s16(mixer.work[readpos], output, run * 2,
+			                 MIXER_VOLSHIFT);
+		else
+			mix_to_s16(mixer.work[readpos], output, run * 2,
+			           MIXER_VOLSHIFT);
+		output += run * 2;
+		readpos += run;
+		frames -= run;
+	}
+}
+
+// Clears frames from the work buffer, splitting the run where it wraps
+static void mix_clear_frames(Bitu pos, Bitu frames)
+{
+	while (frames) {
+		pos &= MIXER_BUFMASK;
+		const Bitu run = std::min(frames, MIXER_BUFSIZE - pos);
+		memset(mixer.work[pos], 0, run * sizeof(mixer.work[0]));
+		pos += run;
+		frames -= run;
+	}
+}
+
 MixerChannel::MixerChannel(MIXER_Handler _handler,
                            MAYBE_UNUSED Bitu _freq,
                            const char *_name)
         : name(_name),
           envelope(name),
-          handler(_handler)
+          handler(_handler),
+          work(mixer.work)
 {}
 
 MixerChannel * MIXER_AddChannel(MIXER_Handler handler, Bitu freq, const char * name) {
@@ -301,7 +365,15 @@ void MixerChannel::SetPeakAmplitude(const uint32_t peak)
 	                ENVELOPE_MAX_EXPANSION_OVER_MS, ENVELOPE_EXPIRES_AFTER_S);
 }
 
-void MixerChannel::Mix(Bitu _needed) {
+void MixerChannel::Mix(Bitu _needed)
+{
+	Render(_needed);
+	if (after_mix)
+		after_mix();
+}
+
+void MixerChannel::Render(Bitu _needed)
+{
 	needed=_needed;
 	while (is_enabled && needed > done) {
 		Bitu left = (needed - done);
@@ -311,6 +383,50 @@ void MixerChannel::Mix(Bitu _needed) {
 	}
 }
 
+void MixerChannel::EnableThreadedRendering(after_mix_callback_f after_mix_callback)
+{
+	after_mix = after_mix_callback;
+	is_threadable = true;
+}
+
+bool MixerChannel::CanRenderThreaded(const Bitu _needed) const
+{
+	return is_threadable && is_enabled && _needed > done;
+}
+
+// Renders into the channel's private buffer so it can run concurrently with
+// other channels. Runs on a worker thread.
+void MixerChannel::RenderThreaded(Bitu _needed)
+{
+	// The private buffer mirrors the work buffer's layout and is kept
+	// zeroed outside of the frames being rendered.
+	if (threaded_work.empty())
+		threaded_work.resize(MIXER_BUFSIZE * 2, 0);
+	work = reinterpret_cast<work_frame_t *>(threaded_work.data());
+	threaded_start = done;
+	Render(_needed);
+}
+
+// Adds the privately rendered frames into the work buffer and clears them.
+// Runs on the emulation thread after the workers are done.
+void MixerChannel::MergeThreaded()
+{
+	assert(work != mixer.work);
+	Bitu mixpos = mixer.pos + threaded_start;
+	for (Bitu frames = done - threaded_start; frames; --frames) {
+		mixpos &= MIXER_BUFMASK;
+		for (auto side = 0; side < 2; ++side) {
+			mixer.work[mixpos][side] = mix_wrapping_add(
+			        mixer.work[mixpos][side], work[mixpos][side]);
+			work[mixpos][side] = 0;
+		}
+		++mixpos;
+	}
+	work = mixer.work;
+	if (after_mix)
+		after_mix();
+}
+
 void MixerChannel::AddSilence()
 {
 	if (done < needed) {
@@ -335,7 +451,7 @@ void MixerChannel::AddSilence()
 				else next_sample[1] = 0;
 
 				mixpos &= MIXER_BUFMASK;
-				Bit32s* write = mixer.work[mixpos];
+				Bit32s* write = work[mixpos];
 
 				write[0] += prev_sample[0] * volmul[0];
 				write[1] += (stereo ? prev_sample[1] : prev_sample[0]) * volmul[1];
@@ -379,10 +495,55 @@ constexpr void fill_8to16_lut()
 #define MIXER_UPRAMP_STEPS 0
 #define MIXER_UPRAMP_SAVE 512
 
+// Native 16-bit samples at the mixer's rate map one-to-one onto output
+// frames, which lets us hand whole runs to the vectorized kernels. Each frame
+// plays the sample read before it, so the first frame is the held-over next
+// sample and the rest trail the incoming data by one.
+void MixerChannel::AddSamplesAtMixerRate(Bitu len, const int16_t *data, const bool stereo)
+{
+	assert(!interpolate && !envelope.IsActive());
+	last_samples_were_silence = false;
+	if (!len)
+		return;
+
+	prev_sample[0] = next_sample[0];
+	if (stereo)
+		prev_sample[1] = next_sample[1];
+
+	const Bitu mixpos = (mixer.pos + done) & MIXER_BUFMASK;
+	Bit32s *write = work[mixpos];
+	write[0] += prev_sample[0] * volmul[0];
+	write[1] += (stereo ? prev_sample[1] : prev_sample[0]) * volmul[1];
+	mix_add_frames(work, mixpos + 1, data, len - 1, stereo, volmul);
+	done += len;
+
+	// Leave the samples where the per-frame loop would have
+	const Bitu samples_per_frame = stereo ? 2 : 1;
+	const int16_t *last = data + (len - 1) * samples_per_frame;
+	if (len > 1) {
+		prev_sample[0] = last[-static_cast<Bits>(samples_per_frame)];
+		if (stereo)
+			prev_sample[1] = last[-1];
+	}
+	next_sample[0] = last[0];
+	if (stereo)
+		next_sample[1] = last[1];
+}
+
 template<class Type,bool stereo,bool signeddata,bool nativeorder>
 inline void MixerChannel::AddSamples(Bitu len, const Type* data) {
 	last_samples_were_stereo = stereo;
 
+	// Take the fast path when the per-frame loop below would read exactly
+	// one sample per frame and leave it untouched
+	if (std::is_same<Type, int16_t>::value && nativeorder && !interpolate &&
+	    freq_counter >= FREQ_NEXT && freq_counter < 2 * FREQ_NEXT &&
+	    channel_map[0] == 0 && channel_map[1] == 1 &&
+	    !envelope.IsActive() && MIXER_UPRAMP_STEPS == 0) {
+		AddSamplesAtMixerRate(len, reinterpret_cast<const int16_t *>(data), stereo);
+		return;
+	}
+
 	//Position where to write the data
 	Bitu mixpos = mixer.pos + done;
 	//Position in the incoming data
@@ -517,7 +678,7 @@ inline void MixerChannel::AddSamples(Bitu len, const Type* data) {
 
 		//Where to write
 		mixpos &= MIXER_BUFMASK;
-		Bit32s* write = mixer.work[mixpos];
+		Bit32s* write = work[mixpos];
 		if (!interpolate) {
 			write[0] += prev_sample[left_map] * volmul[0];
 			write[1] += (stereo ? prev_sample[right_map] : prev_sample[left_map]) * volmul[1];
@@ -564,8 +725,8 @@ void MixerChannel::AddStretched(Bitu len,Bit16s * data) {
 		index += index_add;
 		mixpos &= MIXER_BUFMASK;
 		Bits sample = prev_sample[0] + ((diff * diff_mul) >> FREQ_SHIFT);
-		mixer.work[mixpos][0] += sample * volmul[0];
-		mixer.work[mixpos][1] += sample * volmul[1];
+		work[mixpos][0] += sample * volmul[0];
+		work[mixpos][1] += sample * volmul[1];
 		mixpos++;
 	}
 }
@@ -648,26 +809,168 @@ static Bit32u calc_tickadd(Bit32u freq) {
 #endif
 }
 
+// A small pool of threads that render the channels which opted into
+// threaded rendering. The emulation thread hands over a batch, renders the
+// remaining channels itself, then helps finish the batch and waits for it.
+class MixerWorkers {
+public:
+	MixerWorkers() = default;
+	MixerWorkers(const MixerWorkers &) = delete; // prevent copying
+	MixerWorkers &operator=(const MixerWorkers &) = delete; // prevent assignment
+	~MixerWorkers() { Stop(); }
+
+	bool IsRunning() const { return !threads.empty(); }
+
+	void Start(const int num_threads)
+	{
+		Stop();
+		for (int i = 0; i < num_threads; ++i) {
+			threads.emplace_back(&MixerWorkers::Work, this);
+			set_thread_name(threads.back(), "dosbox:mixer");
+		}
+	}
+
+	void Stop()
+	{
+		{
+			const std::lock_guard<std::mutex> lock(mutex);
+			should_quit = true;
+		}
+		has_batch.notify_all();
+		for (auto &thread : threads)
+			thread.join();
+		threads.clear();
+		should_quit = false;
+	}
+
+	void Submit(const std::vector<MixerChannel *> &channels, const Bitu needed)
+	{
+		assert(remaining_jobs == 0);
+		{
+			// Workers that were late to the previous batch may still be
+			// looking at it, so let them finish before replacing it
+			std::unique_lock<std::mutex> lock(mutex);
+			batch_done.wait(lock, [this]() { return active_workers == 0; });
+			batch = channels;
+			batch_needed = needed;
+			next_job = 0;
+			remaining_jobs = batch.size();
+			++batch_id;
+		}
+		has_batch.notify_all();
+	}
+
+	void Wait()
+	{
+		while (RunNextJob())
+			;
+		std::unique_lock<std::mutex> lock(mutex);
+		batch_done.wait(lock, [this]() { return remaining_jobs == 0; });
+	}
+
+private:
+	// Claims and renders the next unclaimed channel in the batch
+	bool RunNextJob()
+	{
+		const auto job = next_job++;
+		if (job >= batch.size())
+			return false;
+		batch[job]->RenderThreaded(batch_needed);
+		if (--remaining_jobs == 0) {
+			{ const std::lock_guard<std::mutex> lock(mutex); }
+			batch_done.notify_all();
+		}
+		return true;
+	}
+
+	void Work()
+	{
+		uint64_t last_batch_id = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				has_batch.wait(lock, [&]() {
+					return should_quit || batch_id != last_batch_id;
+				});
+				if (should_quit)
+					return;
+				last_batch_id = batch_id;
+				++active_workers;
+			}
+			while (RunNextJob())
+				;
+			{
+				const std::lock_guard<std::mutex> lock(mutex);
+				--active_workers;
+			}
+			batch_done.notify_all();
+		}
+	}
+
+	std::vector<std::thread> threads = {};
+	std::mutex mutex = {};
+	std::condition_variable has_batch = {};
+	std::condition_variable batch_done = {};
+	std::vector<MixerChannel *> batch = {};
+	Bitu batch_needed = 0;
+	std::atomic<size_t> next_job{0};
+	std::atomic<size_t> remaining_jobs{0};
+	uint64_t batch_id = 0;
+	int active_workers = 0;
+	bool should_quit = false;
+};
+
+static MixerWorkers mixer_workers;
+
+// Renders the threadable channels on the workers while this thread renders
+// the rest. Each threaded channel accumulates into its own buffer, which is
+// then added in channel order; because the sums wrap at 32 bits the result
+// is identical to rendering every channel serially.
+static void MIXER_RenderThreaded(Bitu needed)
+{
+	static std::vector<MixerChannel *> threaded = {};
+	threaded.clear();
+	for (auto chan = mixer.channels; chan; chan = chan->next)
+		if (chan->CanRenderThreaded(needed))
+			threaded.push_back(chan);
+
+	if (threaded.empty()) {
+		for (auto chan = mixer.channels; chan; chan = chan->next)
+			chan->Mix(needed);
+		return;
+	}
+
+	mixer_workers.Submit(threaded, needed);
+	for (auto chan = mixer.channels; chan; chan = chan->next)
+		if (std::find(threaded.begin(), threaded.end(), chan) == threaded.end())
+			chan->Mix(needed);
+	mixer_workers.Wait();
+
+	for (auto chan : threaded)
+		chan->MergeThreaded();
+}
+
 /* Mix a certain amount of new samples */
 static void MIXER_MixData(Bitu needed) {
-	MixerChannel * chan=mixer.channels;
-	while (chan) {
-		chan->Mix(needed);
-		chan=chan->next;
+	if (mixer_workers.IsRunning()) {
+		MIXER_RenderThreaded(needed);
+	} else {
+		MixerChannel *chan = mixer.channels;
+		while (chan) {
+			chan->Mix(needed);
+			chan = chan->next;
+		}
 	}
 	if (CaptureState & (CAPTURE_WAVE|CAPTURE_VIDEO)) {
 		int16_t convert[1024][2];
 		const size_t added = std::min<size_t>(needed - mixer.done, 1024);
-		size_t readpos = (mixer.pos + mixer.done) & MIXER_BUFMASK;
+		mix_read_frames(mixer.pos + mixer.done, convert[0], added, false);
+#if defined(WORDS_BIGENDIAN)
 		for (size_t i = 0; i < added; i++) {
-			const int32_t sample_1 = mixer.work[readpos][0] >> MIXER_VOLSHIFT;
-			const int32_t sample_2 = mixer.work[readpos][1] >> MIXER_VOLSHIFT;
-			const int16_t s1 = MIXER_CLIP(sample_1);
-			const int16_t s2 = MIXER_CLIP(sample_2);
-			convert[i][0] = host_to_le16(s1);
-			convert[i][1] = host_to_le16(s2);
-			readpos = (readpos + 1) & MIXER_BUFMASK;
+			convert[i][0] = host_to_le16(convert[i][0]);
+			convert[i][1] = host_to_le16(convert[i][1]);
 		}
+#endif
 		CAPTURE_AddWave(mixer.freq, added, reinterpret_cast<int16_t*>(convert));
 	}
 	//Reset the the tick_add for constant speed
@@ -690,11 +993,8 @@ static void MIXER_Mix_NoSound()
 {
 	MIXER_MixData(mixer.needed);
 	/* Clear piece we've just generated */
-	for (Bitu i=0;i<mixer.needed;i++) {
-		mixer.work[mixer.pos][0]=0;
-		mixer.work[mixer.pos][1]=0;
-		mixer.pos=(mixer.pos+1)&MIXER_BUFMASK;
-	}
+	mix_clear_frames(mixer.pos, mixer.needed);
+	mixer.pos = (mixer.pos + mixer.needed) & MIXER_BUFMASK;
 	/* Reduce count in channels */
 	for (MixerChannel * chan=mixer.channels;chan;chan=chan->next) {
 		if (chan->done>mixer.needed) chan->done-=mixer.needed;
@@ -799,30 +1099,18 @@ static void SDLCALL MIXER_CallBack(MAYBE_UNUSED void *userdata, Uint8 *stream, i
 			*output++=MIXER_CLIP(sample);
 		}
 		/* Clean the used buffer */
-		while (reduce--) {
-			pos &= MIXER_BUFMASK;
-			mixer.work[pos][0]=0;
-			mixer.work[pos][1]=0;
-			pos++;
-		}
+		mix_clear_frames(pos, reduce);
 	} else {
-		while (reduce--) {
-			pos &= MIXER_BUFMASK;
-			sample=mixer.work[pos][0]>>MIXER_VOLSHIFT;
-			*output++=MIXER_CLIP(sample);
-			sample=mixer.work[pos][1]>>MIXER_VOLSHIFT;
-			*output++=MIXER_CLIP(sample);
-			mixer.work[pos][0]=0;
-			mixer.work[pos][1]=0;
-			pos++;
-		}
+		mix_read_frames(pos, output, reduce, true);
 	}
 }
 
 #undef INDEX_SHIFT_LOCAL
 
 static void MIXER_Stop(MAYBE_UNUSED Section *sec)
-{}
+{
+	mixer_workers.Stop();
+}
 
 class MIXER final : public Program {
 public:
@@ -923,6 +1211,13 @@ void MIXER_Init(Section* sec) {
 	mixer.freq = static_cast<uint32_t>(section->Get_int("rate"));
 	mixer.blocksize = static_cast<uint16_t>(section->Get_int("blocksize"));
 
+	const auto num_threads = section->Get_int("threads");
+	if (num_threads > 0) {
+		mixer_workers.Start(num_threads);
+		LOG_MSG("MIXER: Rendering supported devices on %d worker thread%s",
+		        num_threads, num_threads > 1 ? "s" : "");
+	}
+
 	/* Initialize the internal stuff */
 	mixer.channels=0;
 	mixer.pos=0;
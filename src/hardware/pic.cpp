@@ -24,7 +24,10 @@
 #include "timer.h"
 #include "setup.h"
 
-#define PIC_QUEUESIZE 512
+#include <cassert>
+#include <limits>
+#include <unordered_map>
+#include <vector>
 
 struct PIC_Controller {
 	Bitu icw_words;
@@ -164,18 +167,202 @@ void PIC_Controller::start_irq(Bit8u val) {
 }
 
 
+// Scheduled events are kept in a binary min-heap ordered by their index (the
+// time they are due, in milliseconds relative to the current tick). Events
+// due at the same time keep the order they were added in. Entries live in a
+// growable pool and are referenced by slot number; entries sharing the same
+// handler are additionally chained together, so removing them by handler
+// only visits the matching events.
 struct PICEntry {
-	float index;
-	Bitu value;
-	PIC_EventHandler pic_event;
-	PICEntry * next;
+	float index = 0.0f;
+	Bitu value = 0;
+	PIC_EventHandler pic_event = nullptr;
+	uint64_t sequence = 0; // insertion order, breaks ties between indexes
+	uint32_t heap_pos = 0;
+	uint32_t prev_same = 0; // neighbours in the chain of the same handler
+	uint32_t next_same = 0;
+	uint32_t *chain_head = nullptr; // the chain's first slot, in handler_chains
 };
 
-static struct {
-	PICEntry entries[PIC_QUEUESIZE];
-	PICEntry * free_entry;
-	PICEntry * next_entry;
-} pic_queue;
+class PIC_EventQueue {
+public:
+	static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+	bool IsEmpty() const { return heap.empty(); }
+
+	const PICEntry &Top() const
+	{
+		assert(!heap.empty());
+		return pool[heap.front()];
+	}
+
+	void Add(PIC_EventHandler handler, float index, Bitu val);
+	void RemoveTop() { Remove(heap.front()); }
+	void RemoveEvents(PIC_EventHandler handler);
+	void RemoveSpecificEvents(PIC_EventHandler handler, Bitu val);
+	void ShiftIndexes(float amount);
+	void Clear();
+
+private:
+	bool IsBefore(uint32_t a, uint32_t b) const
+	{
+		const PICEntry &x = pool[a];
+		const PICEntry &y = pool[b];
+		return x.index < y.index ||
+		       (x.index == y.index && x.sequence < y.sequence);
+	}
+
+	void Place(uint32_t pos, uint32_t slot)
+	{
+		heap[pos] = slot;
+		pool[slot].heap_pos = pos;
+	}
+
+	void SiftUp(uint32_t pos);
+	void SiftDown(uint32_t pos);
+	void Remove(uint32_t slot);
+
+	std::vector<PICEntry> pool = {};
+	std::vector<uint32_t> free_slots = {};
+	std::vector<uint32_t> heap = {};
+	std::unordered_map<PIC_EventHandler, uint32_t> handler_chains = {};
+	uint64_t next_sequence = 0;
+};
+
+void PIC_EventQueue::SiftUp(uint32_t pos)
+{
+	const uint32_t slot = heap[pos];
+	while (pos > 0) {
+		const uint32_t parent = (pos - 1) / 2;
+		if (!IsBefore(slot, heap[parent]))
+			break;
+		Place(pos, heap[parent]);
+		pos = parent;
+	}
+	Place(pos, slot);
+}
+
+void PIC_EventQueue::SiftDown(uint32_t pos)
+{
+	const uint32_t slot = heap[pos];
+	const auto size = static_cast<uint32_t>(heap.size());
+	while (true) {
+		uint32_t child = 2 * pos + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && IsBefore(heap[child + 1], heap[child]))
+			++child;
+		if (!IsBefore(heap[child], slot))
+			break;
+		Place(pos, heap[child]);
+		pos = child;
+	}
+	Place(pos, slot);
+}
+
+void PIC_EventQueue::Add(PIC_EventHandler handler, float index, Bitu val)
+{
+	uint32_t slot;
+	if (free_slots.empty()) {
+		slot = static_cast<uint32_t>(pool.size());
+		pool.emplace_back();
+	} else {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	PICEntry &entry = pool[slot];
+	entry.index = index;
+	entry.value = val;
+	entry.pic_event = handler;
+	entry.sequence = next_sequence++;
+
+	// Link the entry at the head of its handler's chain. Handlers are
+	// static functions, so their chains are kept even once emptied. Map
+	// nodes never move, so the entry can point at its chain's head.
+	auto chain = handler_chains.find(handler);
+	if (chain == handler_chains.end())
+		chain = handler_chains.emplace(handler, none).first;
+	entry.chain_head = &chain->second;
+	entry.prev_same = none;
+	entry.next_same = chain->second;
+	if (entry.next_same != none)
+		pool[entry.next_same].prev_same = slot;
+	chain->second = slot;
+
+	heap.push_back(slot);
+	SiftUp(static_cast<uint32_t>(heap.size() - 1));
+}
+
+void PIC_EventQueue::Remove(uint32_t slot)
+{
+	PICEntry &entry = pool[slot];
+
+	// Unlink from the handler's chain
+	if (entry.prev_same != none)
+		pool[entry.prev_same].next_same = entry.next_same;
+	else
+		*entry.chain_head = entry.next_same;
+	if (entry.next_same != none)
+		pool[entry.next_same].prev_same = entry.prev_same;
+
+	// Fill the hole in the heap with its last element and restore order
+	const uint32_t pos = entry.heap_pos;
+	const uint32_t last = heap.back();
+	heap.pop_back();
+	if (last != slot) {
+		Place(pos, last);
+		if (pos > 0 && IsBefore(last, heap[(pos - 1) / 2]))
+			SiftUp(pos);
+		else
+			SiftDown(pos);
+	}
+	free_slots.push_back(slot);
+}
+
+void PIC_EventQueue::RemoveEvents(PIC_EventHandler handler)
+{
+	const auto chain = handler_chains.find(handler);
+	if (chain == handler_chains.end())
+		return;
+	uint32_t slot = chain->second;
+	while (slot != none) {
+		const uint32_t next = pool[slot].next_same;
+		Remove(slot);
+		slot = next;
+	}
+}
+
+void PIC_EventQueue::RemoveSpecificEvents(PIC_EventHandler handler, Bitu val)
+{
+	const auto chain = handler_chains.find(handler);
+	if (chain == handler_chains.end())
+		return;
+	uint32_t slot = chain->second;
+	while (slot != none) {
+		const uint32_t next = pool[slot].next_same;
+		if (pool[slot].value == val)
+			Remove(slot);
+		slot = next;
+	}
+}
+
+// Moving every index by the same amount keeps the heap ordered
+void PIC_EventQueue::ShiftIndexes(float amount)
+{
+	for (const auto slot : heap)
+		pool[slot].index += amount;
+}
+
+void PIC_EventQueue::Clear()
+{
+	pool.clear();
+	free_slots.clear();
+	heap.clear();
+	handler_chains.clear();
+	next_sequence = 0;
+}
+
+static PIC_EventQueue pic_queue;
 
 static void write_command(Bitu port,Bitu val,Bitu /*iolen*/) {
 	PIC_Controller * pic = &pics[port==0x20 ? 0 : 1];
@@ -378,102 +565,26 @@ void PIC_SetIRQMask(Bitu irq, bool masked) {
 	pic->set_imr(newmask);
 }
 
-static void AddEntry(PICEntry * entry) {
-	PICEntry * find_entry=pic_queue.next_entry;
-	if (GCC_UNLIKELY(find_entry ==0)) {
-		entry->next=0;
-		pic_queue.next_entry=entry;
-	} else if (find_entry->index>entry->index) {
-		pic_queue.next_entry=entry;
-		entry->next=find_entry;
-	} else while (find_entry) {
-		if (find_entry->next) {
-			/* See if the next index comes later than this one */
-			if (find_entry->next->index > entry->index) {
-				entry->next=find_entry->next;
-				find_entry->next=entry;
-				break;
-			} else {
-				find_entry=find_entry->next;
-			}
-		} else {
-			entry->next=find_entry->next;
-			find_entry->next=entry;
-			break;
-		}
-	}
-	Bits cycles=PIC_MakeCycles(pic_queue.next_entry->index-PIC_TickIndex());
-	if (cycles<CPU_Cycles) {
-		CPU_CycleLeft+=CPU_Cycles;
-		CPU_Cycles=0;
-	}
-}
 static bool InEventService = false;
 static float srv_lag = 0;
 
 void PIC_AddEvent(PIC_EventHandler handler,float delay,Bitu val) {
-	if (GCC_UNLIKELY(!pic_queue.free_entry)) {
-		LOG(LOG_PIC,LOG_ERROR)("Event queue full");
-		return;
+	const float index = delay + (InEventService ? srv_lag : PIC_TickIndex());
+	pic_queue.Add(handler, index, val);
+
+	Bits cycles=PIC_MakeCycles(pic_queue.Top().index-PIC_TickIndex());
+	if (cycles<CPU_Cycles) {
+		CPU_CycleLeft+=CPU_Cycles;
+		CPU_Cycles=0;
 	}
-	PICEntry * entry=pic_queue.free_entry;
-	if(InEventService) entry->index = delay + srv_lag;
-	else entry->index = delay + PIC_TickIndex();
-
-	entry->pic_event=handler;
-	entry->value=val;
-	pic_queue.free_entry=pic_queue.free_entry->next;
-	AddEntry(entry);
 }
 
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, Bitu val) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry = 0;
-	while (entry) {
-		if (GCC_UNLIKELY((entry->pic_event == handler)) && (entry->value == val)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
-	}
+	pic_queue.RemoveSpecificEvents(handler, val);
 }
 
 void PIC_RemoveEvents(PIC_EventHandler handler) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry=0;
-	while (entry) {
-		if (GCC_UNLIKELY(entry->pic_event==handler)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
-	}
+	pic_queue.RemoveEvents(handler);
 }
 
 
@@ -487,22 +598,19 @@ bool PIC_RunQueue(void) {
 	/* Check the queue for an entry */
 	Bits index_nd=PIC_TickIndexND();
 	InEventService = true;
-	while (pic_queue.next_entry && (pic_queue.next_entry->index*CPU_CycleMax<=index_nd)) {
-		PICEntry * entry=pic_queue.next_entry;
-		pic_queue.next_entry=entry->next;
-
-		srv_lag = entry->index;
-		(entry->pic_event)(entry->value); // call the event handler
+	while (!pic_queue.IsEmpty() && (pic_queue.Top().index*CPU_CycleMax<=index_nd)) {
+		/* Copy the event out, as the handler may add or remove events */
+		const PICEntry entry = pic_queue.Top();
+		pic_queue.RemoveTop();
 
-		/* Put the entry in the free list */
-		entry->next=pic_queue.free_entry;
-		pic_queue.free_entry=entry;
+		srv_lag = entry.index;
+		(entry.pic_event)(entry.value); // call the event handler
 	}
 	InEventService = false;
 
 	/* Check when to set the new cycle end */
-	if (pic_queue.next_entry) {
-		Bits cycles=(Bits)(pic_queue.next_entry->index*CPU_CycleMax-index_nd);
+	if (!pic_queue.IsEmpty()) {
+		Bits cycles=(Bits)(pic_queue.Top().index*CPU_CycleMax-index_nd);
 		if (GCC_UNLIKELY(!cycles)) cycles=1;
 		if (cycles<CPU_CycleLeft) {
 			CPU_Cycles=cycles;
@@ -551,11 +659,7 @@ void TIMER_AddTick(void) {
 	CPU_Cycles=0;
 	PIC_Ticks++;
 	/* Go through the list of scheduled events and lower their index with 1000 */
-	PICEntry * entry=pic_queue.next_entry;
-	while (entry) {
-		entry->index -= 1.0;
-		entry=entry->next;
-	}
+	pic_queue.ShiftIndexes(-1.0f);
 	/* Call our list of ticker handlers */
 	TickerBlock * ticker=firstticker;
 	while (ticker) {
@@ -609,12 +713,7 @@ public:
 		WriteHandler[2].Install(0xa0,write_command,IO_MB);
 		WriteHandler[3].Install(0xa1,write_data,IO_MB);
 		/* Initialize the pic queue */
-		for (i=0;i<PIC_QUEUESIZE-1;i++) {
-			pic_queue.entries[i].next=&pic_queue.entries[i+1];
-		}
-		pic_queue.entries[PIC_QUEUESIZE-1].next=0;
-		pic_queue.free_entry=&pic_queue.entries[0];
-		pic_queue.next_entry=0;
+		pic_queue.Clear();
 	}
 
 	~PIC_8259A(){
@@ -468,6 +468,36 @@ INLINE Bit8u decode_ADPCM_3_sample(Bit8u sample,Bit8u & reference,Bits& scale) {
 	return reference;
 }
 
+/*
+ *  Plays PCM samples straight out of guest memory for as long as the DMA
+ *  buffer sits in RAM, which saves copying them through sb.dma.buf first.
+ *  Whole frames of the given number of DMA units are handed to play, and
+ *  read counts the units used up. Returns false when some are left over
+ *  for the caller to read the usual way.
+ */
+template <typename Play>
+static bool PlayDMAInPlace(Bitu &read, Bitu size, Bitu frame, Play play)
+{
+	while (read < size) {
+		const Bit8u *data = nullptr;
+		Bitu avail = sb.dma.chan->Peek(size - read, &data);
+		avail -= avail % frame;
+		// The mixer takes 16-bit samples from aligned memory only
+		const bool aligned = sb.dma.mode < DSP_DMA_16 ||
+		                     !(reinterpret_cast<uintptr_t>(data) & 1);
+		if (!avail || !aligned)
+			return false;
+		// A single cycle transfer stops at the terminal count, as in Read
+		const bool ends = !sb.dma.chan->autoinit &&
+		                  avail > sb.dma.chan->currcnt;
+		read += sb.dma.chan->Skip(avail);
+		play(data, avail);
+		if (ends)
+			break;
+	}
+	return true;
+}
+
 static void PlayDMATransfer(Bitu size)
 {
 	Bitu read=0;Bitu done=0;Bitu i=0;
@@ -531,54 +561,87 @@ static void PlayDMATransfer(Bitu size)
 		break;
 	case DSP_DMA_8:
 		if (sb.dma.stereo) {
-			read=sb.dma.chan->Read(size,&sb.dma.buf.b8[sb.dma.remain_size]);
-			Bitu total=read+sb.dma.remain_size;
-            if (!sb.dma.sign)  sb.chan->AddSamples_s8(total>>1,sb.dma.buf.b8);
-            else sb.chan->AddSamples_s8s(total>>1,(Bit8s*)sb.dma.buf.b8);
-			if (total&1) {
-				sb.dma.remain_size=1;
-				sb.dma.buf.b8[0]=sb.dma.buf.b8[total-1];
-			} else sb.dma.remain_size=0;
+			const auto play = [](const Bit8u *data, Bitu len) {
+				if (!sb.dma.sign) sb.chan->AddSamples_s8(len>>1,data);
+				else sb.chan->AddSamples_s8s(len>>1,(const Bit8s *)data);
+			};
+			if (sb.dma.remain_size || !PlayDMAInPlace(read, size, 2, play)) {
+				const Bitu more=sb.dma.chan->Read(size-read,&sb.dma.buf.b8[sb.dma.remain_size]);
+				Bitu total=more+sb.dma.remain_size;
+				play(sb.dma.buf.b8,total);
+				if (total&1) {
+					sb.dma.remain_size=1;
+					sb.dma.buf.b8[0]=sb.dma.buf.b8[total-1];
+				} else sb.dma.remain_size=0;
+				read+=more;
+			}
 		} else {
-			read=sb.dma.chan->Read(size,sb.dma.buf.b8);
-			if (!sb.dma.sign) sb.chan->AddSamples_m8(read,sb.dma.buf.b8);
-			else sb.chan->AddSamples_m8s(read,(Bit8s *)sb.dma.buf.b8);
+			const auto play = [](const Bit8u *data, Bitu len) {
+				if (!sb.dma.sign) sb.chan->AddSamples_m8(len,data);
+				else sb.chan->AddSamples_m8s(len,(const Bit8s *)data);
+			};
+			if (!PlayDMAInPlace(read, size, 1, play)) {
+				const Bitu more=sb.dma.chan->Read(size-read,sb.dma.buf.b8);
+				play(sb.dma.buf.b8,more);
+				read+=more;
+			}
 		}
 		break;
 	case DSP_DMA_16:
-	case DSP_DMA_16_ALIASED:
+	case DSP_DMA_16_ALIASED: {
+		/* In DSP_DMA_16_ALIASED mode divide by 2 to get number of 16-bit
+		   samples, because 8-bit DMA Read returns byte size, while in DSP_DMA_16 mode
+		   16-bit DMA Read returns word size */
+		const Bitu shift=(sb.dma.mode==DSP_DMA_16_ALIASED ? 1:0);
 		if (sb.dma.stereo) {
-			/* In DSP_DMA_16_ALIASED mode temporarily divide by 2 to get number of 16-bit
-			   samples, because 8-bit DMA Read returns byte size, while in DSP_DMA_16 mode
-			   16-bit DMA Read returns word size */
-			read=sb.dma.chan->Read(size,(Bit8u *)&sb.dma.buf.b16[sb.dma.remain_size])
-				>> (sb.dma.mode==DSP_DMA_16_ALIASED ? 1:0);
-			Bitu total=read+sb.dma.remain_size;
+			const auto play = [](const Bit8u *data, Bitu samples) {
+				const Bit16s *data16=(const Bit16s *)data;
 #if defined(WORDS_BIGENDIAN)
-			if (sb.dma.sign) sb.chan->AddSamples_s16_nonnative(total>>1,sb.dma.buf.b16);
-			else sb.chan->AddSamples_s16u_nonnative(total>>1,(Bit16u *)sb.dma.buf.b16);
+				if (sb.dma.sign) sb.chan->AddSamples_s16_nonnative(samples>>1,data16);
+				else sb.chan->AddSamples_s16u_nonnative(samples>>1,(const Bit16u *)data16);
 #else
-			if (sb.dma.sign) sb.chan->AddSamples_s16(total>>1,sb.dma.buf.b16);
-			else sb.chan->AddSamples_s16u(total>>1,(Bit16u *)sb.dma.buf.b16);
+				if (sb.dma.sign) sb.chan->AddSamples_s16(samples>>1,data16);
+				else sb.chan->AddSamples_s16u(samples>>1,(const Bit16u *)data16);
 #endif
-			if (total&1) {
-				sb.dma.remain_size=1;
-				sb.dma.buf.b16[0]=sb.dma.buf.b16[total-1];
-			} else sb.dma.remain_size=0;
+			};
+			const auto play_units = [&](const Bit8u *data, Bitu len) {
+				play(data,len>>shift);
+			};
+			if (sb.dma.remain_size || !PlayDMAInPlace(read, size, 2<<shift, play_units)) {
+				const Bitu more=sb.dma.chan->Read(size-read,(Bit8u *)&sb.dma.buf.b16[sb.dma.remain_size])
+					>> shift;
+				Bitu total=more+sb.dma.remain_size;
+				play((const Bit8u *)sb.dma.buf.b16,total);
+				if (total&1) {
+					sb.dma.remain_size=1;
+					sb.dma.buf.b16[0]=sb.dma.buf.b16[total-1];
+				} else sb.dma.remain_size=0;
+				//back to the byte size in aliased mode
+				read+=more<<shift;
+			}
 		} else {
-			read=sb.dma.chan->Read(size,(Bit8u *)sb.dma.buf.b16)
-				>> (sb.dma.mode==DSP_DMA_16_ALIASED ? 1:0);
+			const auto play = [](const Bit8u *data, Bitu samples) {
+				const Bit16s *data16=(const Bit16s *)data;
 #if defined(WORDS_BIGENDIAN)
-			if (sb.dma.sign) sb.chan->AddSamples_m16_nonnative(read,sb.dma.buf.b16);
-			else sb.chan->AddSamples_m16u_nonnative(read,(Bit16u *)sb.dma.buf.b16);
+				if (sb.dma.sign) sb.chan->AddSamples_m16_nonnative(samples,data16);
+				else sb.chan->AddSamples_m16u_nonnative(samples,(const Bit16u *)data16);
 #else
-			if (sb.dma.sign) sb.chan->AddSamples_m16(read,sb.dma.buf.b16);
-			else sb.chan->AddSamples_m16u(read,(Bit16u *)sb.dma.buf.b16);
+				if (sb.dma.sign) sb.chan->AddSamples_m16(samples,data16);
+				else sb.chan->AddSamples_m16u(samples,(const Bit16u *)data16);
 #endif
+			};
+			const auto play_units = [&](const Bit8u *data, Bitu len) {
+				play(data,len>>shift);
+			};
+			if (!PlayDMAInPlace(read, size, 1<<shift, play_units)) {
+				const Bitu more=sb.dma.chan->Read(size-read,(Bit8u *)sb.dma.buf.b16)
+					>> shift;
+				play((const Bit8u *)sb.dma.buf.b16,more);
+				read+=more<<shift;
+			}
 		}
-		//restore buffer length value to byte size in aliased mode
-		if (sb.dma.mode==DSP_DMA_16_ALIASED) read=read<<1;
 		break;
+	}
 	default:
 		LOG_MSG("%s: Unhandled dma mode %d", CardType(), sb.dma.mode);
 		sb.mode=MODE_NONE;
@@ -645,7 +708,7 @@ static void SuppressDMATransfer(Bitu size)
 {
 	if (sb.dma.left < size)
 		size = sb.dma.left;
-	const Bitu read = sb.dma.chan->Read(size, sb.dma.buf.b8);
+	const Bitu read = sb.dma.chan->Skip(size);
 	sb.dma.left-=read;
 	if (!sb.dma.left) {
 		if (sb.dma.mode >= DSP_DMA_16) SB_RaiseIRQ(SB_IRQ_16);
@@ -56,7 +56,13 @@ static void VGA_DAC_SendColor( Bitu index, Bitu src ) {
 	const Bit8u green = vga.dac.rgb[src].green;
 	const Bit8u blue = vga.dac.rgb[src].blue;
 	//Set entry in (little endian) 16bit output lookup table
-	var_write(&vga.dac.xlat16[index], ((blue>>1)&0x1f) | (((green)&0x3f)<<5) | (((red>>1)&0x1f) << 11));
+	const Bit16u xlat = ((blue>>1)&0x1f) | (((green)&0x3f)<<5) | (((red>>1)&0x1f) << 11);
+#ifdef VGA_KEEP_CHANGES
+	// Lines translated through the table change without a memory write
+	if (var_read(&vga.dac.xlat16[index]) != xlat)
+		vga.changes.redraw = true;
+#endif
+	var_write(&vga.dac.xlat16[index], xlat);
 	
 	RENDER_SetPal( index, (red << 2) | ( red >> 4 ), (green << 2) | ( green >> 4 ), (blue << 2) | ( blue >> 4 ) );
 }
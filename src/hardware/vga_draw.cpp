@@ -25,6 +25,8 @@
 #include "../gui/render_scalers.h"
 #include "vga.h"
 #include "pic.h"
+#include "paging.h"
+#include "vga_kernels.h"
 
 //#undef C_DEBUG
 //#define C_DEBUG 1
@@ -106,62 +108,58 @@ static Bit8u * VGA_Draw_CGA16_Line(Bitu vidstart, Bitu line) {
 #undef CGA16_READER
 }
 
-static Bit8u * VGA_Draw_4BPP_Line(Bitu vidstart, Bitu line) {
+// Expands the packed 4bpp bytes of a line in runs that don't wrap around
+// the address mask
+template <void (*Expand)(uint8_t *, const uint8_t *, size_t, const uint8_t *), int pixels>
+static INLINE void VGA_Draw_4BPP_Runs(Bitu vidstart, Bitu line, Bitu bytes) {
 	const Bit8u *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
-	Bit8u* draw=TempLine;
-	Bitu end = vga.draw.blocks*2;
-	while(end) {
-		Bit8u byte = base[vidstart & vga.tandy.addr_mask];
-		*draw++=vga.attr.palette[byte >> 4];
-		*draw++=vga.attr.palette[byte & 0x0f];
-		vidstart++;
-		end--;
+	const Bitu mask = vga.tandy.addr_mask;
+	Bit8u *draw = TempLine;
+	while (bytes) {
+		const Bitu offset = vidstart & mask;
+		Bitu run = bytes;
+		// The masks are all powers of two minus one, ~0 never wraps
+		if (mask != (Bitu)~0 && run > mask + 1 - offset)
+			run = mask + 1 - offset;
+		Expand(draw, &base[offset], run, vga.attr.palette);
+		draw += run * pixels;
+		vidstart += run;
+		bytes -= run;
 	}
+}
+
+static Bit8u * VGA_Draw_4BPP_Line(Bitu vidstart, Bitu line) {
+	VGA_Draw_4BPP_Runs<vga_expand_4bpp, 2>(vidstart, line, vga.draw.blocks * 2);
 	return TempLine;
 }
 
 static Bit8u * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
-	const Bit8u *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
-	Bit8u* draw=TempLine;
-	Bitu end = vga.draw.blocks;
-	while(end) {
-		Bit8u byte = base[vidstart & vga.tandy.addr_mask];
-		Bit8u data = vga.attr.palette[byte >> 4];
-		*draw++ = data; *draw++ = data;
-		data = vga.attr.palette[byte & 0x0f];
-		*draw++ = data; *draw++ = data;
-		vidstart++;
-		end--;
-	}
+	VGA_Draw_4BPP_Runs<vga_expand_4bpp_double, 4>(vidstart, line, vga.draw.blocks);
 	return TempLine;
 }
 
 #ifdef VGA_KEEP_CHANGES
-static Bit8u * VGA_Draw_Changes_Line(Bitu vidstart, Bitu line) {
-	Bitu checkMask = vga.changes.checkMask;
-	Bit8u *map = vga.changes.map;
-	Bitu start = (vidstart >> VGA_CHANGE_SHIFT);
-	Bitu end = ((vidstart + vga.draw.line_length ) >> VGA_CHANGE_SHIFT);
-	for (; start <= end;start++) {
-		if ( map[start] & checkMask ) {
-			Bitu offset = vidstart & vga.draw.linear_mask;
-			if (vga.draw.linear_mask-offset < vga.draw.line_length)
-				memcpy(vga.draw.linear_base+vga.draw.linear_mask+1, vga.draw.linear_base, vga.draw.line_length);
-			Bit8u *ret = &vga.draw.linear_base[ offset ];
-#if !defined(C_UNALIGNED_MEMORY)
-			if (GCC_UNLIKELY( ((Bitu)ret) & (sizeof(Bitu)-1)) ) {
-				memcpy( TempLine, ret, vga.draw.line_length );
-				return TempLine;
-			}
-#endif
-			return ret;
-		}
+// Checks the change map for writes to the memory a line is drawn from,
+// both since the last drawn frame and ahead of the beam in this one
+static INLINE bool VGA_ChangedLine(Bitu vidstart) {
+	const Bit8u checkMask = vga.changes.checkMask | vga.changes.writeMask;
+	const Bit8u *map = vga.changes.map;
+	const Bitu offset = vidstart & vga.draw.linear_mask;
+	const Bitu wrap = vga.draw.linear_mask >> VGA_CHANGE_SHIFT;
+	Bitu start = offset >> VGA_CHANGE_SHIFT;
+	Bitu end = (offset + vga.draw.line_length - 1) >> VGA_CHANGE_SHIFT;
+	if (GCC_UNLIKELY(end > wrap)) {
+		// The line wraps around to the start of video memory
+		for (Bitu i = 0; i < end - wrap; i++)
+			if (map[i] & checkMask)
+				return true;
+		end = wrap;
 	}
-//	memset( TempLine, 0x30, vga.changes.lineWidth );
-//	return TempLine;
-	return 0;
+	for (; start <= end; start++)
+		if (map[start] & checkMask)
+			return true;
+	return false;
 }
-
 #endif
 
 static Bit8u * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
@@ -235,6 +233,37 @@ static Bit8u * VGA_Draw_Xlat16_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	return TempLine;
 } */
 
+// Applies the cursor pattern bytes from cursorMemStart to cursorMemEnd to the
+// scanline; only the first byte has some bits cut off
+template <typename Pixel>
+static INLINE void VGA_Draw_HWMouse_Pattern(Pixel *xat, Bitu cursorMemStart, Bitu cursorMemEnd,
+                                            Bitu cursorStartBit, Pixel fg, Pixel bg) {
+	for (Bitu m = cursorMemStart; m < cursorMemEnd; (m&1)?(m+=3):m++) {
+		// for each byte of cursor data
+		Bit8u bitsA = vga.mem.linear[m];
+		Bit8u bitsB = vga.mem.linear[m+2];
+		if (GCC_LIKELY(!cursorStartBit)) {
+			vga_cursor_8(xat, bitsA, bitsB, fg, bg);
+			xat += 8;
+			continue;
+		}
+		for (Bit8u bit=(0x80 >> cursorStartBit); bit != 0; bit >>= 1) {
+			// for each bit
+			if (bitsA&bit) {
+				// byte order doesn't matter here as all bits get flipped
+				if (bitsB&bit) *xat ^= static_cast<Pixel>(~0U); // Invert screen data
+				//else Transparent
+			} else if (bitsB&bit) {
+				*xat = fg; // foreground color
+			} else {
+				*xat = bg;
+			}
+			xat++;
+		}
+		cursorStartBit = 0;
+	}
+}
+
 static Bit8u * VGA_Draw_VGA_Line_HWMouse( Bitu vidstart, Bitu /*line*/) {
 	if (!svga.hardware_cursor_active || !svga.hardware_cursor_active())
 		// HW Mouse not enabled, use the tried and true call
@@ -264,24 +293,8 @@ static Bit8u * VGA_Draw_VGA_Line_HWMouse( Bitu vidstart, Bitu /*line*/) {
 		if (cursorMemStart & 0x2) cursorMemStart--;
 		Bitu cursorMemEnd = cursorMemStart + ((64-vga.s3.hgc.posx) >> 2);
 		Bit8u* xat = &TempLine[vga.s3.hgc.originx]; // mouse data start pos. in scanline
-		for (Bitu m = cursorMemStart; m < cursorMemEnd; (m&1)?(m+=3):m++) {
-			// for each byte of cursor data
-			Bit8u bitsA = vga.mem.linear[m];
-			Bit8u bitsB = vga.mem.linear[m+2];
-			for (Bit8u bit=(0x80 >> cursorStartBit); bit != 0; bit >>= 1) {
-				// for each bit
-				cursorStartBit=0; // only the first byte has some bits cut off
-				if (bitsA&bit) {
-					if (bitsB&bit) *xat ^= 0xFF; // Invert screen data
-					//else Transparent
-				} else if (bitsB&bit) {
-					*xat = vga.s3.hgc.forestack[0]; // foreground color
-				} else {
-					*xat = vga.s3.hgc.backstack[0];
-				}
-				xat++;
-			}
-		}
+		VGA_Draw_HWMouse_Pattern<Bit8u>(xat, cursorMemStart, cursorMemEnd, cursorStartBit,
+		                                vga.s3.hgc.forestack[0], vga.s3.hgc.backstack[0]);
 		return TempLine;
 	}
 }
@@ -303,27 +316,8 @@ static Bit8u * VGA_Draw_LIN16_Line_HWMouse(Bitu vidstart, Bitu /*line*/) {
 		if (cursorMemStart & 0x2) cursorMemStart--;
 		Bitu cursorMemEnd = cursorMemStart + ((64-vga.s3.hgc.posx) >> 2);
 		Bit16u* xat = &((Bit16u*)TempLine)[vga.s3.hgc.originx];
-		for (Bitu m = cursorMemStart; m < cursorMemEnd; (m&1)?(m+=3):m++) {
-			// for each byte of cursor data
-			Bit8u bitsA = vga.mem.linear[m];
-			Bit8u bitsB = vga.mem.linear[m+2];
-			for (Bit8u bit=(0x80 >> cursorStartBit); bit != 0; bit >>= 1) {
-				// for each bit
-				cursorStartBit=0;
-				if (bitsA&bit) {
-					// byte order doesn't matter here as all bits get flipped
-					if (bitsB&bit) *xat ^= ~0U;
-					//else Transparent
-				} else if (bitsB&bit) {
-					// Source as well as destination are Bit8u arrays, 
-					// so this should work out endian-wise?
-					*xat = *(Bit16u*)vga.s3.hgc.forestack;
-				} else {
-					*xat = *(Bit16u*)vga.s3.hgc.backstack;
-				}
-				xat++;
-			}
-		}
+		VGA_Draw_HWMouse_Pattern<Bit16u>(xat, cursorMemStart, cursorMemEnd, cursorStartBit,
+		                                 *(Bit16u*)vga.s3.hgc.forestack, *(Bit16u*)vga.s3.hgc.backstack);
 		return TempLine;
 	}
 }
@@ -345,23 +339,8 @@ static Bit8u * VGA_Draw_LIN32_Line_HWMouse(Bitu vidstart, Bitu /*line*/) {
 		if (cursorMemStart & 0x2) cursorMemStart--;
 		Bitu cursorMemEnd = cursorMemStart + ((64-vga.s3.hgc.posx) >> 2);
 		Bit32u* xat = &((Bit32u*)TempLine)[vga.s3.hgc.originx];
-		for (Bitu m = cursorMemStart; m < cursorMemEnd; (m&1)?(m+=3):m++) {
-			// for each byte of cursor data
-			Bit8u bitsA = vga.mem.linear[m];
-			Bit8u bitsB = vga.mem.linear[m+2];
-			for (Bit8u bit=(0x80 >> cursorStartBit); bit != 0; bit >>= 1) { // for each bit
-				cursorStartBit=0;
-				if (bitsA&bit) {
-					if (bitsB&bit) *xat ^= ~0U;
-					//else Transparent
-				} else if (bitsB&bit) {
-					*xat = *(Bit32u*)vga.s3.hgc.forestack;
-				} else {
-					*xat = *(Bit32u*)vga.s3.hgc.backstack;
-				}
-				xat++;
-			}
-		}
+		VGA_Draw_HWMouse_Pattern<Bit32u>(xat, cursorMemStart, cursorMemEnd, cursorStartBit,
+		                                 *(Bit32u*)vga.s3.hgc.forestack, *(Bit32u*)vga.s3.hgc.backstack);
 		return TempLine;
 	}
 }
@@ -558,15 +537,12 @@ static uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
 			// extend to the 9th pixel if needed
 			if ((font&0x2) && (vga.attr.mode_control&0x04) &&
 				(chr>=0xc0) && (chr<=0xdf)) font |= 1;
-			for (Bitu n = 0; n < 9; n++) {
-				*draw++ = vga.dac.xlat16[(font&0x100)? foreground:background];
-				font <<= 1;
-			}
+			vga_glyph_16bpp(draw, font >> 1, vga.dac.xlat16[foreground], vga.dac.xlat16[background]);
+			draw[8] = vga.dac.xlat16[(font&0x1)? foreground:background];
+			draw += 9;
 		} else {
-			for (Bitu n = 0; n < 8; n++) {
-				*draw++ = vga.dac.xlat16[(font&0x80)? foreground:background];
-				font <<= 1;
-			}
+			vga_glyph_16bpp(draw, font, vga.dac.xlat16[foreground], vga.dac.xlat16[background]);
+			draw += 8;
 		}
 	}
 	// draw the text mode cursor if needed
@@ -586,24 +562,6 @@ static uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
 	return TempLine+32;
 }
 
-#ifdef VGA_KEEP_CHANGES
-static INLINE void VGA_ChangesEnd(void ) {
-	if ( vga.changes.active ) {
-//		vga.changes.active = false;
-		Bitu end = vga.draw.address >> VGA_CHANGE_SHIFT;
-		Bitu total = 4 + end - vga.changes.start;
-		Bit32u clearMask = vga.changes.clearMask;
-		total >>= 2;
-		Bit32u *clear = (Bit32u *)&vga.changes.map[  vga.changes.start & ~3 ];
-		while ( total-- ) {
-			clear[0] &= clearMask;
-			clear++;
-		}
-	}
-}
-#endif
-
-
 static void VGA_ProcessSplit() {
 	if (vga.attr.mode_control&0x20) {
 		vga.draw.address=0;
@@ -717,7 +675,13 @@ static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
 
 static void VGA_DrawPart(Bitu lines) {
 	while (lines--) {
+#ifdef VGA_KEEP_CHANGES
+		// Unchanged lines are passed on as null without drawing them
+		Bit8u * data = (!vga.changes.active || VGA_ChangedLine(vga.draw.address)) ?
+			VGA_DrawLine( vga.draw.address, vga.draw.address_line ) : 0;
+#else
 		Bit8u * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
+#endif
 		RENDER_DrawLine(data);
 		vga.draw.address_line++;
 		if (vga.draw.address_line>=vga.draw.address_line_total) {
@@ -725,25 +689,12 @@ static void VGA_DrawPart(Bitu lines) {
 			vga.draw.address+=vga.draw.address_add;
 		}
 		vga.draw.lines_done++;
-		if (vga.draw.split_line==vga.draw.lines_done) {
-#ifdef VGA_KEEP_CHANGES
-			VGA_ChangesEnd( );
-#endif
-			VGA_ProcessSplit();
-#ifdef VGA_KEEP_CHANGES
-			vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-#endif
-		}
+		if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
 	}
 	if (--vga.draw.parts_left) {
 		PIC_AddEvent(VGA_DrawPart,(float)vga.draw.delay.parts,
 			 (vga.draw.parts_left!=1) ? vga.draw.parts_lines  : (vga.draw.lines_total - vga.draw.lines_done));
-	} else {
-#ifdef VGA_KEEP_CHANGES
-		VGA_ChangesEnd();
-#endif
-		RENDER_EndUpdate(false);
-	}
+	} else RENDER_EndUpdate(false);
 }
 
 void VGA_SetBlinking(Bitu enabled) {
@@ -762,25 +713,59 @@ void VGA_SetBlinking(Bitu enabled) {
 }
 
 #ifdef VGA_KEEP_CHANGES
-static void INLINE VGA_ChangesStart( void ) {
-	vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-	vga.changes.last = vga.changes.start;
-	if ( vga.changes.lastAddress != vga.draw.address ) {
-//		LOG_MSG("Address");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-		vga.changes.lastAddress = vga.draw.address;
-	} else if ( render.fullFrame ) {
-//		LOG_MSG("Full Frame");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-	} else {
-//		LOG_MSG("Changes");
-		VGA_DrawLine = VGA_Draw_Changes_Line;
+// Only modes drawn straight from the memory the write handlers mark can skip
+// unchanged lines; the hardware cursor isn't in video memory
+static bool VGA_ChangesTracked(void) {
+	if (vga.draw.mode != PART) return false;
+	if (VGA_DrawLine != VGA_Draw_Linear_Line && VGA_DrawLine != VGA_Draw_Xlat16_Linear_Line)
+		return false;
+	switch (vga.mode) {
+	case M_EGA:
+	case M_LIN4:
+		return vga.draw.linear_base == vga.fastmem;
+	case M_VGA:
+		if (vga.config.chained && vga.config.compatible_chain4)
+			return vga.draw.linear_base == vga.fastmem;
+		return vga.draw.linear_base == vga.mem.linear;
+	case M_LIN8:
+	case M_LIN15:
+	case M_LIN16:
+	case M_LIN32:
+		return vga.draw.linear_base == vga.mem.linear;
+	default:
+		return false;
 	}
-	vga.changes.active = true;
+}
+
+static void VGA_ChangesStart( void ) {
+	// Check the writes since the last drawn frame, new ones go to the next bit
 	vga.changes.checkMask = vga.changes.writeMask;
-	vga.changes.clearMask = ~( 0x01010101 << (vga.changes.frame & 7));
 	vga.changes.frame++;
 	vga.changes.writeMask = 1 << (vga.changes.frame & 7);
+	const Bit32u clearMask = ~(0x01010101u * vga.changes.writeMask);
+	Bit32u *clear = (Bit32u *)vga.changes.map;
+	for (Bitu i = vga.changes.mapSize / 4; i > 0; i--)
+		*clear++ &= clearMask;
+
+	const bool tracked = VGA_ChangesTracked();
+	const bool same_layout = vga.changes.lastBase == vga.draw.linear_base &&
+		vga.changes.lastAddress == vga.draw.address &&
+		vga.changes.lastAddressAdd == vga.draw.address_add &&
+		vga.changes.lastMask == vga.draw.linear_mask &&
+		vga.changes.lastSplit == vga.draw.split_line &&
+		vga.changes.lastLineSkip == vga.draw.address_line;
+	vga.changes.active = tracked && same_layout && !vga.changes.redraw && !render.fullFrame;
+	vga.changes.redraw = false;
+	// An untracked frame forces the next tracked one to be drawn in full
+	vga.changes.lastBase = tracked ? vga.draw.linear_base : 0;
+	vga.changes.lastAddress = vga.draw.address;
+	vga.changes.lastAddressAdd = vga.draw.address_add;
+	vga.changes.lastMask = vga.draw.linear_mask;
+	vga.changes.lastSplit = vga.draw.split_line;
+	vga.changes.lastLineSkip = vga.draw.address_line;
+	// Direct-mapped pages get marked when they are linked again
+	if (tracked && vga.draw.linear_base == vga.mem.linear)
+		VGA_UnlinkMappedPages();
 }
 #endif
 
@@ -862,9 +847,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.split_line++; // EGA adds one buggy scanline
 	}
 //	if (machine==MCH_EGA) vga.draw.split_line = ((((vga.config.line_compare&0x5ff)+1)*2-1)/vga.draw.lines_scaled);
-#ifdef VGA_KEEP_CHANGES
-	bool startaddr_changed=false;
-#endif
 	switch (vga.mode) {
 	case M_EGA:
 		if (!(vga.crtc.mode_control&0x1)) vga.draw.linear_mask &= ~0x10000;
@@ -875,9 +857,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		if (machine!=MCH_EGA) vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_VGA:
 		if (vga.config.compatible_chain4 && (vga.crtc.underline_location & 0x40)) {
@@ -896,9 +875,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_TEXT:
 		vga.draw.byte_panning_shift = 2;
@@ -933,7 +909,7 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 	}
 	if (GCC_UNLIKELY(vga.draw.split_line==0)) VGA_ProcessSplit();
 #ifdef VGA_KEEP_CHANGES
-	if (startaddr_changed) VGA_ChangesStart();
+	VGA_ChangesStart();
 #endif
 
 	// check if some lines at the top off the screen are blanked
@@ -1551,8 +1527,7 @@ void VGA_SetupDrawing(Bitu /*val*/) {
 	vga.draw.line_length = width * ((bpp + 1) / 8);
 #ifdef VGA_KEEP_CHANGES
 	vga.changes.active = false;
-	vga.changes.frame = 0;
-	vga.changes.writeMask = 1;
+	vga.changes.redraw = true;
 #endif
 	/*
 	   Cheap hack to just make all > 640x480 modes have square pixels
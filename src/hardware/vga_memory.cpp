@@ -53,6 +53,14 @@
 #define MEM_CHANGED( _MEM ) 
 #endif
 
+void VGA_MarkChanged(Bitu start, Bitu size) {
+#ifdef VGA_KEEP_CHANGES
+	const Bitu end = (start + size - 1) >> VGA_CHANGE_SHIFT;
+	for (start >>= VGA_CHANGE_SHIFT; start <= end; start++)
+		vga.changes.map[start] |= vga.changes.writeMask;
+#endif
+}
+
 #define TANDY_VIDBASE(_X_)  &MemBase[ 0x80000 + (_X_)]
 
 template <class Size>
@@ -223,6 +231,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr + 1) << 3 );
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 	}
@@ -231,6 +240,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr + 3) << 3 );
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 		writeHandler(addr+2,(Bit8u)(val >> 16));
@@ -307,6 +317,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr + 1) << 3 );
 		writeHandler<true>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<true>(addr+1,(Bit8u)(val >> 8));
 	}
@@ -315,6 +326,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr + 3) << 3 );
 		writeHandler<true>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<true>(addr+1,(Bit8u)(val >> 8));
 		writeHandler<true>(addr+2,(Bit8u)(val >> 16));
@@ -388,7 +400,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 1);
+		MEM_CHANGED( addr + 1 );
 		if (GCC_UNLIKELY(addr & 1)) {
 			writeHandler<Bit8u>( addr+0, val >> 0 );
 			writeHandler<Bit8u>( addr+1, val >> 8 );
@@ -402,7 +414,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 3);
+		MEM_CHANGED( addr + 3 );
 		if (GCC_UNLIKELY(addr & 3)) {
 			writeHandler<Bit8u>( addr+0, val >> 0 );
 			writeHandler<Bit8u>( addr+1, val >> 8 );
@@ -443,6 +455,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 2);
+		MEM_CHANGED( (addr + 1) << 2 );
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 	}
@@ -451,6 +464,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 2);
+		MEM_CHANGED( (addr + 3) << 2 );
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 		writeHandler(addr+2,(Bit8u)(val >> 16));
@@ -503,7 +517,10 @@ public:
 	}
 	HostPt GetHostWritePt(Bitu phys_page) {
  		phys_page-=vgapages.base;
-		return &vga.mem.linear[CHECKED3(vga.svga.bank_write_full+phys_page*4096)];
+		// Writes to the page bypass the handler once it is linked
+		const Bitu addr = CHECKED3(vga.svga.bank_write_full+phys_page*4096);
+		VGA_MarkChanged(addr, 4096);
+		return &vga.mem.linear[addr];
 	}
 };
 
@@ -542,6 +559,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr );
+		MEM_CHANGED( addr + 1 );
 		hostWrite<Bit16u>( &vga.mem.linear[addr], val );
 	}
 	void writed(PhysPt addr,Bitu val) {
@@ -549,6 +567,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr );	
+		MEM_CHANGED( addr + 3 );
 		hostWrite<Bit32u>( &vga.mem.linear[addr], val );
 	}
 };
@@ -568,6 +587,7 @@ public:
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
 		MEM_CHANGED( addr << 3 );
+		MEM_CHANGED( (addr + 1) << 3 );
 		writeHandler<false>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<false>(addr+1,(Bit8u)(val >> 8));
 	}
@@ -575,6 +595,7 @@ public:
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
 		MEM_CHANGED( addr << 3 );
+		MEM_CHANGED( (addr + 3) << 3 );
 		writeHandler<false>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<false>(addr+1,(Bit8u)(val >> 8));
 		writeHandler<false>(addr+2,(Bit8u)(val >> 16));
@@ -635,12 +656,14 @@ public:
 		addr = CHECKED(addr);
 		hostWrite<Bit16u>( &vga.mem.linear[addr], val );
 		MEM_CHANGED( addr );
+		MEM_CHANGED( addr + 1 );
 	}
 	void writed(PhysPt addr,Bitu val) {
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		hostWrite<Bit32u>( &vga.mem.linear[addr], val );
 		MEM_CHANGED( addr );
+		MEM_CHANGED( addr + 3 );
 	}
 };
 
@@ -654,7 +677,11 @@ public:
 		return &vga.mem.linear[CHECKED3(phys_page * 4096)];
 	}
 	HostPt GetHostWritePt( Bitu phys_page ) {
-		return GetHostReadPt( phys_page );
+		// Writes to the page bypass the handler once it is linked
+		phys_page -= vga.lfb.page;
+		const Bitu addr = CHECKED3(phys_page * 4096);
+		VGA_MarkChanged(addr, 4096);
+		return &vga.mem.linear[addr];
 	}
 };
 
@@ -929,6 +956,14 @@ range_done:
 	PAGING_ClearTLB();
 }
 
+// Direct-mapped SVGA window and LFB pages only mark the change map when they
+// get linked, so they are unlinked for each tracked frame
+void VGA_UnlinkMappedPages(void) {
+	PAGING_UnlinkPhysPages(vgapages.base, (vgapages.mask + 1) / 4096);
+	if (vga.lfb.handler)
+		PAGING_UnlinkPhysPages(vga.lfb.page, vga.vmemsize / 4096);
+}
+
 void VGA_StartUpdateLFB(void) {
 	vga.lfb.page = vga.s3.la_window << 4;
 	vga.lfb.addr = vga.s3.la_window << 16;
@@ -970,9 +1005,12 @@ void VGA_SetupMemory(Section* sec) {
 
 #ifdef VGA_KEEP_CHANGES
 	memset( &vga.changes, 0, sizeof( vga.changes ));
-	int changesMapSize = (vga.vmemsize >> VGA_CHANGE_SHIFT) + 32;
-	vga.changes.map = new Bit8u[changesMapSize];
-	memset(vga.changes.map, 0, changesMapSize);
+	// Planar modes mark changes in fastmem, which is twice as big
+	vga.changes.mapSize = ((vga.vmemsize << 1) >> VGA_CHANGE_SHIFT) + 32;
+	vga.changes.map = new Bit8u[vga.changes.mapSize];
+	memset(vga.changes.map, 0, vga.changes.mapSize);
+	vga.changes.writeMask = 1;
+	vga.changes.redraw = true;
 #endif
 	vga.svga.bank_read = vga.svga.bank_write = 0;
 	vga.svga.bank_read_full = vga.svga.bank_write_full = 0;
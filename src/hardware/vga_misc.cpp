@@ -18,9 +18,11 @@
 
 
 #include "dosbox.h"
+#include "cpu.h"
 #include "inout.h"
 #include "pic.h"
 #include "vga.h"
+#include <algorithm>
 #include <math.h>
 
 
@@ -29,6 +31,28 @@ Bitu vga_read_p3d4(Bitu port,Bitu iolen);
 void vga_write_p3d5(Bitu port,Bitu val,Bitu iolen);
 Bitu vga_read_p3d5(Bitu port,Bitu iolen);
 
+// Time until the value read from 3DAh next changes, in ms
+static double p3da_time_to_change(double timeInFrame) {
+	const auto &delay = vga.draw.delay;
+	double next = delay.vtotal; // the next frame starts
+	auto consider = [&](double t) {
+		if (t > timeInFrame && t < next) next = t;
+	};
+	consider(delay.vrstart);
+	consider(delay.vrend);
+	consider(delay.vdend);
+	if (timeInFrame < delay.vdend && delay.htotal > 0) {
+		const double lineStart = timeInFrame - fmod(timeInFrame, delay.htotal);
+		consider(lineStart + delay.hblkstart);
+		consider(lineStart + delay.hblkend);
+		consider(lineStart + delay.htotal);
+	}
+	return next - timeInFrame;
+}
+
+static CPU_IdlePoller p3da_poller;
+static Bit8u p3da_last = 0;
+
 Bitu vga_read_p3da(Bitu /*port*/,Bitu /*iolen*/) {
 	Bit8u retval=4;	// bit 2 set, needed by Blues Brothers
 	double timeInFrame = PIC_FullIndex()-vga.draw.delay.framestart;
@@ -52,6 +76,20 @@ Bitu vga_read_p3da(Bitu /*port*/,Bitu /*iolen*/) {
 			retval |= 1;
 		}
 	}
+
+	// A program waiting for the retrace reads the same value over and
+	// over; skip straight to where it changes
+	if (retval != p3da_last) {
+		p3da_last = retval;
+		CPU_IdlePollHit(p3da_poller);
+	} else if (CPU_IdlePoll(p3da_poller)) {
+		const double wait = p3da_time_to_change(timeInFrame);
+		// No more than the cycles left can be skipped; clamping before
+		// the conversion also keeps a long wait from overflowing it
+		if (wait > 0)
+			CPU_Idle(static_cast<Bit32s>(std::min(wait * CPU_CycleMax + 1,
+			                                      static_cast<double>(CPU_Cycles))));
+	}
 	return retval;
 }
 
@@ -147,18 +147,22 @@ void XGA_DrawPoint(Bitu x, Bitu y, Bitu c) {
 		case M_LIN8:
 			if (GCC_UNLIKELY(memaddr >= vga.vmemsize)) break;
 			vga.mem.linear[memaddr] = c;
+			VGA_MarkChanged(memaddr, 1);
 			break;
 		case M_LIN15:
 			if (GCC_UNLIKELY(memaddr*2 >= vga.vmemsize)) break;
 			((Bit16u*)(vga.mem.linear))[memaddr] = (Bit16u)(c&0x7fff);
+			VGA_MarkChanged(memaddr*2, 2);
 			break;
 		case M_LIN16:
 			if (GCC_UNLIKELY(memaddr*2 >= vga.vmemsize)) break;
 			((Bit16u*)(vga.mem.linear))[memaddr] = (Bit16u)(c&0xffff);
+			VGA_MarkChanged(memaddr*2, 2);
 			break;
 		case M_LIN32:
 			if (GCC_UNLIKELY(memaddr*4 >= vga.vmemsize)) break;
 			((Bit32u*)(vga.mem.linear))[memaddr] = c;
+			VGA_MarkChanged(memaddr*4, 4);
 			break;
 		default:
 			break;
@@ -20,8 +20,15 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <utility>
 
+#if defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
 #include "callback.h"
 #include "regs.h"
 #include "mem.h"
@@ -154,52 +161,195 @@ void swapInNextDisk(bool pressed) {
 }
 
 
-Bit8u imageDisk::Read_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data) {
-	Bit32u sectnum;
+// Read-ahead granularity and size of the sector cache used when the image
+// can't be memory-mapped
+constexpr size_t image_cache_block_bytes = 32 * 1024;
+constexpr size_t image_cache_blocks = 32;
 
-	sectnum = ( (cylinder * heads + head) * sectors ) + sector - 1L;
+Bit32u imageDisk::Get_AbsoluteSector(Bit32u head, Bit32u cylinder, Bit32u sector) const {
+	return ( (cylinder * heads + head) * sectors ) + sector - 1L;
+}
 
-	return Read_AbsoluteSector(sectnum, data);
+Bit8u imageDisk::Read_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data) {
+	return Read_AbsoluteSector(Get_AbsoluteSector(head, cylinder, sector), data);
 }
 
 Bit8u imageDisk::Read_AbsoluteSector(Bit32u sectnum, void * data) {
-	Bit32u bytenum;
-
-	bytenum = sectnum * sector_size;
-
-	if (last_action==WRITE || bytenum!=current_fpos) fseek(diskimg,bytenum,SEEK_SET);
-	size_t ret=fread(data, 1, sector_size, diskimg);
-	current_fpos=bytenum+ret;
-	last_action=READ;
+	return Read_AbsoluteSectors(sectnum, 1, data);
+}
 
+Bit8u imageDisk::Read_AbsoluteSectors(Bit32u start, Bit32u count, void *data) {
+	const uint64_t bytenum = static_cast<uint64_t>(start) * sector_size;
+	ReadImage(bytenum, count * sector_size, static_cast<Bit8u *>(data));
 	return 0x00;
 }
 
 Bit8u imageDisk::Write_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data) {
-	Bit32u sectnum;
+	return Write_AbsoluteSector(Get_AbsoluteSector(head, cylinder, sector), data);
+}
 
-	sectnum = ( (cylinder * heads + head) * sectors ) + sector - 1L;
+Bit8u imageDisk::Write_AbsoluteSector(Bit32u sectnum, void *data) {
+	return Write_AbsoluteSectors(sectnum, 1, data);
+}
+
+Bit8u imageDisk::Write_AbsoluteSectors(Bit32u start, Bit32u count, const void *data) {
+	const uint64_t bytenum = static_cast<uint64_t>(start) * sector_size;
+
+	//LOG_MSG("Writing %u sectors to %u at bytenum %llu", count, start, bytenum);
 
-	return Write_AbsoluteSector(sectnum, data);
+	const size_t ret = WriteImage(bytenum, count * sector_size,
+	                              static_cast<const Bit8u *>(data));
+	return ((ret>0)?0x00:0x05);
 }
 
+size_t imageDisk::ReadImage(uint64_t offset, size_t bytes, Bit8u *data) {
+	size_t done = 0;
+	if (offset < mapped_size) {
+		done = std::min(bytes, static_cast<size_t>(mapped_size - offset));
+		memcpy(data, mapped_image + offset, done);
+	}
+	if (done < bytes)
+		done += ReadCached(offset + done, bytes - done, data + done);
+	return done;
+}
 
-Bit8u imageDisk::Write_AbsoluteSector(Bit32u sectnum, void *data) {
-	Bit32u bytenum;
+size_t imageDisk::WriteImage(uint64_t offset, size_t bytes, const Bit8u *data) {
+	size_t done = 0;
+	if (offset < mapped_size) {
+		if (!mapped_writable)
+			return 0;
+		done = std::min(bytes, static_cast<size_t>(mapped_size - offset));
+		memcpy(mapped_image + offset, data, done);
+	}
+	if (done < bytes)
+		done += WriteCached(offset + done, bytes - done, data + done);
+	return done;
+}
 
-	bytenum = sectnum * sector_size;
+// When the image is mapped, only the part of the file beyond the mapping
+// goes through the cache, and GetCacheBlock keeps its blocks from reaching
+// back into the mapping, so the two never hold copies of the same bytes.
+size_t imageDisk::ReadCached(uint64_t offset, size_t bytes, Bit8u *data) {
+	size_t done = 0;
+	while (done < bytes) {
+		const uint64_t pos = offset + done;
+		CacheBlock &block = GetCacheBlock(pos);
+		const size_t block_pos = static_cast<size_t>(pos - block.offset);
+		if (block_pos >= block.valid)
+			break; // end of the image
+		const size_t n = std::min(bytes - done, block.valid - block_pos);
+		memcpy(data + done, block.data.data() + block_pos, n);
+		done += n;
+	}
+	return done;
+}
 
-	//LOG_MSG("Writing sectors to %ld at bytenum %d", sectnum, bytenum);
+size_t imageDisk::WriteCached(uint64_t offset, size_t bytes, const Bit8u *data) {
+	size_t done = 0;
+	while (done < bytes) {
+		const uint64_t pos = offset + done;
+		CacheBlock &block = GetCacheBlock(pos);
+		const size_t block_pos = static_cast<size_t>(pos - block.offset);
+		const size_t n = std::min(bytes - done, block.data.size() - block_pos);
+		// Writing past the end grows the image, with any gap zero-filled
+		if (block_pos > block.valid)
+			memset(block.data.data() + block.valid, 0, block_pos - block.valid);
+		memcpy(block.data.data() + block_pos, data + done, n);
+		block.valid = std::max(block.valid, block_pos + n);
+		block.dirty = true;
+		done += n;
+	}
+	return done;
+}
 
-	if (last_action==READ || bytenum!=current_fpos) fseek(diskimg,bytenum,SEEK_SET);
-	size_t ret=fwrite(data, 1, sector_size, diskimg);
-	current_fpos=bytenum+ret;
-	last_action=WRITE;
+imageDisk::CacheBlock &imageDisk::GetCacheBlock(uint64_t offset) {
+	const uint64_t block_end = offset - (offset % image_cache_block_bytes) +
+	                           image_cache_block_bytes;
+	// The block holding the end of the mapping starts right after it
+	const uint64_t block_offset = std::max<uint64_t>(
+	        block_end - image_cache_block_bytes, mapped_size);
+	if (cache.empty())
+		cache.resize(image_cache_blocks);
+
+	CacheBlock *victim = &cache.front();
+	for (auto &block : cache) {
+		if (block.offset == block_offset) {
+			block.last_use = ++cache_clock;
+			return block;
+		}
+		if (block.last_use < victim->last_use)
+			victim = &block;
+	}
 
-	return ((ret>0)?0x00:0x05);
+	FlushCacheBlock(*victim);
+	victim->data.resize(static_cast<size_t>(block_end - block_offset));
+	victim->offset = block_offset;
+	victim->last_use = ++cache_clock;
+	fseek(diskimg, static_cast<long>(block_offset), SEEK_SET);
+	victim->valid = fread(victim->data.data(), 1, victim->data.size(), diskimg);
+	return *victim;
+}
+
+void imageDisk::FlushCacheBlock(CacheBlock &block) {
+	if (!block.dirty)
+		return;
+	fseek(diskimg, static_cast<long>(block.offset), SEEK_SET);
+	if (fwrite(block.data.data(), 1, block.valid, diskimg) != block.valid)
+		LOG_MSG("ImageLoader: Failed writing to %s", diskname);
+	fflush(diskimg);
+	block.dirty = false;
+}
+
+void imageDisk::FlushCache() {
+	for (auto &block : cache)
+		FlushCacheBlock(block);
+}
 
+#if defined(HAVE_MMAP)
+
+bool imageDisk::MapImage() {
+	const int fd = fileno(diskimg);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= 0)
+		return false;
+	if (static_cast<uint64_t>(st.st_size) > SIZE_MAX)
+		return false;
+	const auto size = static_cast<size_t>(st.st_size);
+
+	mapped_writable = true;
+	void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED && errno == EACCES) {
+		// Image opened read-only; writes will fail as they would on
+		// the file itself
+		mapped_writable = false;
+		addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	if (addr == MAP_FAILED) {
+		mapped_writable = false;
+		return false;
+	}
+	mapped_image = static_cast<Bit8u *>(addr);
+	mapped_size = size;
+	return true;
+}
+
+void imageDisk::UnmapImage() {
+	if (mapped_image)
+		munmap(mapped_image, mapped_size);
+	mapped_image = nullptr;
+	mapped_size = 0;
+}
+
+#else
+
+bool imageDisk::MapImage() {
+	return false;
 }
 
+void imageDisk::UnmapImage() {}
+
+#endif // HAVE_MMAP
+
 imageDisk::imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k, bool is_hdd)
         : hardDrive(is_hdd),
           active(false),
@@ -208,9 +358,7 @@ imageDisk::imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k,
           sector_size(512),
           heads(0),
           cylinders(0),
-          sectors(0),
-          current_fpos(0),
-          last_action(NONE)
+          sectors(0)
 {
 	fseek(diskimg,0,SEEK_SET);
 	memset(diskname,0,512);
@@ -239,6 +387,15 @@ imageDisk::imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k,
 			incrementFDD();
 		}
 	}
+	MapImage();
+}
+
+imageDisk::~imageDisk()
+{
+	FlushCache();
+	UnmapImage();
+	if (diskimg != nullptr)
+		fclose(diskimg);
 }
 
 void imageDisk::Set_Geometry(Bit32u setHeads, Bit32u setCyl, Bit32u setSect, Bit32u setSectSize) {
@@ -313,11 +470,30 @@ static bool has_image(const std::array<T, N> &arr) {
 	return std::any_of(std::begin(arr), std::end(arr), to_bool);
 }
 
+// Transfer buffers between host and guest memory at seg:off, wrapping
+// around within the segment the way per-byte real-mode accesses do
+static void CopyToRealBuffer(Bit16u seg, Bit16u off, const std::vector<Bit8u> &buffer) {
+	size_t done = 0;
+	while (done < buffer.size()) {
+		const size_t n = std::min(buffer.size() - done, static_cast<size_t>(0x10000 - off));
+		MEM_BlockWrite(PhysMake(seg, off), buffer.data() + done, n);
+		done += n;
+		off = static_cast<Bit16u>(off + n);
+	}
+}
+
+static void CopyFromRealBuffer(Bit16u seg, Bit16u off, std::vector<Bit8u> &buffer) {
+	size_t done = 0;
+	while (done < buffer.size()) {
+		const size_t n = std::min(buffer.size() - done, static_cast<size_t>(0x10000 - off));
+		MEM_BlockRead(PhysMake(seg, off), buffer.data() + done, n);
+		done += n;
+		off = static_cast<Bit16u>(off + n);
+	}
+}
+
 static Bitu INT13_DiskHandler(void) {
-	Bit16u segat, bufptr;
-	Bit8u sectbuf[512];
 	Bit8u  drivenum;
-	Bitu t;
 	last_drive = reg_dl;
 	drivenum = GetDosDriveNumber(reg_dl);
 	const bool any_images = has_image(imageDiskList);
@@ -394,10 +570,11 @@ static Bitu INT13_DiskHandler(void) {
 			return CBRET_NONE;
 		}
 
-		segat = SegValue(es);
-		bufptr = reg_bx;
-		for (Bitu i = 0; i < reg_al; i++) {
-			last_status = imageDiskList[drivenum]->Read_Sector((Bit32u)reg_dh, (Bit32u)(reg_ch | ((reg_cl & 0xc0)<< 2)), (Bit32u)((reg_cl & 63)+i), sectbuf);
+		{
+			const auto &disk = imageDiskList[drivenum];
+			const Bit32u start = disk->Get_AbsoluteSector(reg_dh, reg_ch | ((reg_cl & 0xc0) << 2), reg_cl & 63);
+			std::vector<Bit8u> buffer(reg_al * disk->getSectSize());
+			last_status = disk->Read_AbsoluteSectors(start, reg_al, buffer.data());
 			if((last_status != 0x00) || (killRead)) {
 				LOG_MSG("Error in disk read");
 				killRead = false;
@@ -405,10 +582,7 @@ static Bitu INT13_DiskHandler(void) {
 				CALLBACK_SCF(true);
 				return CBRET_NONE;
 			}
-			for(t=0;t<512;t++) {
-				real_writeb(segat,bufptr,sectbuf[t]);
-				bufptr++;
-			}
+			CopyToRealBuffer(SegValue(es), reg_bx, buffer);
 		}
 		reg_ah = 0x00;
 		CALLBACK_SCF(false);
@@ -419,13 +593,12 @@ static Bitu INT13_DiskHandler(void) {
 			CALLBACK_SCF(true);
 			return CBRET_NONE;
 		}
-		bufptr = reg_bx;
-		for (Bitu i = 0; i < reg_al; i++) {
-			for(t=0;t<imageDiskList[drivenum]->getSectSize();t++) {
-				sectbuf[t] = real_readb(SegValue(es),bufptr);
-				bufptr++;
-			}
-			last_status = imageDiskList[drivenum]->Write_Sector((Bit32u)reg_dh, (Bit32u)(reg_ch | ((reg_cl & 0xc0) << 2)), (Bit32u)((reg_cl & 63) + i), &sectbuf[0]);
+		{
+			const auto &disk = imageDiskList[drivenum];
+			const Bit32u start = disk->Get_AbsoluteSector(reg_dh, reg_ch | ((reg_cl & 0xc0) << 2), reg_cl & 63);
+			std::vector<Bit8u> buffer(reg_al * disk->getSectSize());
+			CopyFromRealBuffer(SegValue(es), reg_bx, buffer);
+			last_status = disk->Write_AbsoluteSectors(start, reg_al, buffer.data());
 			if(last_status != 0x00) {
 				CALLBACK_SCF(true);
 				return CBRET_NONE;
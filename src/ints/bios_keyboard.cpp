@@ -21,6 +21,7 @@
 #include <SDL.h>
 
 #include "callback.h"
+#include "cpu.h"
 #include "mem.h"
 #include "keyboard.h"
 #include "regs.h"
@@ -466,6 +467,9 @@ static bool IsEnhancedKey(Bit16u &key) {
 	return false;
 }
 
+/* Shared by 01 and 11, which programs call back to back in their key loops */
+static CPU_IdlePoller key_poller;
+
 static Bitu INT16_Handler(void) {
 	Bit16u temp=0;
 	switch (reg_ah) {
@@ -476,6 +480,7 @@ static Bitu INT16_Handler(void) {
 		} else {
 			/* enter small idle loop to allow for irqs to happen */
 			reg_ip+=1;
+			CPU_Idle();
 		}
 		break;
 	case 0x10: /* GET KEYSTROKE (enhanced keyboards only) */
@@ -488,6 +493,7 @@ static Bitu INT16_Handler(void) {
 		} else {
 			/* enter small idle loop to allow for irqs to happen */
 			reg_ip+=1;
+			CPU_Idle();
 		}
 		break;
 	case 0x01: /* CHECK FOR KEYSTROKE */
@@ -497,6 +503,7 @@ static Bitu INT16_Handler(void) {
 			if (check_key(temp)) { //  check_key changes ZF and CF as required
 				if (!IsEnhancedKey(temp)) {
 					/* normal key, return translated key in ax */
+					CPU_IdlePollHit(key_poller);
 					break;
 				} else {
 					/* remove enhanced key from buffer and ignore it */
@@ -504,6 +511,7 @@ static Bitu INT16_Handler(void) {
 				}
 			} else {
 				/* no key available, return key at buffer head anyway */
+				if (CPU_IdlePoll(key_poller)) CPU_Idle();
 				break;
 			}
 //			CALLBACK_Idle();
@@ -518,6 +526,9 @@ static Bitu INT16_Handler(void) {
 				/* special enhanced key, clear low part before returning key */
 				temp&=0xff00;
 			}
+			CPU_IdlePollHit(key_poller);
+		} else if (CPU_IdlePoll(key_poller)) {
+			CPU_Idle();
 		}
 		reg_ax=temp;
 		break;
@@ -18,11 +18,28 @@
 
 #include "zmbv.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <climits>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP == 2)
+#define ZMBV_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define ZMBV_USE_AVX2 1
+#include <immintrin.h>
+#endif
 
 #define DBZV_VERSION_HIGH 0
 #define DBZV_VERSION_LOW 1
@@ -35,6 +52,9 @@
 #define Mask_KeyFrame			0x01
 #define	Mask_DeltaPalette		0x02
 
+/* Don't bother starting search threads for less blocks than this each */
+#define MIN_BLOCKS_PER_THREAD	64
+
 zmbv_format_t BPPFormat( int bpp ) {
 	switch (bpp) {
 	case 8:
@@ -142,12 +162,96 @@ void VideoCodec::CreateVectorTable(void) {
 	}
 }
 
+/* Row kernels for the motion search. A 32-bit pixel only counts as changed
+ * when its colour bits differ; the padding byte is ignored. */
+static INLINE int CountBits(unsigned int v) {
+	v = v - ((v >> 1) & 0x55555555);
+	v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+	return (((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+}
+
+template <class P>
+static INLINE int CountChangedPixels(const P *a, const P *b, int n) {
+	int ret = 0;
+	for (int x = 0; x < n; x++)
+		ret += ((a[x] - b[x]) & 0x00ffffff) != 0;
+	return ret;
+}
+
+#if ZMBV_USE_SSE2
+template <>
+INLINE int CountChangedPixels(const uint8_t *a, const uint8_t *b, int n) {
+	int ret = 0, x = 0;
+	for (; x + 16 <= n; x += 16) {
+		const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + x)),
+		                                  _mm_loadu_si128((const __m128i *)(b + x)));
+		ret += 16 - CountBits(_mm_movemask_epi8(eq));
+	}
+	for (; x < n; x++)
+		ret += a[x] != b[x];
+	return ret;
+}
+
+template <>
+INLINE int CountChangedPixels(const uint16_t *a, const uint16_t *b, int n) {
+	int ret = 0, x = 0;
+	for (; x + 8 <= n; x += 8) {
+		const __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(a + x)),
+		                                   _mm_loadu_si128((const __m128i *)(b + x)));
+		ret += 8 - CountBits(_mm_movemask_epi8(eq)) / 2;
+	}
+	for (; x < n; x++)
+		ret += a[x] != b[x];
+	return ret;
+}
+
+template <>
+INLINE int CountChangedPixels(const uint32_t *a, const uint32_t *b, int n) {
+	int ret = 0, x = 0;
+#if ZMBV_USE_AVX2
+	const __m256i mask8 = _mm256_set1_epi32(0x00ffffff);
+	for (; x + 8 <= n; x += 8) {
+		const __m256i va = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(a + x)), mask8);
+		const __m256i vb = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(b + x)), mask8);
+		const __m256i eq = _mm256_cmpeq_epi32(va, vb);
+		ret += 8 - CountBits(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+	}
+#endif
+	const __m128i mask = _mm_set1_epi32(0x00ffffff);
+	for (; x + 4 <= n; x += 4) {
+		const __m128i va = _mm_and_si128(_mm_loadu_si128((const __m128i *)(a + x)), mask);
+		const __m128i vb = _mm_and_si128(_mm_loadu_si128((const __m128i *)(b + x)), mask);
+		const __m128i eq = _mm_cmpeq_epi32(va, vb);
+		ret += 4 - CountBits(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+	}
+	for (; x < n; x++)
+		ret += ((a[x] ^ b[x]) & 0x00ffffff) != 0;
+	return ret;
+}
+#endif
+
+template <class P>
+static INLINE void XorPixels(P *out, const P *a, const P *b, int n) {
+	int x = 0;
+#if ZMBV_USE_SSE2
+	const int per_vector = 16 / sizeof(P);
+	for (; x + per_vector <= n; x += per_vector) {
+		const __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+		const __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+		_mm_storeu_si128((__m128i *)(out + x), _mm_xor_si128(va, vb));
+	}
+#endif
+	for (; x < n; x++)
+		out[x] = a[x] ^ b[x];
+}
+
 template<class P>
 INLINE int VideoCodec::PossibleBlock(int vx,int vy,FrameBlock * block) {
 	int ret=0;
 	P * pold=((P*)oldframe)+block->start+(vy*pitch)+vx;
 	P * pnew=((P*)newframe)+block->start;;	
-	for (int y=0;y<block->dy;y+=4) {
+	/* Only ever compared against 4, so stop counting there */
+	for (int y=0;y<block->dy && ret<4;y+=4) {
 		for (int x=0;x<block->dx;x+=4) {
 			int test=0-((pold[x]-pnew[x])&0x00ffffff);
 			ret-=(test>>31);
@@ -159,15 +263,14 @@ INLINE int VideoCodec::PossibleBlock(int vx,int vy,FrameBlock * block) {
 }
 
 template<class P>
-INLINE int VideoCodec::CompareBlock(int vx,int vy,FrameBlock * block) {
+INLINE int VideoCodec::CompareBlock(int vx,int vy,FrameBlock * block,int limit) {
 	int ret=0;
 	P * pold=((P*)oldframe)+block->start+(vy*pitch)+vx;
-	P * pnew=((P*)newframe)+block->start;;	
-	for (int y=0;y<block->dy;y++) {
-		for (int x=0;x<block->dx;x++) {
-			int test=0-((pold[x]-pnew[x])&0x00ffffff);
-			ret-=(test>>31);
-		}
+	P * pnew=((P*)newframe)+block->start;
+	/* Callers only care about blocks below the limit, so give up on a
+	 * block as soon as it can't get there anymore */
+	for (int y=0;y<block->dy && ret<limit;y++) {
+		ret+=CountChangedPixels(pold, pnew, block->dx);
 		pold+=pitch;
 		pnew+=pitch;
 	}
@@ -179,25 +282,124 @@ INLINE void VideoCodec::AddXorBlock(int vx,int vy,FrameBlock * block) {
 	P * pold=((P*)oldframe)+block->start+(vy*pitch)+vx;
 	P * pnew=((P*)newframe)+block->start;
 	for (int y=0;y<block->dy;y++) {
-		for (int x=0;x<block->dx;x++) {
-			*((P*)&work[workUsed])=pnew[x] ^ pold[x];
-			workUsed+=sizeof(P);
-		}
+		XorPixels((P*)&work[workUsed], pnew, pold, block->dx);
+		workUsed+=block->dx*sizeof(P);
 		pold+=pitch;
 		pnew+=pitch;
 	}
 }
 
+/* A small pool of threads that help with the motion search of delta frames.
+ * The encoding thread hands over the frame's blocks, searches bands of them
+ * itself and waits for the last band; the threads stay around until the
+ * codec goes away, so a frame doesn't pay for starting them. */
+class VideoCodec::SearchWorkers {
+public:
+	SearchWorkers(const int num_threads)
+	{
+		for (int i = 0; i < num_threads; ++i)
+			threads.emplace_back(&SearchWorkers::Work, this);
+	}
+	SearchWorkers(const SearchWorkers &) = delete; // prevent copying
+	SearchWorkers &operator=(const SearchWorkers &) = delete; // prevent assignment
+
+	~SearchWorkers()
+	{
+		{
+			const std::lock_guard<std::mutex> lock(mutex);
+			should_quit = true;
+		}
+		has_batch.notify_all();
+		for (auto &thread : threads)
+			thread.join();
+	}
+
+	// Runs search over blocks 0 to count in bands and returns once all of
+	// them are done
+	void Run(VideoCodec *codec, void (VideoCodec::*search)(int, int), int count, int band)
+	{
+		assert(remaining_bands == 0);
+		{
+			// Workers that were late to the previous batch may still be
+			// looking at it, so let them finish before replacing it
+			std::unique_lock<std::mutex> lock(mutex);
+			batch_done.wait(lock, [this]() { return active_workers == 0; });
+			batch_codec = codec;
+			batch_search = search;
+			batch_count = count;
+			band_size = band;
+			next_band = 0;
+			remaining_bands = (count + band - 1) / band;
+			++batch_id;
+		}
+		has_batch.notify_all();
+		while (RunNextBand())
+			;
+		std::unique_lock<std::mutex> lock(mutex);
+		batch_done.wait(lock, [this]() { return remaining_bands == 0; });
+	}
+
+private:
+	// Claims and searches the next unclaimed band of blocks
+	bool RunNextBand()
+	{
+		const int first = (next_band++) * band_size;
+		if (first >= batch_count)
+			return false;
+		(batch_codec->*batch_search)(first, std::min(first + band_size, batch_count));
+		if (--remaining_bands == 0) {
+			{ const std::lock_guard<std::mutex> lock(mutex); }
+			batch_done.notify_all();
+		}
+		return true;
+	}
+
+	void Work()
+	{
+		uint64_t last_batch_id = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				has_batch.wait(lock, [&]() {
+					return should_quit || batch_id != last_batch_id;
+				});
+				if (should_quit)
+					return;
+				last_batch_id = batch_id;
+				++active_workers;
+			}
+			while (RunNextBand())
+				;
+			{
+				const std::lock_guard<std::mutex> lock(mutex);
+				--active_workers;
+			}
+			batch_done.notify_all();
+		}
+	}
+
+	std::vector<std::thread> threads = {};
+	std::mutex mutex = {};
+	std::condition_variable has_batch = {};
+	std::condition_variable batch_done = {};
+	VideoCodec *batch_codec = nullptr;
+	void (VideoCodec::*batch_search)(int, int) = nullptr;
+	int batch_count = 0;
+	int band_size = 1;
+	std::atomic<int> next_band{0};
+	std::atomic<int> remaining_bands{0};
+	uint64_t batch_id = 0;
+	int active_workers = 0;
+	bool should_quit = false;
+};
+
 template<class P>
-void VideoCodec::AddXorFrame(void) {
-	signed char * vectors=(signed char*)&work[workUsed];
-	/* Align the following xor data on 4 byte boundary*/
-	workUsed=(workUsed + blockcount*2 +3) & ~3;
-	for (int b=0;b<blockcount;b++) {
+void VideoCodec::SearchBlocks(int first, int last) {
+	for (int b=first;b<last;b++) {
 		FrameBlock * block=&blocks[b];
 		int bestvx = 0;
 		int bestvy = 0;
-		int bestchange=CompareBlock<P>(0,0, block);
+		int bestchange=CompareBlock<P>(0,0, block, INT_MAX);
 		int possibles=64;
 		for (int v=0;v<VectorCount && possibles;v++) {
 			if (bestchange<4) break;
@@ -206,7 +408,7 @@ void VideoCodec::AddXorFrame(void) {
 			if (PossibleBlock<P>(vx, vy, block) < 4) {
 				possibles--;
 //				if (!possibles) Msg("Ran out of possibles, at %d of %d best %d\n",v,VectorCount,bestchange);
-				int testchange=CompareBlock<P>(vx,vy, block);
+				int testchange=CompareBlock<P>(vx,vy, block, bestchange);
 				if (testchange<bestchange) {
 					bestchange=testchange;
 					bestvx = vx;
@@ -214,11 +416,34 @@ void VideoCodec::AddXorFrame(void) {
 				}
 			}
 		}
-		vectors[b*2+0]=(bestvx << 1);
-		vectors[b*2+1]=(bestvy << 1);
-		if (bestchange) {
+		block->vx = bestvx;
+		block->vy = bestvy;
+		block->change = bestchange;
+	}
+}
+
+template<class P>
+void VideoCodec::AddXorFrame(void) {
+	signed char * vectors=(signed char*)&work[workUsed];
+	/* Align the following xor data on 4 byte boundary*/
+	workUsed=(workUsed + blockcount*2 +3) & ~3;
+	/* The search only reads the frames, so the blocks can be split over
+	 * threads; the results are then written out in block order */
+	const int threads = std::min(searchThreads, blockcount / MIN_BLOCKS_PER_THREAD);
+	if (threads > 1 && searchWorkers) {
+		/* A few bands per thread evens out blocks that take longer */
+		const int band = std::max(MIN_BLOCKS_PER_THREAD / 4, blockcount / (threads * 4));
+		searchWorkers->Run(this, &VideoCodec::SearchBlocks<P>, blockcount, band);
+	} else {
+		SearchBlocks<P>(0, blockcount);
+	}
+	for (int b=0;b<blockcount;b++) {
+		FrameBlock * block=&blocks[b];
+		vectors[b*2+0]=(block->vx << 1);
+		vectors[b*2+1]=(block->vy << 1);
+		if (block->change) {
 			vectors[b*2+0]|=1;
-			AddXorBlock<P>(bestvx, bestvy, block);
+			AddXorBlock<P>(block->vx, block->vy, block);
 		}
 	}
 }
@@ -335,14 +560,14 @@ int VideoCodec::FinishCompressFrame( void ) {
 		/* Add the delta frame data */
 		switch (format) {
 		case ZMBV_FORMAT_8BPP:
-			AddXorFrame<char>();
+			AddXorFrame<uint8_t>();
 			break;
 		case ZMBV_FORMAT_15BPP:
 		case ZMBV_FORMAT_16BPP:
-			AddXorFrame<short>();
+			AddXorFrame<uint16_t>();
 			break;
 		case ZMBV_FORMAT_32BPP:
-			AddXorFrame<long>();
+			AddXorFrame<uint32_t>();
 			break;
 		default:
 			break;
@@ -461,14 +686,14 @@ bool VideoCodec::DecompressFrame(void * framedata, int size) {
 		}
 		switch (format) {
 		case ZMBV_FORMAT_8BPP:
-			UnXorFrame<char>();
+			UnXorFrame<uint8_t>();
 			break;
 		case ZMBV_FORMAT_15BPP:
 		case ZMBV_FORMAT_16BPP:
-			UnXorFrame<short>();
+			UnXorFrame<uint16_t>();
 			break;
 		case ZMBV_FORMAT_32BPP:
-			UnXorFrame<long>();
+			UnXorFrame<uint32_t>();
 			break;
 		default:
 			break;
@@ -526,6 +751,29 @@ void VideoCodec::Output_UpsideDown_24(void *output) {
 	}
 }
 
+zmbv_format_t VideoCodec::GetDecodedFrame(void *output, char *pal) {
+	unsigned char *r = newframe + pixelsize*(MAX_VECTOR+MAX_VECTOR*pitch);
+	unsigned char *w = (unsigned char *)output;
+	const int line_width = width * pixelsize;
+	for (int i = 0; i < height; i++) {
+		memcpy(w, r, line_width);
+		r += pitch * pixelsize;
+		w += line_width;
+	}
+	if (pal && palsize)
+		memcpy(pal, palette, sizeof(palette));
+	return format;
+}
+
+void VideoCodec::SetSearchThreads(int count) {
+	searchThreads = std::max(count, 1);
+	delete searchWorkers;
+	searchWorkers = nullptr;
+	/* The encoding thread takes part in the search as well */
+	if (searchThreads > 1)
+		searchWorkers = new SearchWorkers(searchThreads - 1);
+}
+
 void VideoCodec::FreeBuffers(void) {
 	if (blocks) {
 		delete[] blocks;blocks=0;
@@ -560,8 +808,15 @@ VideoCodec::VideoCodec()
           pitch(0),
           format(ZMBV_FORMAT_NONE),
           pixelsize(0),
-          zstream{}
+          zstream{},
+          searchThreads(1),
+          searchWorkers(nullptr)
 {
 	CreateVectorTable();
 	memset(&zstream, 0, sizeof(zstream));
 }
+
+VideoCodec::~VideoCodec()
+{
+	delete searchWorkers;
+}
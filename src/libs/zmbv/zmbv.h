@@ -49,6 +49,9 @@ private:
 	struct FrameBlock {
 		int start;
 		int dx,dy;
+		/* Motion search result for the frame being compressed */
+		int vx,vy;
+		int change;
 	};
 	struct CodecVector {
 		int x,y;
@@ -89,11 +92,18 @@ private:
 
 	z_stream zstream;
 
+	int searchThreads;
+	// Threads that help with the motion search, kept between frames
+	class SearchWorkers;
+	SearchWorkers *searchWorkers;
+
 	// methods
 	void FreeBuffers(void);
 	void CreateVectorTable(void);
 	bool SetupBuffers(zmbv_format_t format, int blockwidth, int blockheight);
 
+	template<class P>
+		void SearchBlocks(int first, int last);
 	template<class P>
 		void AddXorFrame(void);
 	template<class P>
@@ -101,7 +111,7 @@ private:
 	template<class P>
 		INLINE int PossibleBlock(int vx,int vy,FrameBlock * block);
 	template<class P>
-		INLINE int CompareBlock(int vx,int vy,FrameBlock * block);
+		INLINE int CompareBlock(int vx,int vy,FrameBlock * block,int limit);
 	template<class P>
 		INLINE void AddXorBlock(int vx,int vy,FrameBlock * block);
 	template<class P>
@@ -110,6 +120,9 @@ private:
 		INLINE void CopyBlock(int vx, int vy,FrameBlock * block);
 public:
 	VideoCodec();
+	VideoCodec(const VideoCodec &) = delete; // prevent copying
+	VideoCodec &operator=(const VideoCodec &) = delete; // prevent assignment
+	~VideoCodec();
 	bool SetupCompress( int _width, int _height);
 	bool SetupDecompress( int _width, int _height);
 	zmbv_format_t BPPFormat( int bpp );
@@ -120,6 +133,10 @@ public:
 	int FinishCompressFrame( void );
 	bool DecompressFrame(void * framedata, int size);
 	void Output_UpsideDown_24(void * output);
+	zmbv_format_t GetDecodedFrame(void * output, char * pal);
+
+	// Spreads the motion search of delta frames over this many threads
+	void SetSearchThreads(int count);
 };
 
 #endif
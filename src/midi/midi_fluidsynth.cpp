@@ -39,6 +39,7 @@
 
 
 static constexpr int FRAMES_PER_BUFFER = 512; // synth granularity
+static constexpr int SAMPLES_PER_BUFFER = FRAMES_PER_BUFFER * 2; // L & R
 
 MidiHandlerFluidsynth instance;
 
@@ -180,7 +181,9 @@ static std::string find_sf_file(const std::string &name)
 }
 
 MidiHandlerFluidsynth::MidiHandlerFluidsynth()
-        : soft_limiter("FSYNTH"),
+        : rendered_buffers(num_buffers,
+                           std::vector<int16_t>(SAMPLES_PER_BUFFER)),
+          soft_limiter("FSYNTH"),
           keep_rendering(false)
 {}
 
@@ -304,7 +307,7 @@ bool MidiHandlerFluidsynth::Open(MAYBE_UNUSED const char *conf)
 	const auto render = std::bind(&MidiHandlerFluidsynth::Render, this);
 	renderer = std::thread(render);
 	set_thread_name(renderer, "dosbox:fsynth");
-	play_buffer = playable.Dequeue(); // populate the first play buffer
+	play_buffer = rendered_buffers.AcquireRead(); // wait for the first buffer
 
 	// Start playback
 	channel->Enable(true);
@@ -326,17 +329,18 @@ void MidiHandlerFluidsynth::Close()
 	if (channel)
 		channel->Enable(false);
 
-	// Stop rendering and drain the rings
+	// Stop rendering and wake the renderer if it's waiting for a buffer
 	keep_rendering = false;
-	if (!backstock.Size())
-		backstock.Enqueue(std::move(play_buffer));
-	while (playable.Size())
-		play_buffer = playable.Dequeue();
+	rendered_buffers.Stop();
 
 	// Wait for the rendering thread to finish
 	if (renderer.joinable())
 		renderer.join();
 
+	// Discard the unplayed buffers
+	play_buffer = nullptr;
+	rendered_buffers.Reset();
+
 	soft_limiter.PrintStats();
 
 	// Reset the members
@@ -397,10 +401,14 @@ void MidiHandlerFluidsynth::MixerCallBack(uint16_t requested_frames)
 	while (requested_frames) {
 		const auto frames_to_be_played = std::min(GetRemainingFrames(),
 		                                          requested_frames);
-		const auto sample_offset_in_buffer = play_buffer.data() +
+		if (!play_buffer) { // the ring was stopped
+			channel->AddSilence();
+			return;
+		}
+		const auto sample_offset_in_buffer = play_buffer->data() +
 		                                     last_played_frame * 2;
 
-		assert(frames_to_be_played <= play_buffer.size());
+		assert(frames_to_be_played <= play_buffer->size());
 		channel->AddSamples_s16(frames_to_be_played, sample_offset_in_buffer);
 
 		requested_frames -= frames_to_be_played;
@@ -415,9 +423,10 @@ uint16_t MidiHandlerFluidsynth::GetRemainingFrames()
 	if (last_played_frame < FRAMES_PER_BUFFER)
 		return FRAMES_PER_BUFFER - last_played_frame;
 
-	// Otherwise put the spent buffer in backstock and get the next buffer
-	backstock.Enqueue(std::move(play_buffer));
-	play_buffer = playable.Dequeue();
+	// Otherwise hand the spent buffer back to the renderer and get the next
+	if (play_buffer)
+		rendered_buffers.ReleaseRead();
+	play_buffer = rendered_buffers.AcquireRead();
 	last_played_frame = 0; // reset the frame counter to the beginning
 
 	return FRAMES_PER_BUFFER;
@@ -426,28 +435,24 @@ uint16_t MidiHandlerFluidsynth::GetRemainingFrames()
 // Populates the playable queue with freshly rendered buffers
 void MidiHandlerFluidsynth::Render()
 {
-	// Allocate our buffers once and reuse for the duration.
-	constexpr auto SAMPLES_PER_BUFFER = FRAMES_PER_BUFFER * 2; // L & R
+	// Allocate our render buffer once and reuse for the duration. The
+	// playable buffers are preallocated in the ring.
 	std::vector<float> render_buffer(SAMPLES_PER_BUFFER);
-	std::vector<int16_t> playable_buffer(SAMPLES_PER_BUFFER);
-
-	// Populate the backstock using copies of the current buffer.
-	while (backstock.Size() < backstock.MaxCapacity() - 1)
-		backstock.Enqueue(playable_buffer);
-	backstock.Enqueue(std::move(playable_buffer));
-	assert(backstock.Size() == backstock.MaxCapacity());
 
 	while (keep_rendering.load()) {
 		fluid_synth_write_float(synth.get(), FRAMES_PER_BUFFER,
 		                        render_buffer.data(), 0, 2,
 		                        render_buffer.data(), 1, 2);
 
-		// Grab the next buffer from backstock and populate it ...
-		playable_buffer = backstock.Dequeue();
+		// Wait for a free slot in the ring and populate it ...
+		auto playable_buffer = rendered_buffers.AcquireWrite();
+		if (!playable_buffer) // the ring was stopped
+			break;
 		soft_limiter.Process(render_buffer, FRAMES_PER_BUFFER,
-		                     playable_buffer);
-		// and then move it into the playable queue
-		playable.Enqueue(std::move(playable_buffer));
+		                     *playable_buffer);
+
+		// and then pass it to the mixer callback
+		rendered_buffers.CommitWrite();
 	}
 }
 
@@ -34,12 +34,14 @@
 #include <thread>
 
 #include "mixer.h"
-#include "rwqueue.h"
 #include "soft_limiter.h"
+#include "spsc_ring.h"
 
 class MidiHandlerFluidsynth final : public MidiHandler {
 public:
 	MidiHandlerFluidsynth();
+	MidiHandlerFluidsynth(const MidiHandlerFluidsynth &) = delete; // prevent copying
+	MidiHandlerFluidsynth &operator=(const MidiHandlerFluidsynth &) = delete; // prevent assignment
 	~MidiHandlerFluidsynth() override;
 	void PrintStats();
 	const char *GetName() const override { return "fluidsynth"; }
@@ -65,10 +67,12 @@ private:
 	channel_t channel{nullptr, MIXER_DelChannel};
 	std::string selected_font = "";
 
-	std::vector<int16_t> play_buffer = {};
+	// Rendered buffers are filled in-place by the renderer thread and
+	// played in-place by the mixer callback, which holds the play_buffer
+	// slot until it has been fully played.
 	static constexpr auto num_buffers = 8;
-	RWQueue<std::vector<int16_t>> playable{num_buffers};
-	RWQueue<std::vector<int16_t>> backstock{num_buffers};
+	SPSCRing<std::vector<int16_t>> rendered_buffers;
+	std::vector<int16_t> *play_buffer = nullptr;
 
 	std::thread renderer = {};
 	SoftLimiter soft_limiter;
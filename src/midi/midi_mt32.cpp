@@ -45,6 +45,7 @@
 
 // Buffer sizes
 static constexpr int FRAMES_PER_BUFFER = 1024; // synth granularity
+static constexpr int SAMPLES_PER_BUFFER = FRAMES_PER_BUFFER * 2; // L & R
 
 // Analogue circuit modes: DIGITAL_ONLY, COARSE, ACCURATE, OVERSAMPLED
 constexpr auto ANALOG_MODE = MT32Emu::AnalogOutputMode_ACCURATE;
@@ -317,7 +318,9 @@ static mt32emu_report_handler_i get_report_handler_interface()
 }
 
 MidiHandler_mt32::MidiHandler_mt32()
-        : soft_limiter("MT32"),
+        : rendered_buffers(num_buffers,
+                           std::vector<int16_t>(SAMPLES_PER_BUFFER)),
+          soft_limiter("MT32"),
           keep_rendering(false)
 {}
 
@@ -409,7 +412,7 @@ bool MidiHandler_mt32::Open(MAYBE_UNUSED const char *conf)
 	const auto render = std::bind(&MidiHandler_mt32::Render, this);
 	renderer = std::thread(render);
 	set_thread_name(renderer, "dosbox:mt32");
-	play_buffer = playable.Dequeue(); // populate the first play buffer
+	play_buffer = rendered_buffers.AcquireRead(); // wait for the first buffer
 
 	// Start playback
 	channel->Enable(true);
@@ -456,17 +459,18 @@ void MidiHandler_mt32::Close()
 	if (channel)
 		channel->Enable(false);
 
-	// Stop rendering and drain the rings
+	// Stop rendering and wake the renderer if it's waiting for a buffer
 	keep_rendering = false;
-	if (!backstock.Size())
-		backstock.Enqueue(std::move(play_buffer));
-	while (playable.Size())
-		play_buffer = playable.Dequeue();
+	rendered_buffers.Stop();
 
 	// Wait for the rendering thread to finish
 	if (renderer.joinable())
 		renderer.join();
 
+	// Discard the unplayed buffers
+	play_buffer = nullptr;
+	rendered_buffers.Reset();
+
 	// Stop the synthesizer
 	if (service)
 		service->closeSynth();
@@ -512,7 +516,11 @@ void MidiHandler_mt32::MixerCallBack(uint16_t requested_frames)
 	while (requested_frames) {
 		const auto frames_to_be_played = std::min(GetRemainingFrames(),
 		                                          requested_frames);
-		const auto sample_offset_in_buffer = play_buffer.data() +
+		if (!play_buffer) { // the ring was stopped
+			channel->AddSilence();
+			return;
+		}
+		const auto sample_offset_in_buffer = play_buffer->data() +
 		                                     last_played_frame * 2;
 		channel->AddSamples_s16(frames_to_be_played, sample_offset_in_buffer);
 		requested_frames -= frames_to_be_played;
@@ -527,9 +535,10 @@ uint16_t MidiHandler_mt32::GetRemainingFrames()
 	if (last_played_frame < FRAMES_PER_BUFFER)
 		return FRAMES_PER_BUFFER - last_played_frame;
 
-	// Otherwise put the spent buffer in backstock and get the next buffer
-	backstock.Enqueue(std::move(play_buffer));
-	play_buffer = playable.Dequeue();
+	// Otherwise hand the spent buffer back to the renderer and get the next
+	if (play_buffer)
+		rendered_buffers.ReleaseRead();
+	play_buffer = rendered_buffers.AcquireRead();
 	total_buffers_played++;
 	last_played_frame = 0; // reset the frame counter to the beginning
 
@@ -539,28 +548,24 @@ uint16_t MidiHandler_mt32::GetRemainingFrames()
 // Keep the playable queue populated with freshly rendered buffers
 void MidiHandler_mt32::Render()
 {
-	// Allocate our buffers once and reuse for the duration.
-	constexpr auto SAMPLES_PER_BUFFER = FRAMES_PER_BUFFER * 2; // L & R
+	// Allocate our render buffer once and reuse for the duration. The
+	// playable buffers are preallocated in the ring.
 	std::vector<float> render_buffer(SAMPLES_PER_BUFFER);
-	std::vector<int16_t> playable_buffer(SAMPLES_PER_BUFFER);
-
-	// Populate the backstock using copies of the current buffer.
-	while (backstock.Size() < backstock.MaxCapacity() - 1)
-		backstock.Enqueue(playable_buffer);
-	backstock.Enqueue(std::move(playable_buffer));
-	assert(backstock.Size() == backstock.MaxCapacity());
 
 	while (keep_rendering.load()) {
 		{
 			const std::lock_guard<std::mutex> lock(service_mutex);
 			service->renderFloat(render_buffer.data(), FRAMES_PER_BUFFER);
 		}
-		// Grab the next buffer from backstock and populate it ...
-		playable_buffer = backstock.Dequeue();
-		soft_limiter.Process(render_buffer, FRAMES_PER_BUFFER, playable_buffer);
-
-		// and then move it into the playable queue
-		playable.Enqueue(std::move(playable_buffer));
+		// Wait for a free slot in the ring and populate it ...
+		auto playable_buffer = rendered_buffers.AcquireWrite();
+		if (!playable_buffer) // the ring was stopped
+			break;
+		soft_limiter.Process(render_buffer, FRAMES_PER_BUFFER,
+		                     *playable_buffer);
+
+		// and then pass it to the mixer callback
+		rendered_buffers.CommitWrite();
 	}
 }
 
@@ -36,8 +36,8 @@
 #include <mt32emu/mt32emu.h>
 
 #include "mixer.h"
-#include "rwqueue.h"
 #include "soft_limiter.h"
+#include "spsc_ring.h"
 
 static_assert(MT32EMU_VERSION_MAJOR > 2 ||
                       (MT32EMU_VERSION_MAJOR == 2 && MT32EMU_VERSION_MINOR >= 5),
@@ -51,6 +51,8 @@ public:
 	using service_t = std::unique_ptr<MT32Emu::Service>;
 
 	MidiHandler_mt32();
+	MidiHandler_mt32(const MidiHandler_mt32 &) = delete; // prevent copying
+	MidiHandler_mt32 &operator=(const MidiHandler_mt32 &) = delete; // prevent assignment
 	~MidiHandler_mt32() override;
 	void Close() override;
 	const char *GetName() const override { return "mt32"; }
@@ -69,10 +71,12 @@ private:
 	// Managed objects
 	channel_t channel{nullptr, MIXER_DelChannel};
 
-	std::vector<int16_t> play_buffer = {};
+	// Rendered buffers are filled in-place by the renderer thread and
+	// played in-place by the mixer callback, which holds the play_buffer
+	// slot until it has been fully played.
 	static constexpr auto num_buffers = 4;
-	RWQueue<std::vector<int16_t>> playable{num_buffers};
-	RWQueue<std::vector<int16_t>> backstock{num_buffers};
+	SPSCRing<std::vector<int16_t>> rendered_buffers;
+	std::vector<int16_t> *play_buffer = nullptr;
 
 	std::mutex service_mutex = {};
 	service_t service = {};
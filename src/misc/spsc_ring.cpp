@@ -0,0 +1,174 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "spsc_ring.h"
+
+#include <cassert>
+#include <thread>
+
+constexpr int spin_limit = 64;
+
+template <typename T>
+SPSCRing<T>::SPSCRing(size_t num_slots, const T &prototype)
+        : slots(num_slots, prototype),
+          capacity(num_slots)
+{
+	assert(capacity > 0);
+}
+
+template <typename T>
+size_t SPSCRing<T>::MaxCapacity() const
+{
+	return capacity;
+}
+
+template <typename T>
+size_t SPSCRing<T>::Size() const
+{
+	// Read the consumer's index first so the difference can't underflow
+	const auto r = read_index.load(std::memory_order_acquire);
+	const auto w = write_index.load(std::memory_order_acquire);
+	return w - r;
+}
+
+template <typename T>
+bool SPSCRing<T>::IsEmpty() const
+{
+	return Size() == 0;
+}
+
+template <typename T>
+bool SPSCRing<T>::IsStopped() const
+{
+	return is_stopped.load(std::memory_order_acquire);
+}
+
+template <typename T>
+T *SPSCRing<T>::AcquireWrite(bool wait)
+{
+	// Only the producer moves write_index, so a relaxed load is current
+	const auto w = write_index.load(std::memory_order_relaxed);
+	while (!IsStopped()) {
+		if (w - read_index.load(std::memory_order_acquire) < capacity)
+			return &slots[w % capacity];
+		if (!wait)
+			return nullptr;
+		Wait(true);
+	}
+	return nullptr;
+}
+
+template <typename T>
+void SPSCRing<T>::CommitWrite()
+{
+	const auto w = write_index.load(std::memory_order_relaxed);
+	assert(w - read_index.load(std::memory_order_acquire) < capacity);
+	write_index.store(w + 1, std::memory_order_seq_cst);
+	WakeWaiters();
+}
+
+template <typename T>
+T *SPSCRing<T>::AcquireRead(bool wait)
+{
+	// Only the consumer moves read_index, so a relaxed load is current
+	const auto r = read_index.load(std::memory_order_relaxed);
+	while (!IsStopped()) {
+		if (write_index.load(std::memory_order_acquire) != r)
+			return &slots[r % capacity];
+		if (!wait)
+			return nullptr;
+		Wait(false);
+	}
+	return nullptr;
+}
+
+template <typename T>
+void SPSCRing<T>::ReleaseRead()
+{
+	const auto r = read_index.load(std::memory_order_relaxed);
+	assert(write_index.load(std::memory_order_acquire) != r);
+	read_index.store(r + 1, std::memory_order_seq_cst);
+	WakeWaiters();
+}
+
+// Sleeps until the other side moves its index or the ring is stopped. The
+// waiter count is raised before re-checking the condition, and the other side
+// publishes its index before reading the count (both sequentially
+// consistent), so either the waiter sees the update or the updater sees the
+// waiter; a wakeup can't be lost.
+template <typename T>
+void SPSCRing<T>::Wait(bool for_write)
+{
+	const auto is_ready = [this, for_write]() {
+		if (is_stopped.load(std::memory_order_seq_cst))
+			return true;
+		const auto r = read_index.load(std::memory_order_seq_cst);
+		const auto w = write_index.load(std::memory_order_seq_cst);
+		return for_write ? (w - r < capacity) : (w != r);
+	};
+	// The other side usually needs only a moment, so briefly yield before
+	// paying for a sleep and wakeup
+	for (int i = 0; i < spin_limit; ++i) {
+		if (is_ready())
+			return;
+		std::this_thread::yield();
+	}
+
+	num_waiting.fetch_add(1, std::memory_order_seq_cst);
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeup.wait(lock, is_ready);
+	}
+	num_waiting.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+template <typename T>
+void SPSCRing<T>::WakeWaiters()
+{
+	if (num_waiting.load(std::memory_order_seq_cst) == 0)
+		return;
+	// Taking the lock orders us after a waiter's last condition check
+	{ const std::lock_guard<std::mutex> lock(mutex); }
+	wakeup.notify_all();
+}
+
+template <typename T>
+void SPSCRing<T>::Stop()
+{
+	is_stopped.store(true, std::memory_order_seq_cst);
+	{ const std::lock_guard<std::mutex> lock(mutex); }
+	wakeup.notify_all();
+}
+
+template <typename T>
+void SPSCRing<T>::Reset()
+{
+	assert(num_waiting.load() == 0);
+	read_index = 0;
+	write_index = 0;
+	is_stopped = false;
+}
+
+// Explicit template instantiations
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#include <vector>
+template class SPSCRing<int>; // Unit tests
+template class SPSCRing<std::vector<int16_t>>; // MT-32 and FluidSynth
+template class SPSCRing<std::vector<uint8_t>>; // Video capture
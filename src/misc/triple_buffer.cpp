@@ -0,0 +1,124 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "triple_buffer.h"
+
+#include <cassert>
+
+template <typename T>
+TripleBuffer<T>::TripleBuffer(const T &prototype) : slots(3, prototype)
+{}
+
+template <typename T>
+T &TripleBuffer<T>::WriteSlot()
+{
+	return slots[write_index];
+}
+
+template <typename T>
+bool TripleBuffer<T>::Publish()
+{
+	// The exchange releases our writes to the slot and hands us back
+	// whichever slot was in the middle, read or not
+	const auto previous = middle.exchange(write_index | fresh_flag,
+	                                      std::memory_order_seq_cst);
+	write_index = previous & index_mask;
+
+	// Only signal when there is a sleeper; see Wait()
+	if (num_waiting.load(std::memory_order_seq_cst) != 0) {
+		{ const std::lock_guard<std::mutex> lock(mutex); }
+		wakeup.notify_one();
+	}
+	return (previous & fresh_flag) == 0;
+}
+
+template <typename T>
+bool TripleBuffer<T>::HasNew() const
+{
+	return (middle.load(std::memory_order_acquire) & fresh_flag) != 0;
+}
+
+template <typename T>
+T *TripleBuffer<T>::AcquireRead(bool wait)
+{
+	while (!IsStopped()) {
+		if (HasNew()) {
+			// Only the consumer clears the flag, so the middle slot
+			// is still fresh when we swap ours in
+			const auto previous = middle.exchange(read_index,
+			                                      std::memory_order_acq_rel);
+			assert(previous & fresh_flag);
+			read_index = previous & index_mask;
+			return &slots[read_index];
+		}
+		if (!wait)
+			return nullptr;
+		Wait();
+	}
+	return nullptr;
+}
+
+// The waiter count is raised before re-checking for a new item, and the
+// producer publishes before reading the count (both sequentially
+// consistent), so either the waiter sees the item or the producer sees the
+// waiter; a wakeup can't be lost.
+template <typename T>
+void TripleBuffer<T>::Wait()
+{
+	const auto is_ready = [this]() {
+		return is_stopped.load(std::memory_order_seq_cst) ||
+		       (middle.load(std::memory_order_seq_cst) & fresh_flag);
+	};
+	num_waiting.fetch_add(1, std::memory_order_seq_cst);
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeup.wait(lock, is_ready);
+	}
+	num_waiting.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+template <typename T>
+void TripleBuffer<T>::Stop()
+{
+	is_stopped.store(true, std::memory_order_seq_cst);
+	{ const std::lock_guard<std::mutex> lock(mutex); }
+	wakeup.notify_all();
+}
+
+template <typename T>
+bool TripleBuffer<T>::IsStopped() const
+{
+	return is_stopped.load(std::memory_order_acquire);
+}
+
+template <typename T>
+void TripleBuffer<T>::Reset()
+{
+	assert(num_waiting.load() == 0);
+	write_index = 0;
+	middle = 1;
+	read_index = 2;
+	is_stopped = false;
+}
+
+// Explicit template instantiations
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+template class TripleBuffer<int>; // Unit tests
+template class TripleBuffer<std::vector<uint8_t>>; // OpenGL presenter
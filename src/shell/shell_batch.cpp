@@ -18,6 +18,7 @@
 
 #include "shell.h"
 
+#include <algorithm>
 #include <climits>
 #include <stdlib.h>
 #include <string.h>
@@ -65,58 +66,151 @@ BatchFile::~BatchFile() {
 	shell->echo=echo;
 }
 
+// Size and date of the batch file, to tell if it changed since it was read
+bool BatchFile::GetStamp(FileStat_Block &file_stamp) const
+{
+	file_stamp = {};
+	char fullname[DOS_PATHLENGTH];
+	uint8_t drive = 0;
+	if (!DOS_MakeName(filename.c_str(), fullname, &drive))
+		return false;
+	if (Drives[drive]->FileStat(fullname, &file_stamp))
+		return true;
+
+	// Not every drive implements FileStat, disk images don't
+	uint16_t handle = 0;
+	if (!DOS_OpenFile(filename.c_str(), (DOS_NOT_INHERIT | OPEN_READ), &handle))
+		return false;
+	uint32_t size = 0;
+	DOS_SeekFile(handle, &size, DOS_SEEK_END);
+	DOS_GetFileDate(handle, &file_stamp.time, &file_stamp.date);
+	file_stamp.size = size;
+	DOS_CloseFile(handle);
+	return true;
+}
+
+// Reads the whole file, unless the copy we have is still current. Like DOS,
+// we carry on from the same offset if the file was changed under us.
+bool BatchFile::LoadFile()
+{
+	FileStat_Block file_stamp;
+	if (!GetStamp(file_stamp))
+		return false;
+	if (loaded && file_stamp.size == stamp.size &&
+	    file_stamp.date == stamp.date && file_stamp.time == stamp.time)
+		return true;
+
+	if (!DOS_OpenFile(filename.c_str(), (DOS_NOT_INHERIT | OPEN_READ), &file_handle))
+		return false;
+	contents.clear();
+	uint8_t chunk[4096];
+	uint16_t bytes_read = 0;
+	do {
+		bytes_read = sizeof(chunk);
+		if (!DOS_ReadFile(file_handle, chunk, &bytes_read))
+			break;
+		contents.insert(contents.end(), chunk, chunk + bytes_read);
+	} while (bytes_read == sizeof(chunk));
+	DOS_CloseFile(file_handle);
+
+	IndexFile();
+	stamp = file_stamp;
+	loaded = true;
+	return true;
+}
+
+void BatchFile::IndexFile()
+{
+	line_starts.assign(1, 0);
+	for (uint32_t i = 0; i < contents.size(); ++i)
+		if (contents[i] == LINE_FEED)
+			line_starts.push_back(i + 1);
+
+	labels.clear();
+	std::string text;
+	for (size_t n = 0; n < line_starts.size(); ++n) {
+		const uint32_t start = line_starts[n];
+		const uint32_t end = n + 1 < line_starts.size()
+		                             ? line_starts[n + 1]
+		                             : static_cast<uint32_t>(contents.size());
+
+		// Control characters never make it into a label
+		text.clear();
+		for (uint32_t i = start; i < end; ++i)
+			if (contents[i] > UNIT_SEPARATOR)
+				text += static_cast<char>(contents[i]);
+
+		auto c = text.begin();
+		auto is_space = [](char ch) {
+			return isspace(static_cast<unsigned char>(ch)) != 0;
+		};
+		c = std::find_if_not(c, text.end(), is_space);
+		if (c == text.end() || *c != ':')
+			continue;
+
+		// The label follows spaces and '=', up to the next of either
+		c = std::find_if(c + 1, text.end(), [&](char ch) {
+			return !is_space(ch) && ch != '=';
+		});
+		const auto label_end = std::find_if(c, text.end(), [&](char ch) {
+			return is_space(ch) || ch == '=';
+		});
+		std::string label(c, label_end);
+		upcase(label);
+
+		// The first of several same labels is the one GOTO finds
+		labels.emplace(label, end);
+	}
+}
+
 // TODO: Refactor this sprawling function into smaller ones without GOTOs
 bool BatchFile::ReadLine(char * line) {
-	//Open the batchfile and seek to stored postion
-	if (!DOS_OpenFile(filename.c_str(),(DOS_NOT_INHERIT|OPEN_READ),&file_handle)) {
+	//Get the batchfile, if it's not loaded or has changed
+	if (!LoadFile()) {
 		LOG(LOG_MISC,LOG_ERROR)("ReadLine Can't open BatchFile %s",filename.c_str());
 		delete this;
 		return false;
 	}
-	DOS_SeekFile(file_handle,&(this->location),DOS_SEEK_SET);
 
-	uint16_t bytes_read = 1;
-	uint8_t data = 0;
 	char val = 0;
 	char temp[CMD_MAXLINE] = "";
 	char temp_cycles_hack[CMD_MAXLINE];
 emptyline:
 	char * cmd_write=temp;
-	do {
-		bytes_read = 1;
-		DOS_ReadFile(file_handle, &data, &bytes_read);
-		val = static_cast<char>(data);
-
-		if (bytes_read > 0) {
-			/* Inclusion criteria:
-			 *  - backspace for alien odyssey
-			 *  - tab for batch files
-			 *  - escape for ANSI
-			 * Note: the negative allowance permits high
-			 * international ASCII characters that are wrapped when
-			 * char is a signed type
-			 */
-			if (val < 0 || val > UNIT_SEPARATOR ||
-			    val == BACKSPACE || val == ESC || val == TAB) {
-				// Only add it if room for it (and trailing zero)
-				// in the buffer, but do the check here instead
-				// at the end So we continue reading till EOL/EOF
-				if (cmd_write - temp + 1 < CMD_MAXLINE - 1) {
-					*cmd_write++ = val;
-				}
-			} else if (val != LINE_FEED && val != CARRIAGE_RETURN) {
-				shell->WriteOut(MSG_Get("SHELL_ILLEGAL_CONTROL_CHARACTER"),
-				                val, val);
-			}
-		}
-	} while (val != LINE_FEED && bytes_read);
-	*cmd_write=0;
-	if (!bytes_read && cmd_write == temp) {
-		//Close file and delete bat file
-		DOS_CloseFile(file_handle);
+	if (location >= contents.size()) {
+		//End of file, delete bat file
 		delete this;
 		return false;
 	}
+	const auto next_line = std::upper_bound(line_starts.begin(),
+	                                        line_starts.end(), location);
+	const uint32_t line_end = (next_line != line_starts.end())
+	                                  ? *next_line
+	                                  : static_cast<uint32_t>(contents.size());
+	for (; location < line_end; ++location) {
+		val = static_cast<char>(contents[location]);
+		/* Inclusion criteria:
+		 *  - backspace for alien odyssey
+		 *  - tab for batch files
+		 *  - escape for ANSI
+		 * Note: the negative allowance permits high
+		 * international ASCII characters that are wrapped when
+		 * char is a signed type
+		 */
+		if (val < 0 || val > UNIT_SEPARATOR ||
+		    val == BACKSPACE || val == ESC || val == TAB) {
+			// Only add it if room for it (and trailing zero)
+			// in the buffer, but do the check here instead
+			// at the end So we continue reading till EOL/EOF
+			if (cmd_write - temp + 1 < CMD_MAXLINE - 1) {
+				*cmd_write++ = val;
+			}
+		} else if (val != LINE_FEED && val != CARRIAGE_RETURN) {
+			shell->WriteOut(MSG_Get("SHELL_ILLEGAL_CONTROL_CHARACTER"),
+			                val, val);
+		}
+	}
+	*cmd_write=0;
 	if (!strlen(temp)) goto emptyline;
 	if (temp[0]==':') goto emptyline;
 
@@ -203,80 +297,27 @@ emptyline:
 		}
 	}
 	*cmd_write = 0;
-	//Store current location and close bat file
-	this->location = 0;
-	DOS_SeekFile(file_handle,&(this->location),DOS_SEEK_CUR);
-	DOS_CloseFile(file_handle);
-	return true;	
+	return true;
 }
 
-// TODO: Refactor this sprawling function into smaller ones without GOTOs
 bool BatchFile::Goto(char * where) {
-	//Open bat file and search for the where string
-	if (!DOS_OpenFile(filename.c_str(),(DOS_NOT_INHERIT|OPEN_READ),&file_handle)) {
+	//Get the batchfile, if it's not loaded or has changed
+	if (!LoadFile()) {
 		LOG(LOG_MISC,LOG_ERROR)("SHELL:Goto Can't open BatchFile %s",filename.c_str());
 		delete this;
 		return false;
 	}
 
-	char cmd_buffer[CMD_MAXLINE] = "";
-	char *cmd_write = nullptr;
-
-	/* Scan till we have a match or return false */
-	uint16_t bytes_read = 1;
-	uint8_t data = 0;
-	char val = 0;
-again:
-	cmd_write=cmd_buffer;
-	do {
-		bytes_read = 1;
-		DOS_ReadFile(file_handle, &data, &bytes_read);
-		val = static_cast<char>(data);
-		if (bytes_read > 0) {
-			// Note: the negative allowance permits high
-			// international ASCII characters that are wrapped when
-			// char is a signed type
-			if (val < 0 || val > UNIT_SEPARATOR) {
-				if (cmd_write - cmd_buffer + 1 < CMD_MAXLINE - 1) {
-					*cmd_write++ = val;
-				}
-			} else if (val != BACKSPACE && val != CARRIAGE_RETURN &&
-			           val != ESC && val != LINE_FEED && val != TAB) {
-				shell->WriteOut(MSG_Get("SHELL_ILLEGAL_CONTROL_CHARACTER"),
-				                val, val);
-			}
-		}
-	} while (val != LINE_FEED && bytes_read);
-	*cmd_write++ = 0;
-	char *nospace = trim(cmd_buffer);
-	if (nospace[0] == ':') {
-		nospace++; //Skip :
-		//Strip spaces and = from it.
-		while(*nospace && (isspace(*reinterpret_cast<unsigned char*>(nospace)) || (*nospace == '=')))
-			nospace++;
-
-		//label is until space/=/eol
-		char* const beginlabel = nospace;
-		while(*nospace && !isspace(*reinterpret_cast<unsigned char*>(nospace)) && (*nospace != '=')) 
-			nospace++;
-
-		*nospace = 0;
-		if (strcasecmp(beginlabel,where)==0) {
-		//Found it! Store location and continue
-			this->location = 0;
-			DOS_SeekFile(file_handle,&(this->location),DOS_SEEK_CUR);
-			DOS_CloseFile(file_handle);
-			return true;
-		}
-	   
-	}
-	if (!bytes_read) {
-		DOS_CloseFile(file_handle);
+	std::string label = where;
+	upcase(label);
+	const auto found = labels.find(label);
+	if (found == labels.end()) {
 		delete this;
 		return false;
 	}
-	goto again;
-	return false;
+	//Found it! Continue after the label
+	location = found->second;
+	return true;
 }
 
 void BatchFile::Shift()
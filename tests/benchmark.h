@@ -0,0 +1,55 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_TESTS_BENCHMARK_H
+#define DOSBOX_TESTS_BENCHMARK_H
+
+/*
+Benchmarks are gtest cases in test suites named <Something>Benchmark, kept
+in the unit test file of the code they measure. The unit test runs leave
+them out; they run with:
+
+  meson test --benchmark
+
+They check their results like any other test, and print what they measured
+with benchmark_report.
+*/
+
+#include <chrono>
+#include <cstdio>
+
+// Returns the seconds one call of the function takes, averaged over runs
+template <typename Function>
+double benchmark_seconds(const int runs, Function &&function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; ++i)
+		function();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+	                                              start;
+	return elapsed.count() / runs;
+}
+
+inline void benchmark_report(const char *what, const double value, const char *unit)
+{
+	printf("%-40s %12.2f %s\n", what, value, unit);
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "cycle_governor.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace {
+
+// A simulated host spending a fixed time on each emulated cycle
+struct Host {
+	double us_per_cycle = 0.0;
+	double idle_share = 0.0; // of the cycles the guest gives up
+};
+
+// Runs one window's worth of host time through the governor
+CycleGovernor::Outcome run_window(CycleGovernor &governor, int64_t &now_us,
+                                  int32_t &cycles, const Host &host,
+                                  int32_t limit = 0)
+{
+	constexpr auto window = CycleGovernor::window_us;
+	const double busy_per_tick = cycles * (1 - host.idle_share) *
+	                             host.us_per_cycle;
+	const double load = busy_per_tick / 1000;
+
+	// Falling behind when overloaded, sleeping the rest of the time if not
+	const auto ticks = static_cast<uint32_t>(
+	        std::max(1.0, load <= 1 ? window / 1000.0 : window / 1000.0 / load));
+	governor.AddTicks(ticks);
+	governor.AddSleep(std::max<int64_t>(
+	        0, window - static_cast<int64_t>(ticks * busy_per_tick)));
+	now_us += window;
+
+	const auto idle_cycles = static_cast<int64_t>(cycles * host.idle_share *
+	                                              ticks);
+	return governor.Update(now_us, cycles, idle_cycles, 100, limit);
+}
+
+TEST(CycleGovernor, FirstUpdateStartsWindow)
+{
+	CycleGovernor governor;
+	int32_t cycles = 3000;
+	EXPECT_EQ(governor.Update(0, cycles, 0, 100, 0),
+	          CycleGovernor::Outcome::Restarted);
+	EXPECT_EQ(governor.Update(1000, cycles, 0, 100, 0),
+	          CycleGovernor::Outcome::Measuring);
+	EXPECT_EQ(cycles, 3000);
+}
+
+TEST(CycleGovernor, SettlesOnTargetWithoutCap)
+{
+	// 3 million cycles per ms take 90% of this host
+	const Host host = {0.0003};
+	CycleGovernor governor;
+	int64_t now = 0;
+	int32_t cycles = 3000;
+	governor.Update(now, cycles, 0, 100, 0);
+
+	int32_t peak = 0;
+	for (int i = 0; i < 40; ++i) {
+		EXPECT_EQ(run_window(governor, now, cycles, host),
+		          CycleGovernor::Outcome::Adjusted);
+		peak = std::max(peak, cycles);
+	}
+	const auto &state = governor.GetState();
+	EXPECT_NEAR(state.target, 0.9, 1e-9);
+	EXPECT_NEAR(state.load, 0.9, 0.01);
+	EXPECT_NEAR(cycles, 3000000, 30000);
+
+	// Approached from below without swinging past the target
+	EXPECT_LT(peak, 3000000 * 1.05);
+}
+
+TEST(CycleGovernor, BacksOffWhenOverloaded)
+{
+	// Only 100k cycles per ms fit into 90% of this host
+	const Host host = {0.009};
+	CycleGovernor governor;
+	int64_t now = 0;
+	int32_t cycles = 2000000;
+	governor.Update(now, cycles, 0, 100, 0);
+
+	for (int i = 0; i < 40; ++i)
+		run_window(governor, now, cycles, host);
+	EXPECT_NEAR(cycles, 100000, 1000);
+	EXPECT_NEAR(governor.GetState().error, 0.0, 0.01);
+}
+
+TEST(CycleGovernor, FollowsPercentage)
+{
+	const Host host = {0.0003};
+	CycleGovernor governor;
+	int64_t now = 0;
+	int32_t cycles = 3000;
+	governor.Update(now, cycles, 0, 50, 0);
+
+	for (int i = 0; i < 40; ++i) {
+		governor.AddTicks(25);
+		governor.AddSleep(CycleGovernor::window_us -
+		                  static_cast<int64_t>(25 * cycles * host.us_per_cycle));
+		now += CycleGovernor::window_us;
+		governor.Update(now, cycles, 0, 50, 0);
+	}
+	EXPECT_NEAR(governor.GetState().load, 0.45, 0.01);
+}
+
+TEST(CycleGovernor, LimitDoesNotWindUp)
+{
+	const Host host = {0.0003};
+	CycleGovernor governor;
+	int64_t now = 0;
+	int32_t cycles = 3000;
+	governor.Update(now, cycles, 0, 100, 0);
+
+	for (int i = 0; i < 40; ++i)
+		run_window(governor, now, cycles, host, 50000);
+	EXPECT_EQ(cycles, 50000);
+	EXPECT_GT(governor.GetState().error, 0.8);
+
+	// The same host getting slower is followed right away, even after
+	// sitting at the limit for a while
+	const Host slower = {0.018};
+	for (int i = 0; i < 10; ++i)
+		run_window(governor, now, cycles, slower, 50000);
+	EXPECT_NEAR(cycles, 50000, 1000);
+	for (int i = 0; i < 2; ++i)
+		run_window(governor, now, cycles, {0.036}, 50000);
+	EXPECT_LT(cycles, 50000);
+}
+
+TEST(CycleGovernor, IdleGuestHoldsCycles)
+{
+	Host host = {0.0003, 0.99};
+	CycleGovernor governor;
+	int64_t now = 0;
+	int32_t cycles = 80000;
+	governor.Update(now, cycles, 0, 100, 0);
+
+	for (int i = 0; i < 10; ++i)
+		EXPECT_EQ(run_window(governor, now, cycles, host),
+		          CycleGovernor::Outcome::Restarted);
+	EXPECT_EQ(cycles, 80000);
+
+	// Half idle is still measured, scaled up to all cycles running
+	host.idle_share = 0.5;
+	for (int i = 0; i < 40; ++i)
+		run_window(governor, now, cycles, host);
+	EXPECT_NEAR(cycles, 3000000, 30000);
+}
+
+TEST(CycleGovernor, StallIsDiscarded)
+{
+	CycleGovernor governor;
+	int64_t now = 0;
+	int32_t cycles = 80000;
+	governor.Update(now, cycles, 0, 100, 0);
+
+	governor.AddTicks(25);
+	now += 2000000;
+	EXPECT_EQ(governor.Update(now, cycles, 0, 100, 0),
+	          CycleGovernor::Outcome::Restarted);
+	EXPECT_EQ(cycles, 80000);
+}
+
+TEST(CycleGovernor, ResetWindow)
+{
+	CycleGovernor governor;
+	int64_t now = 0;
+	int32_t cycles = 80000;
+	governor.Update(now, cycles, 0, 100, 0);
+	governor.AddTicks(20);
+	governor.ResetWindow();
+
+	now += CycleGovernor::window_us;
+	EXPECT_EQ(governor.Update(now, cycles, 0, 100, 0),
+	          CycleGovernor::Outcome::Restarted);
+	now += 1000;
+	EXPECT_EQ(governor.Update(now, cycles, 0, 100, 0),
+	          CycleGovernor::Outcome::Measuring);
+}
+
+} // namespace
@@ -0,0 +1,185 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "inout.h"
+
+#include <gtest/gtest.h>
+
+#include "benchmark.h"
+
+namespace {
+
+uint64_t write_sum = 0;
+Bitu last_write = 0;
+Bitu last_write_len = 0;
+
+Bitu read_port(io_port_t port, Bitu /*iolen*/)
+{
+	return port & 0xff;
+}
+
+void write_port(io_port_t /*port*/, io_val_t val, Bitu iolen)
+{
+	write_sum += val;
+	last_write = val;
+	last_write_len = iolen;
+}
+
+Bitu read_word(io_port_t /*port*/, Bitu iolen)
+{
+	return iolen == 2 ? 0x1234 : 0x12;
+}
+
+struct Device {
+	Bitu status = 0x5a;
+
+	Bitu Read(io_port_t /*port*/, Bitu /*iolen*/) const { return status; }
+};
+
+// Each test uses its own ports, the handler tables are global
+TEST(IOHandler, ReadByte)
+{
+	IO_RegisterReadHandler(0x3da, read_port, IO_MB);
+	EXPECT_EQ(IO_ReadB(0x3da), 0xdau);
+	IO_FreeReadHandler(0x3da, IO_MB);
+}
+
+TEST(IOHandler, WriteByte)
+{
+	IO_RegisterWriteHandler(0x3c9, write_port, IO_MB);
+	IO_WriteB(0x3c9, 0x3f);
+	EXPECT_EQ(last_write, 0x3fu);
+	EXPECT_EQ(last_write_len, 1u);
+	IO_FreeWriteHandler(0x3c9, IO_MB);
+}
+
+TEST(IOHandler, BoundHandler)
+{
+	Device device;
+	using namespace std::placeholders;
+	IO_RegisterReadHandler(0x388, std::bind(&Device::Read, &device, _1, _2), IO_MB);
+	EXPECT_EQ(IO_ReadB(0x388), 0x5au);
+	device.status = 0xa5;
+	EXPECT_EQ(IO_ReadB(0x388), 0xa5u);
+	IO_FreeReadHandler(0x388, IO_MB);
+}
+
+TEST(IOHandler, WiderAccessesSplitIntoBytes)
+{
+	IO_RegisterReadHandler(0x220, read_port, IO_MB, 4);
+	IO_RegisterWriteHandler(0x220, write_port, IO_MB, 4);
+	EXPECT_EQ(IO_ReadW(0x221), 0x2221u);
+	EXPECT_EQ(IO_ReadD(0x220), 0x23222120u);
+	write_sum = 0;
+	IO_WriteW(0x220, 0x0201);
+	EXPECT_EQ(write_sum, 3u);
+	EXPECT_EQ(last_write_len, 1u);
+	IO_FreeReadHandler(0x220, IO_MB, 4);
+	IO_FreeWriteHandler(0x220, IO_MB, 4);
+}
+
+TEST(IOHandler, WordHandler)
+{
+	IO_RegisterReadHandler(0x1ce, read_word, IO_MB | IO_MW);
+	IO_RegisterWriteHandler(0x1ce, write_port, IO_MB | IO_MW);
+	EXPECT_EQ(IO_ReadW(0x1ce), 0x1234u);
+	EXPECT_EQ(IO_ReadB(0x1ce), 0x12u);
+	IO_WriteW(0x1ce, 0xbeef);
+	EXPECT_EQ(last_write, 0xbeefu);
+	EXPECT_EQ(last_write_len, 2u);
+	IO_FreeReadHandler(0x1ce, IO_MB | IO_MW);
+	IO_FreeWriteHandler(0x1ce, IO_MB | IO_MW);
+}
+
+TEST(IOHandler, NoHandler)
+{
+	// Reads float high, before and after the port gets blocked
+	EXPECT_EQ(IO_ReadB(0x2f0) & 0xff, 0xffu);
+	EXPECT_EQ(IO_ReadB(0x2f0) & 0xff, 0xffu);
+	IO_WriteB(0x2f0, 0x12);
+}
+
+TEST(IOHandler, FreedHandler)
+{
+	IO_RegisterReadHandler(0x2f8, read_port, IO_MB);
+	EXPECT_EQ(IO_ReadB(0x2f8), 0xf8u);
+	IO_FreeReadHandler(0x2f8, IO_MB);
+	EXPECT_EQ(IO_ReadB(0x2f8) & 0xff, 0xffu);
+}
+
+TEST(IOHandler, HandleObject)
+{
+	{
+		IO_ReadHandleObject object;
+		object.Install(0x3f8, read_port, IO_MB);
+		EXPECT_EQ(IO_ReadB(0x3f8), 0xf8u);
+	}
+	EXPECT_EQ(IO_ReadB(0x3f8) & 0xff, 0xffu);
+}
+
+constexpr int accesses = 20000000;
+
+template <typename Access>
+void report_rate(const char *what, Access &&access)
+{
+	const double seconds = benchmark_seconds(accesses, access);
+	benchmark_report(what, 1e-6 / seconds, "M accesses/s");
+}
+
+TEST(IOHandlerBenchmark, Accesses)
+{
+	Device device;
+	using namespace std::placeholders;
+	IO_RegisterReadHandler(0x3da, read_port, IO_MB, 2);
+	IO_RegisterWriteHandler(0x3c9, write_port, IO_MB);
+	IO_RegisterReadHandler(0x388, std::bind(&Device::Read, &device, _1, _2), IO_MB);
+	IO_RegisterReadHandler(0x1ce, read_word, IO_MB | IO_MW);
+
+	uint64_t sum = 0;
+	report_rate("read byte, plain handler", [&] { sum += IO_ReadB(0x3da); });
+	EXPECT_EQ(sum, uint64_t{0xda} * accesses);
+
+	write_sum = 0;
+	report_rate("write byte, plain handler", [] { IO_WriteB(0x3c9, 0x3f); });
+	EXPECT_EQ(write_sum, uint64_t{0x3f} * accesses);
+
+	sum = 0;
+	report_rate("read byte, bound handler", [&] { sum += IO_ReadB(0x388); });
+	EXPECT_EQ(sum, uint64_t{0x5a} * accesses);
+
+	sum = 0;
+	report_rate("read word, split to bytes", [&] { sum += IO_ReadW(0x3da); });
+	EXPECT_EQ(sum, uint64_t{0xdbda} * accesses);
+
+	sum = 0;
+	report_rate("read word, word handler", [&] { sum += IO_ReadW(0x1ce); });
+	EXPECT_EQ(sum, uint64_t{0x1234} * accesses);
+
+	sum = 0;
+	report_rate("read byte, no handler", [&] { sum += IO_ReadB(0x2f0) & 0xff; });
+	EXPECT_EQ(sum, uint64_t{0xff} * accesses);
+
+	IO_FreeReadHandler(0x3da, IO_MB, 2);
+	IO_FreeWriteHandler(0x3c9, IO_MB);
+	IO_FreeReadHandler(0x388, IO_MB);
+	IO_FreeReadHandler(0x1ce, IO_MB | IO_MW);
+}
+
+} // namespace
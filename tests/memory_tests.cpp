@@ -0,0 +1,159 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "mem.h"
+#include "paging.h"
+#include "setup.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+void MEM_Init(Section *);
+void PAGING_Init(Section *);
+
+namespace {
+
+// 16 MB of guest memory with the A20 gate open, set up once for all tests
+class Memory : public ::testing::Test {
+public:
+	static void SetUpTestSuite()
+	{
+		static bool initialized = false;
+		if (initialized)
+			return;
+		static Section_prop memory_section("dosbox");
+		memory_section.Add_int("memsize", Property::Changeable::WhenIdle, 16);
+		static Section_prop cpu_section("cpu");
+		PAGING_Init(&cpu_section);
+		MEM_Init(&memory_section);
+		MEM_A20_Enable(true);
+		initialized = true;
+	}
+};
+
+class MemoryBenchmark : public Memory {};
+
+// Blocks moved the way an XMS move (function 0Bh) does, with mem_memcpy on
+// physical addresses
+struct Move {
+	const char *name;
+	PhysPt src;
+	PhysPt dest;
+	Bitu size;
+};
+
+const Move moves[] = {
+        {"conventional to extended", 0x20000, 0x200000, 64 * 1024},
+        {"extended to conventional", 0x200000, 0x30000, 64 * 1024},
+        {"extended to extended", 0x400000, 0x600000, 1024 * 1024},
+        // An odd length between unaligned addresses, so no page lines up
+        {"unaligned", 0x400123, 0x900ab1, 60001},
+        // 16 bytes above the source, which repeats the first 16 bytes
+        {"overlapping", 0xa00000, 0xa00010, 64 * 1024},
+};
+
+// mem_memcpy used to copy a byte at a time
+void byte_copy(PhysPt dest, PhysPt src, Bitu size)
+{
+	while (size--)
+		mem_writeb(dest++, mem_readb(src++));
+}
+
+void fill(PhysPt pt, const Bitu size)
+{
+	uint32_t value = 0x12345678;
+	for (const PhysPt end = pt + size; pt < end; ++pt) {
+		value = value * 1103515245 + 12345;
+		mem_writeb(pt, static_cast<uint8_t>(value >> 16));
+	}
+}
+
+void fill(const Move &move)
+{
+	const PhysPt start = std::min(move.src, move.dest);
+	fill(start, std::max(move.src, move.dest) + move.size - start);
+}
+
+std::vector<uint8_t> read_bytes(PhysPt pt, const Bitu size)
+{
+	std::vector<uint8_t> bytes(size);
+	for (auto &b : bytes)
+		b = mem_readb(pt++);
+	return bytes;
+}
+
+TEST_F(Memory, MemcpyMatchesByteCopy)
+{
+	for (const auto &move : moves) {
+		SCOPED_TRACE(move.name);
+		fill(move);
+		byte_copy(move.dest, move.src, move.size);
+		const auto expected = read_bytes(move.dest, move.size);
+		fill(move);
+		mem_memcpy(move.dest, move.src, move.size);
+		EXPECT_EQ(read_bytes(move.dest, move.size), expected);
+	}
+}
+
+TEST_F(Memory, BlockWriteAndRead)
+{
+	// Starts and ends within a page, with whole pages in between
+	const PhysPt pt = 0x300ffd;
+	std::vector<uint8_t> data(3 * 4096 + 7);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<uint8_t>(i * 31 + 7);
+	fill(pt - 1, data.size() + 2);
+	const uint8_t before = mem_readb(pt - 1);
+	const uint8_t after = mem_readb(pt + data.size());
+
+	MEM_BlockWrite(pt, data.data(), data.size());
+	EXPECT_EQ(read_bytes(pt, data.size()), data);
+	EXPECT_EQ(mem_readb(pt - 1), before);
+	EXPECT_EQ(mem_readb(pt + data.size()), after);
+
+	std::vector<uint8_t> read(data.size());
+	MEM_BlockRead(pt, read.data(), read.size());
+	EXPECT_EQ(read, data);
+}
+
+// Throughput of each move, a byte at a time and with mem_memcpy
+TEST_F(MemoryBenchmark, XMSMove)
+{
+	constexpr Bitu bytes_per_move = 256 * 1024 * 1024;
+	for (const auto &move : moves) {
+		const int runs = static_cast<int>(std::max<Bitu>(bytes_per_move / move.size, 1));
+		const double bytewise = benchmark_seconds(runs, [&] {
+			byte_copy(move.dest, move.src, move.size);
+		});
+		const double paged = benchmark_seconds(runs, [&] {
+			mem_memcpy(move.dest, move.src, move.size);
+		});
+		const std::string what = move.name;
+		benchmark_report((what + ", bytewise").c_str(), move.size / bytewise / 1e6, "MB/s");
+		benchmark_report((what + ", mem_memcpy").c_str(), move.size / paged / 1e6, "MB/s");
+	}
+}
+
+} // namespace
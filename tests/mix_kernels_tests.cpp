@@ -0,0 +1,309 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "mix_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace {
+
+// Odd lengths exercise both the vector body and the scalar tail
+constexpr size_t frames = 1027;
+
+std::vector<int16_t> random_samples(size_t n)
+{
+	std::mt19937 rng(1234);
+	std::vector<int16_t> samples(n);
+	for (auto &s : samples)
+		s = static_cast<int16_t>(rng());
+	// Include the extremes
+	samples[0] = INT16_MIN;
+	samples[1] = INT16_MAX;
+	return samples;
+}
+
+std::vector<int32_t> random_work(size_t n)
+{
+	std::mt19937 rng(5678);
+	std::vector<int32_t> work(n);
+	for (auto &w : work)
+		w = static_cast<int32_t>(rng());
+	return work;
+}
+
+TEST(MixKernels, AddStereo)
+{
+	const auto src = random_samples(frames * 2);
+	auto work = random_work(frames * 2);
+	auto expected = work;
+	const int32_t vol_left = 8192;
+	const int32_t vol_right = -123456; // large enough to wrap
+
+	mix_add_stereo_s16(work.data(), src.data(), frames, vol_left, vol_right);
+
+	for (size_t i = 0; i < frames; ++i) {
+		expected[i * 2] = mix_wrapping_add(expected[i * 2],
+		                                   mix_scale(src[i * 2], vol_left));
+		expected[i * 2 + 1] = mix_wrapping_add(expected[i * 2 + 1],
+		                                       mix_scale(src[i * 2 + 1],
+		                                                 vol_right));
+	}
+	EXPECT_EQ(work, expected);
+}
+
+TEST(MixKernels, AddMono)
+{
+	const auto src = random_samples(frames);
+	auto work = random_work(frames * 2);
+	auto expected = work;
+	const int32_t vol_left = 70000;
+	const int32_t vol_right = 1;
+
+	mix_add_mono_s16(work.data(), src.data(), frames, vol_left, vol_right);
+
+	for (size_t i = 0; i < frames; ++i) {
+		expected[i * 2] = mix_wrapping_add(expected[i * 2],
+		                                   mix_scale(src[i], vol_left));
+		expected[i * 2 + 1] = mix_wrapping_add(expected[i * 2 + 1],
+		                                       mix_scale(src[i], vol_right));
+	}
+	EXPECT_EQ(work, expected);
+}
+
+TEST(MixKernels, ConvertClips)
+{
+	constexpr int shift = 13;
+	auto work = random_work(frames * 2);
+	work[0] = INT32_MAX;
+	work[1] = INT32_MIN;
+	work[2] = (INT16_MAX << shift) + (1 << shift);
+	work[3] = INT16_MIN * (1 << shift);
+
+	std::vector<int16_t> out(work.size());
+	mix_to_s16(work.data(), out.data(), work.size(), shift);
+
+	EXPECT_EQ(out[0], INT16_MAX);
+	EXPECT_EQ(out[1], INT16_MIN);
+	EXPECT_EQ(out[2], INT16_MAX);
+	EXPECT_EQ(out[3], INT16_MIN);
+	for (size_t i = 0; i < work.size(); ++i) {
+		const int32_t shifted = work[i] >> shift;
+		const int32_t clipped = std::max(std::min(shifted, INT16_MAX + 0),
+		                                 INT16_MIN + 0);
+		EXPECT_EQ(out[i], clipped);
+	}
+}
+
+TEST(MixKernels, DrainClears)
+{
+	auto work = random_work(frames * 2);
+	const auto original = work;
+	std::vector<int16_t> drained(work.size());
+	std::vector<int16_t> converted(work.size());
+
+	mix_to_s16(original.data(), converted.data(), original.size(), 13);
+	mix_drain_to_s16(work.data(), drained.data(), work.size(), 13);
+
+	EXPECT_EQ(drained, converted);
+	for (const auto w : work)
+		EXPECT_EQ(w, 0);
+}
+
+// The mixer pipeline: 8 channels of native 16-bit audio at the mixer rate
+// (6 stereo, 2 mono) mixed into a circular work buffer the size of the
+// mixer's, in 1 ms blocks of 48 frames, and each block drained to 16-bit
+// output the way MIXER_CallBack does. It runs either with the per-frame
+// loops mixer.cpp used before the kernels, or with the kernels the way
+// MixerChannel::AddSamplesAtMixerRate and MIXER_CallBack use them.
+constexpr size_t buf_frames = 16 * 1024; // MIXER_BUFSIZE
+constexpr size_t buf_mask = buf_frames - 1;
+constexpr int vol_shift = 13; // MIXER_VOLSHIFT
+constexpr size_t block_frames = 48;
+constexpr size_t clip_frames = 48000; // a second of audio per channel
+constexpr int num_channels = 8;
+
+struct Channel {
+	std::vector<int16_t> data = {};
+	bool stereo = false;
+	int32_t volmul[2] = {};
+	int32_t prev_sample[2] = {};
+	int32_t next_sample[2] = {};
+	size_t pos = 0; // in frames
+};
+
+using Work = std::vector<int32_t>; // interleaved left and right
+
+std::vector<Channel> make_channels()
+{
+	std::mt19937 rng(4800);
+	std::vector<Channel> channels(num_channels);
+	for (int i = 0; i < num_channels; ++i) {
+		Channel &c = channels[i];
+		c.stereo = i < 6;
+		c.data.resize(clip_frames * (c.stereo ? 2 : 1));
+		for (auto &s : c.data)
+			s = static_cast<int16_t>(rng());
+		// Volumes below unity keep the sum of all channels in range
+		c.volmul[0] = static_cast<int32_t>(rng() % (1 << (vol_shift - 1)));
+		c.volmul[1] = static_cast<int32_t>(rng() % (1 << (vol_shift - 1)));
+	}
+	return channels;
+}
+
+// One sample read per frame, each frame playing the sample read before it
+void add_scalar(Channel &c, Work &work, size_t mixpos)
+{
+	const size_t step = c.stereo ? 2 : 1;
+	for (size_t i = 0; i < block_frames; ++i) {
+		c.prev_sample[0] = c.next_sample[0];
+		c.next_sample[0] = c.data[c.pos * step];
+		if (c.stereo) {
+			c.prev_sample[1] = c.next_sample[1];
+			c.next_sample[1] = c.data[c.pos * step + 1];
+		}
+		c.pos++;
+		mixpos &= buf_mask;
+		work[mixpos * 2] += c.prev_sample[0] * c.volmul[0];
+		work[mixpos * 2 + 1] += (c.stereo ? c.prev_sample[1] : c.prev_sample[0]) *
+		                        c.volmul[1];
+		mixpos++;
+	}
+	c.pos %= clip_frames;
+}
+
+void add_kernel(Channel &c, Work &work, size_t mixpos)
+{
+	const size_t step = c.stereo ? 2 : 1;
+	const int16_t *data = &c.data[c.pos * step];
+
+	// The first frame plays the sample held over from the previous block
+	mixpos &= buf_mask;
+	work[mixpos * 2] += c.next_sample[0] * c.volmul[0];
+	work[mixpos * 2 + 1] += (c.stereo ? c.next_sample[1] : c.next_sample[0]) *
+	                        c.volmul[1];
+	// The rest trail the incoming data by one frame
+	size_t remaining = block_frames - 1;
+	const int16_t *src = data;
+	mixpos++;
+	while (remaining) {
+		mixpos &= buf_mask;
+		const size_t run = std::min(remaining, buf_frames - mixpos);
+		if (c.stereo)
+			mix_add_stereo_s16(&work[mixpos * 2], src, run, c.volmul[0], c.volmul[1]);
+		else
+			mix_add_mono_s16(&work[mixpos * 2], src, run, c.volmul[0], c.volmul[1]);
+		src += run * step;
+		mixpos += run;
+		remaining -= run;
+	}
+
+	const int16_t *last = data + (block_frames - 1) * step;
+	c.next_sample[0] = last[0];
+	if (c.stereo)
+		c.next_sample[1] = last[1];
+	c.pos = (c.pos + block_frames) % clip_frames;
+}
+
+void drain_scalar(Work &work, size_t pos, int16_t *out)
+{
+	for (size_t i = 0; i < block_frames; ++i) {
+		pos &= buf_mask;
+		*out++ = mix_clip_s16(work[pos * 2], vol_shift);
+		*out++ = mix_clip_s16(work[pos * 2 + 1], vol_shift);
+		work[pos * 2] = 0;
+		work[pos * 2 + 1] = 0;
+		pos++;
+	}
+}
+
+void drain_kernel(Work &work, size_t pos, int16_t *out)
+{
+	size_t remaining = block_frames;
+	while (remaining) {
+		pos &= buf_mask;
+		const size_t run = std::min(remaining, buf_frames - pos);
+		mix_drain_to_s16(&work[pos * 2], out, run * 2, vol_shift);
+		out += run * 2;
+		pos += run;
+		remaining -= run;
+	}
+}
+
+// Returns an FNV-1a hash of the output
+template <bool kernel>
+uint64_t mix_blocks(std::vector<Channel> channels, const int blocks)
+{
+	Work work(buf_frames * 2);
+	int16_t out[block_frames * 2];
+	uint64_t hash = 0xcbf29ce484222325;
+	size_t pos = 0;
+	for (int b = 0; b < blocks; ++b) {
+		for (auto &c : channels) {
+			if (kernel)
+				add_kernel(c, work, pos);
+			else
+				add_scalar(c, work, pos);
+		}
+		if (kernel)
+			drain_kernel(work, pos, out);
+		else
+			drain_scalar(work, pos, out);
+		for (const auto s : out)
+			hash = (hash ^ static_cast<uint16_t>(s)) * 0x100000001b3;
+		pos = (pos + block_frames) & buf_mask;
+	}
+	return hash;
+}
+
+TEST(MixKernels, BlocksMatchPerFrameLoops)
+{
+	// The work buffer isn't a whole number of blocks, so some blocks wrap
+	// around its end
+	constexpr int blocks = 2 * buf_frames / block_frames + 1;
+	const auto channels = make_channels();
+	EXPECT_EQ(mix_blocks<true>(channels, blocks), mix_blocks<false>(channels, blocks));
+}
+
+// Time per output frame, with the per-frame loops and with the kernels
+TEST(MixKernelsBenchmark, Blocks)
+{
+	constexpr int blocks = 200000;
+	const auto channels = make_channels();
+	uint64_t expected = 0;
+	uint64_t hash = 0;
+	const double scalar = benchmark_seconds(1, [&] {
+		expected = mix_blocks<false>(channels, blocks);
+	});
+	const double kernels = benchmark_seconds(1, [&] {
+		hash = mix_blocks<true>(channels, blocks);
+	});
+	EXPECT_EQ(hash, expected);
+	constexpr double frames_mixed = static_cast<double>(blocks) * block_frames;
+	benchmark_report("per-frame loops", scalar * 1e9 / frames_mixed, "ns/frame");
+	benchmark_report("mixer kernels", kernels * 1e9 / frames_mixed, "ns/frame");
+}
+
+} // namespace
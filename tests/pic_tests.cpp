@@ -0,0 +1,260 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dosbox.h"
+
+#include "pic.h"
+#include "timer.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace {
+
+// Runs the event queue the way the emulation loop does, one TIMER_AddTick
+// and a run of PIC_RunQueue calls per emulated millisecond
+void run_ticks(const int ticks)
+{
+	for (int tick = 0; tick < ticks; ++tick) {
+		TIMER_AddTick();
+		// The core would run the cycles up to the next event here
+		while (PIC_RunQueue())
+			CPU_Cycles = 0;
+	}
+}
+
+std::vector<Bitu> fired = {};
+
+void record_a(Bitu val)
+{
+	fired.push_back(val);
+}
+
+void record_b(Bitu val)
+{
+	fired.push_back(0x100 | val);
+}
+
+TEST(PIC, EventsFireInTimeOrder)
+{
+	fired.clear();
+	PIC_AddEvent(record_a, 0.7f, 1);
+	PIC_AddEvent(record_a, 0.2f, 2);
+	PIC_AddEvent(record_b, 1.5f, 3);
+	PIC_AddEvent(record_a, 0.2f, 4); // ties fire in the order they were added
+	PIC_AddEvent(record_b, 2.9f, 5);
+	run_ticks(4);
+	EXPECT_EQ(fired, (std::vector<Bitu>{2, 4, 1, 0x103, 0x105}));
+}
+
+TEST(PIC, RemoveEvents)
+{
+	fired.clear();
+	for (Bitu i = 0; i < 3; ++i) {
+		PIC_AddEvent(record_a, 0.5f, i);
+		PIC_AddEvent(record_b, 0.5f, i);
+	}
+	PIC_RemoveEvents(record_a);
+	run_ticks(2);
+	EXPECT_EQ(fired, (std::vector<Bitu>{0x100, 0x101, 0x102}));
+}
+
+TEST(PIC, RemoveSpecificEvents)
+{
+	fired.clear();
+	PIC_AddEvent(record_a, 0.1f, 1);
+	PIC_AddEvent(record_a, 0.2f, 2);
+	PIC_AddEvent(record_b, 0.3f, 1);
+	PIC_AddEvent(record_a, 0.4f, 1);
+	PIC_AddEvent(record_a, 0.5f, 3);
+	PIC_RemoveSpecificEvents(record_a, 1);
+	run_ticks(2);
+	EXPECT_EQ(fired, (std::vector<Bitu>{2, 0x101, 3}));
+}
+
+// A set of simulated devices keeps a fixed number of events pending:
+//
+// - every event that fires schedules a new one for its device, 1 us to 2 ms
+//   ahead
+// - every 16th event also reschedules a pending event of another device
+//   through PIC_RemoveSpecificEvents
+// - every tick one device drops all its events with PIC_RemoveEvents and
+//   schedules them again
+//
+// The devices track their pending events, so an event that fires after
+// being removed, or out of order, marks the run as failed.
+constexpr int num_devices = 8;
+
+// Event values hold the event's slot and the generation of the slot, so an
+// event that fires after removal can't pass for one that reused its slot
+constexpr int slot_bits = 20;
+constexpr uint32_t slot_mask = (1 << slot_bits) - 1;
+constexpr uint32_t generation_mask = 0xfff;
+
+struct Event {
+	double due = 0.0; // in ticks since the start of the run
+	uint32_t pos = 0; // in the device's list of pending events
+	uint16_t generation = 0;
+	uint8_t device = 0;
+	bool pending = false;
+};
+
+struct Devices {
+	std::vector<Event> events = {};
+	std::vector<uint32_t> free_slots = {};
+	std::vector<uint32_t> pending[num_devices] = {};
+	std::mt19937 rng{42};
+	double last_due = 0.0;
+	bool in_service = false;
+	double service_due = 0.0;
+	uint64_t fired = 0;
+	bool failed = false;
+};
+
+Devices devices;
+
+extern const PIC_EventHandler device_events[num_devices];
+
+void add_event(const int device)
+{
+	const float delay = std::uniform_real_distribution<float>(0.001f, 2.0f)(devices.rng);
+	uint32_t id;
+	if (devices.free_slots.empty()) {
+		id = static_cast<uint32_t>(devices.events.size());
+		devices.events.emplace_back();
+	} else {
+		id = devices.free_slots.back();
+		devices.free_slots.pop_back();
+	}
+	Event &event = devices.events[id];
+	// Events added from a handler are timed from the event being serviced
+	event.due = (devices.in_service ? devices.service_due : PIC_FullIndex()) + delay;
+	event.pos = static_cast<uint32_t>(devices.pending[device].size());
+	event.generation = (event.generation + 1) & generation_mask;
+	event.device = static_cast<uint8_t>(device);
+	event.pending = true;
+	devices.pending[device].push_back(id);
+	PIC_AddEvent(device_events[device], delay,
+	             id | (static_cast<Bitu>(event.generation) << slot_bits));
+}
+
+void drop_event(const uint32_t id)
+{
+	Event &event = devices.events[id];
+	auto &list = devices.pending[event.device];
+	devices.events[list.back()].pos = event.pos;
+	list[event.pos] = list.back();
+	list.pop_back();
+	event.pending = false;
+	devices.free_slots.push_back(id);
+}
+
+void fire(const int device, const Bitu val)
+{
+	const uint32_t id = val & slot_mask;
+	const Event event = devices.events[id];
+	if (!event.pending || event.generation != val >> slot_bits ||
+	    event.device != device || event.due < devices.last_due - 1e-4) {
+		devices.failed = true;
+		return;
+	}
+	drop_event(id);
+	devices.last_due = event.due;
+	devices.in_service = true;
+	devices.service_due = event.due;
+
+	add_event(device);
+	if (++devices.fired % 16 == 0) {
+		const int other = static_cast<int>(devices.rng() % num_devices);
+		const auto &list = devices.pending[other];
+		if (!list.empty()) {
+			const uint32_t victim = list[devices.rng() % list.size()];
+			const Bitu generation = devices.events[victim].generation;
+			PIC_RemoveSpecificEvents(device_events[other],
+			                         victim | (generation << slot_bits));
+			drop_event(victim);
+			add_event(other);
+		}
+	}
+	devices.in_service = false;
+}
+
+template <int device>
+void device_event(Bitu val)
+{
+	fire(device, val);
+}
+
+const PIC_EventHandler device_events[num_devices] = {
+        device_event<0>, device_event<1>, device_event<2>, device_event<3>,
+        device_event<4>, device_event<5>, device_event<6>, device_event<7>,
+};
+
+void run_devices(const int live_events, const int ticks)
+{
+	devices = Devices();
+	for (int i = 0; i < live_events; ++i)
+		add_event(i % num_devices);
+
+	for (int tick = 0; tick < ticks && !devices.failed; ++tick) {
+		const int device = tick % num_devices;
+		const size_t count = devices.pending[device].size();
+		PIC_RemoveEvents(device_events[device]);
+		while (!devices.pending[device].empty())
+			drop_event(devices.pending[device].back());
+		for (size_t i = 0; i < count; ++i)
+			add_event(device);
+		run_ticks(1);
+	}
+
+	for (const auto handler : device_events)
+		PIC_RemoveEvents(handler);
+}
+
+TEST(PIC, ManyDevices)
+{
+	for (const int live_events : {16, 1024}) {
+		run_devices(live_events, 50);
+		EXPECT_FALSE(devices.failed) << live_events << " pending events";
+		EXPECT_GT(devices.fired, 0u);
+	}
+}
+
+// Time per fired event for several queue sizes, including the devices' own
+// bookkeeping
+TEST(PICBenchmark, ManyDevices)
+{
+	const Bit32s cycle_max = CPU_CycleMax;
+	CPU_CycleMax = 100000;
+	for (const int live_events : {16, 128, 1024, 4096}) {
+		const double seconds = benchmark_seconds(1, [=] { run_devices(live_events, 2000); });
+		EXPECT_FALSE(devices.failed) << live_events << " pending events";
+		const std::string what = std::to_string(live_events) + " pending events";
+		benchmark_report(what.c_str(), seconds * 1e9 / devices.fired, "ns/event");
+	}
+	CPU_CycleMax = cycle_max;
+}
+
+} // namespace
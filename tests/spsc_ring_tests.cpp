@@ -0,0 +1,154 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "spsc_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto iterations = 10000;
+
+TEST(SPSCRing, TrivialSerial)
+{
+	SPSCRing<int> ring(65);
+	for (int iteration = 0; iteration != 128; ++iteration) {
+		EXPECT_EQ(ring.MaxCapacity(), 65);
+		EXPECT_EQ(ring.Size(), 0);
+		EXPECT_TRUE(ring.IsEmpty());
+
+		for (int i = 0; i != 65; ++i) {
+			auto slot = ring.AcquireWrite(false);
+			ASSERT_NE(slot, nullptr);
+			*slot = i;
+			ring.CommitWrite();
+		}
+		EXPECT_EQ(ring.Size(), 65);
+		EXPECT_FALSE(ring.IsEmpty());
+
+		// A full ring rejects non-blocking writes
+		EXPECT_EQ(ring.AcquireWrite(false), nullptr);
+
+		for (int i = 0; i != 65; ++i) {
+			auto slot = ring.AcquireRead(false);
+			ASSERT_NE(slot, nullptr);
+			EXPECT_EQ(*slot, i);
+			ring.ReleaseRead();
+		}
+		EXPECT_TRUE(ring.IsEmpty());
+
+		// An empty ring rejects non-blocking reads
+		EXPECT_EQ(ring.AcquireRead(false), nullptr);
+	}
+}
+
+TEST(SPSCRing, TrivialZeroCapacity)
+{
+	EXPECT_DEBUG_DEATH({ SPSCRing<int> ring(0); }, "");
+}
+
+TEST(SPSCRing, SlotsArePreallocated)
+{
+	const std::vector<int16_t> prototype(1024);
+	SPSCRing<std::vector<int16_t>> ring(4, prototype);
+
+	// Slots keep their storage as they are cycled through the ring
+	const int16_t *first_data = nullptr;
+	for (int i = 0; i != 8; ++i) {
+		auto slot = ring.AcquireWrite();
+		ASSERT_NE(slot, nullptr);
+		EXPECT_EQ(slot->size(), prototype.size());
+		if (i == 0) {
+			first_data = slot->data();
+		} else if (i == 4) {
+			EXPECT_EQ(slot->data(), first_data);
+		}
+		(*slot)[0] = static_cast<int16_t>(i);
+		ring.CommitWrite();
+
+		slot = ring.AcquireRead();
+		ASSERT_NE(slot, nullptr);
+		EXPECT_EQ((*slot)[0], i);
+		ring.ReleaseRead();
+	}
+}
+
+TEST(SPSCRing, StopWakesWaiters)
+{
+	SPSCRing<int> ring(2);
+
+	// The reader blocks on the empty ring until it's stopped
+	std::thread reader([&ring]() { EXPECT_EQ(ring.AcquireRead(), nullptr); });
+	ring.Stop();
+	reader.join();
+	EXPECT_TRUE(ring.IsStopped());
+	EXPECT_EQ(ring.AcquireWrite(), nullptr);
+
+	// A reset ring accepts items again
+	ring.Reset();
+	EXPECT_FALSE(ring.IsStopped());
+	EXPECT_NE(ring.AcquireWrite(), nullptr);
+	ring.CommitWrite();
+	EXPECT_EQ(ring.Size(), 1);
+}
+
+void ring_consume(SPSCRing<std::vector<int16_t>> *ring, const size_t *max_depth)
+{
+	for (int i = 0; i != iterations; ++i) {
+		EXPECT_TRUE(ring->Size() <= *max_depth);
+		auto slot = ring->AcquireRead();
+		ASSERT_NE(slot, nullptr);
+		EXPECT_EQ((*slot)[0], static_cast<int16_t>(i));
+		EXPECT_EQ(slot->back(), static_cast<int16_t>(-i));
+		ring->ReleaseRead();
+	}
+}
+
+void ring_produce(SPSCRing<std::vector<int16_t>> *ring, const size_t *max_depth)
+{
+	for (int i = 0; i != iterations; ++i) {
+		auto slot = ring->AcquireWrite();
+		ASSERT_NE(slot, nullptr);
+		(*slot)[0] = static_cast<int16_t>(i);
+		slot->back() = static_cast<int16_t>(-i);
+		ring->CommitWrite();
+		EXPECT_TRUE(ring->Size() <= *max_depth);
+	}
+}
+
+TEST(SPSCRing, ContainerAsync)
+{
+	const size_t max_depth = 8;
+	SPSCRing<std::vector<int16_t>> ring(max_depth, std::vector<int16_t>(64));
+
+	std::thread writer(ring_produce, &ring, &max_depth);
+	std::thread reader(ring_consume, &ring, &max_depth);
+
+	writer.join();
+	reader.join();
+
+	// Make sure we've consumed all produced items and the ring is empty
+	EXPECT_EQ(ring.Size(), 0);
+}
+
+} // namespace
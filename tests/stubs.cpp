@@ -20,8 +20,12 @@
 
 #include "dosbox.h"
 
+#include "callback.h"
 #include "control.h"
+#include "cpu.h"
 #include "logging.h"
+#include "regs.h"
+#include "../src/cpu/lazyflags.h"
 
 // This global variable should be setup/torn down per test.
 Config *control = nullptr;
@@ -38,3 +42,54 @@ const char *MSG_Get(char const *)
 	return nullptr;
 }
 
+// CPU state and entry points referenced by the hardware sources some tests
+// link (iohandler.cpp, pic.cpp, memory.cpp, paging.cpp), so they can run
+// without the CPU cores. The guest never executes code: the CPU stays in
+// real mode and the fault paths that would call into a core are never taken.
+MachineType machine = MCH_VGA;
+SVGACards svgaCard = SVGA_None;
+
+CPU_Regs cpu_regs = {};
+Segments Segs = {};
+CPUBlock cpu = {};
+LazyFlags lflags = {};
+CPU_Decoder *cpudecoder = nullptr;
+
+Bit32s CPU_Cycles = 0;
+Bit32s CPU_CycleLeft = 0;
+Bit32s CPU_CycleMax = 3000;
+Bit64s CPU_IODelayRemoved = 0;
+Bitu CPU_ArchitectureType = CPU_ARCHTYPE_MIXED;
+
+Bitu call_priv_io = 0;
+
+Bits CPU_Core_Normal_Run()
+{
+	return 0;
+}
+
+Bits CPU_Core_Normal_Trap_Run()
+{
+	return 0;
+}
+
+Bits CPU_Core_Simple_Run()
+{
+	return 0;
+}
+
+Bits CPU_Core_Full_Run()
+{
+	return 0;
+}
+
+void DOSBOX_RunMachine() {}
+
+void CPU_Interrupt(Bitu, Bitu, Bitu) {}
+void CPU_Exception(Bitu, Bitu) {}
+void CPU_Push16(Bitu) {}
+
+bool CPU_IO_Exception(Bitu, Bitu)
+{
+	return false;
+}
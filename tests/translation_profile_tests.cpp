@@ -0,0 +1,191 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "translation_profile.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <vector>
+
+namespace {
+
+const std::string profile_file = "translation_profile_test.bin";
+const std::string signature = "dynrec-2-64-test";
+
+std::vector<uint8_t> make_page(uint8_t seed)
+{
+	std::vector<uint8_t> page(4096);
+	for (size_t i = 0; i < page.size(); ++i)
+		page[i] = static_cast<uint8_t>(i * 7 + seed);
+	return page;
+}
+
+TEST(TranslationProfile, PageKey)
+{
+	auto page = make_page(1);
+	const auto key16 = TranslationProfile::PageKey(page.data(), false);
+	const auto key32 = TranslationProfile::PageKey(page.data(), true);
+
+	// The same code decodes differently in 16 and 32-bit mode
+	EXPECT_NE(key16, key32);
+	EXPECT_EQ(key16, TranslationProfile::PageKey(page.data(), false));
+
+	// Any changed byte changes the key
+	page[4095] ^= 1;
+	EXPECT_NE(key16, TranslationProfile::PageKey(page.data(), false));
+}
+
+TEST(TranslationProfile, Record)
+{
+	TranslationProfile profile;
+	EXPECT_EQ(profile.Find(42), nullptr);
+	EXPECT_FALSE(profile.IsDirty());
+
+	profile.AddEntry(42, 0x100);
+	profile.AddEntry(42, 0x010);
+	profile.AddModified(42, 0x200);
+	EXPECT_TRUE(profile.IsDirty());
+
+	const auto page = profile.Find(42);
+	ASSERT_NE(page, nullptr);
+	EXPECT_EQ(page->entries, (std::set<uint16_t>{0x010, 0x100}));
+	EXPECT_EQ(page->modified, (std::set<uint16_t>{0x200}));
+	EXPECT_EQ(profile.NumPages(), 1u);
+}
+
+TEST(TranslationProfile, SaveAndLoad)
+{
+	const auto key = TranslationProfile::PageKey(make_page(2).data(), true);
+	TranslationProfile saved;
+	saved.AddEntry(key, 0);
+	saved.AddEntry(key, 4095);
+	saved.AddModified(key, 17);
+	saved.AddEntry(7, 123);
+	ASSERT_TRUE(saved.Save(profile_file, signature));
+	EXPECT_FALSE(saved.IsDirty());
+
+	TranslationProfile loaded;
+	ASSERT_TRUE(loaded.Load(profile_file, signature));
+	EXPECT_EQ(loaded.NumPages(), 2u);
+	EXPECT_FALSE(loaded.IsDirty());
+	const auto page = loaded.Find(key);
+	ASSERT_NE(page, nullptr);
+	EXPECT_EQ(page->entries, (std::set<uint16_t>{0, 4095}));
+	EXPECT_EQ(page->modified, (std::set<uint16_t>{17}));
+
+	std::remove(profile_file.c_str());
+}
+
+TEST(TranslationProfile, DropUnusedPages)
+{
+	TranslationProfile saved;
+	saved.AddEntry(1, 0x10);
+	saved.AddEntry(2, 0x20);
+	saved.AddEntry(3, 0x30);
+	ASSERT_TRUE(saved.Save(profile_file, signature));
+
+	// Only the pages found or recorded in this session are saved again
+	TranslationProfile session;
+	ASSERT_TRUE(session.Load(profile_file, signature));
+	EXPECT_NE(session.Find(1), nullptr);
+	session.AddEntry(4, 0x40);
+	ASSERT_TRUE(session.Save(profile_file, signature));
+
+	TranslationProfile loaded;
+	ASSERT_TRUE(loaded.Load(profile_file, signature));
+	EXPECT_EQ(loaded.NumPages(), 2u);
+	EXPECT_NE(loaded.Find(1), nullptr);
+	EXPECT_EQ(loaded.Find(2), nullptr);
+	EXPECT_EQ(loaded.Find(3), nullptr);
+	EXPECT_NE(loaded.Find(4), nullptr);
+
+	std::remove(profile_file.c_str());
+}
+
+TEST(TranslationProfile, LimitPages)
+{
+	const uint64_t limit = TranslationProfile::max_pages;
+	TranslationProfile saved;
+	for (uint64_t key = 0; key < limit; ++key)
+		saved.AddEntry(key, 1);
+	// Every page was used this session, so there is no room for more
+	saved.AddEntry(limit, 1);
+	saved.AddModified(limit, 1);
+	EXPECT_EQ(saved.NumPages(), limit);
+	EXPECT_EQ(saved.Find(limit), nullptr);
+	ASSERT_TRUE(saved.Save(profile_file, signature));
+
+	// Loaded pages that weren't used make way for new ones
+	TranslationProfile session;
+	ASSERT_TRUE(session.Load(profile_file, signature));
+	EXPECT_NE(session.Find(0), nullptr);
+	session.AddEntry(limit, 1);
+	EXPECT_EQ(session.NumPages(), 2u);
+	EXPECT_NE(session.Find(0), nullptr);
+	EXPECT_NE(session.Find(limit), nullptr);
+
+	std::remove(profile_file.c_str());
+}
+
+TEST(TranslationProfile, RejectOtherHost)
+{
+	TranslationProfile saved;
+	saved.AddEntry(1, 2);
+	ASSERT_TRUE(saved.Save(profile_file, signature));
+
+	TranslationProfile loaded;
+	EXPECT_FALSE(loaded.Load(profile_file, "dynrec-7-64-test"));
+	EXPECT_EQ(loaded.NumPages(), 0u);
+
+	std::remove(profile_file.c_str());
+}
+
+TEST(TranslationProfile, RejectMalformed)
+{
+	TranslationProfile loaded;
+	EXPECT_FALSE(loaded.Load("no_such_translation_profile.bin", signature));
+
+	// Truncate a valid file in the middle of the page table
+	TranslationProfile saved;
+	for (uint16_t i = 0; i < 100; ++i)
+		saved.AddEntry(i, i);
+	ASSERT_TRUE(saved.Save(profile_file, signature));
+	std::vector<char> data;
+	{
+		std::ifstream in(profile_file, std::ios_base::binary);
+		data.assign(std::istreambuf_iterator<char>(in),
+		            std::istreambuf_iterator<char>());
+	}
+	ASSERT_GT(data.size(), 64u);
+	{
+		std::ofstream out(profile_file, std::ios_base::binary | std::ios_base::trunc);
+		out.write(data.data(), static_cast<std::streamsize>(data.size() / 2));
+	}
+	EXPECT_FALSE(loaded.Load(profile_file, signature));
+	EXPECT_EQ(loaded.NumPages(), 0u);
+
+	std::remove(profile_file.c_str());
+}
+
+} // namespace
@@ -0,0 +1,157 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "triple_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto iterations = 10000;
+
+TEST(TripleBuffer, TrivialSerial)
+{
+	TripleBuffer<int> frames;
+
+	// Nothing was published yet
+	EXPECT_FALSE(frames.HasNew());
+	EXPECT_EQ(frames.AcquireRead(false), nullptr);
+
+	for (int i = 0; i != 16; ++i) {
+		frames.WriteSlot() = i;
+		EXPECT_TRUE(frames.Publish());
+		EXPECT_TRUE(frames.HasNew());
+
+		auto frame = frames.AcquireRead(false);
+		ASSERT_NE(frame, nullptr);
+		EXPECT_EQ(*frame, i);
+
+		// Each item is only handed out once
+		EXPECT_FALSE(frames.HasNew());
+		EXPECT_EQ(frames.AcquireRead(false), nullptr);
+	}
+}
+
+TEST(TripleBuffer, NewestWins)
+{
+	TripleBuffer<int> frames;
+	frames.WriteSlot() = 1;
+	EXPECT_TRUE(frames.Publish());
+
+	// Publishing again before the consumer acquired drops the older item
+	frames.WriteSlot() = 2;
+	EXPECT_FALSE(frames.Publish());
+	frames.WriteSlot() = 3;
+	EXPECT_FALSE(frames.Publish());
+
+	auto frame = frames.AcquireRead(false);
+	ASSERT_NE(frame, nullptr);
+	EXPECT_EQ(*frame, 3);
+	EXPECT_EQ(frames.AcquireRead(false), nullptr);
+}
+
+TEST(TripleBuffer, SidesNeverShareSlots)
+{
+	const std::vector<uint8_t> prototype(64);
+	TripleBuffer<std::vector<uint8_t>> frames(prototype);
+
+	std::set<const uint8_t *> seen;
+	const uint8_t *reading = nullptr;
+	for (int i = 0; i != 8; ++i) {
+		auto &slot = frames.WriteSlot();
+		EXPECT_EQ(slot.size(), prototype.size());
+		EXPECT_NE(slot.data(), reading);
+		seen.insert(slot.data());
+		frames.Publish();
+		if (i % 3 == 0) {
+			auto frame = frames.AcquireRead(false);
+			ASSERT_NE(frame, nullptr);
+			reading = frame->data();
+		}
+	}
+	// The three preallocated slots are reused, never reallocated
+	EXPECT_EQ(seen.size(), 3);
+}
+
+TEST(TripleBuffer, StopWakesWaiter)
+{
+	TripleBuffer<int> frames;
+
+	// The reader blocks until it's stopped
+	std::thread reader([&frames]() { EXPECT_EQ(frames.AcquireRead(), nullptr); });
+	frames.Stop();
+	reader.join();
+	EXPECT_TRUE(frames.IsStopped());
+
+	// A reset buffer hands out items again
+	frames.Reset();
+	EXPECT_FALSE(frames.IsStopped());
+	frames.WriteSlot() = 7;
+	EXPECT_TRUE(frames.Publish());
+	auto frame = frames.AcquireRead();
+	ASSERT_NE(frame, nullptr);
+	EXPECT_EQ(*frame, 7);
+}
+
+TEST(TripleBuffer, ContainerAsync)
+{
+	const std::vector<uint8_t> prototype(4096);
+	TripleBuffer<std::vector<uint8_t>> frames(prototype);
+
+	int num_published = 0;
+	int num_dropped = 0;
+	std::thread producer([&]() {
+		for (int i = 1; i <= iterations; ++i) {
+			auto &slot = frames.WriteSlot();
+			std::fill(slot.begin(), slot.end(), static_cast<uint8_t>(i));
+			slot[0] = static_cast<uint8_t>(i >> 8);
+			if (!frames.Publish())
+				++num_dropped;
+			++num_published;
+		}
+		// Wait for the consumer to catch up before stopping
+		while (frames.HasNew())
+			std::this_thread::yield();
+		frames.Stop();
+	});
+
+	// Items arrive whole and in order, though some may be skipped
+	int num_acquired = 0;
+	int last = 0;
+	while (auto frame = frames.AcquireRead()) {
+		const auto low = (*frame)[1];
+		EXPECT_EQ(frame->back(), low);
+		const int value = ((*frame)[0] << 8) | low;
+		EXPECT_GT(value, last);
+		last = value;
+		++num_acquired;
+	}
+	producer.join();
+
+	EXPECT_EQ(num_published, iterations);
+	EXPECT_EQ(num_acquired + num_dropped, iterations);
+	EXPECT_EQ(last, iterations);
+}
+
+} // namespace
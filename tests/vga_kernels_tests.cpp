@@ -0,0 +1,317 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace {
+
+// Odd lengths exercise both the vector body and the scalar tail
+constexpr size_t bytes = 333;
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> data(n);
+	for (auto &d : data)
+		d = static_cast<uint8_t>(rng());
+	return data;
+}
+
+TEST(VgaKernels, Expand4bpp)
+{
+	const auto src = random_bytes(bytes, 1);
+	const auto palette = random_bytes(16, 2);
+	std::vector<uint8_t> out(bytes * 2 + 1, 0xaa);
+	auto expected = out;
+
+	vga_expand_4bpp(out.data(), src.data(), bytes, palette.data());
+
+	for (size_t i = 0; i < bytes; ++i) {
+		expected[i * 2] = palette[src[i] >> 4];
+		expected[i * 2 + 1] = palette[src[i] & 0x0f];
+	}
+	EXPECT_EQ(out, expected);
+}
+
+TEST(VgaKernels, Expand4bppDouble)
+{
+	const auto src = random_bytes(bytes, 3);
+	const auto palette = random_bytes(16, 4);
+	std::vector<uint8_t> out(bytes * 4 + 1, 0xaa);
+	auto expected = out;
+
+	vga_expand_4bpp_double(out.data(), src.data(), bytes, palette.data());
+
+	for (size_t i = 0; i < bytes; ++i) {
+		expected[i * 4] = expected[i * 4 + 1] = palette[src[i] >> 4];
+		expected[i * 4 + 2] = expected[i * 4 + 3] = palette[src[i] & 0x0f];
+	}
+	EXPECT_EQ(out, expected);
+}
+
+TEST(VgaKernels, Glyph16bpp)
+{
+	const uint16_t fg = 0x8421;
+	const uint16_t bg = 0x1e3c;
+	for (unsigned row = 0; row < 256; ++row) {
+		uint16_t out[9] = {};
+		vga_glyph_16bpp(out, row, fg, bg);
+		for (unsigned n = 0; n < 8; ++n)
+			EXPECT_EQ(out[n], (row & (0x80 >> n)) ? fg : bg);
+		EXPECT_EQ(out[8], 0);
+	}
+}
+
+template <typename Pixel>
+void check_cursor(const Pixel fg, const Pixel bg)
+{
+	const auto screen = random_bytes(8 * sizeof(Pixel), 5);
+	for (unsigned a = 0; a < 256; ++a) {
+		for (unsigned b = 0; b < 256; ++b) {
+			Pixel out[8], expected[8];
+			memcpy(out, screen.data(), sizeof(out));
+			memcpy(expected, screen.data(), sizeof(expected));
+
+			vga_cursor_8<Pixel>(out, a, b, fg, bg);
+
+			for (unsigned n = 0; n < 8; ++n) {
+				const unsigned bit = 0x80 >> n;
+				if (!(a & bit))
+					expected[n] = (b & bit) ? fg : bg;
+				else if (b & bit)
+					expected[n] = static_cast<Pixel>(~expected[n]);
+			}
+			ASSERT_EQ(memcmp(out, expected, sizeof(out)), 0)
+			        << "a " << a << ", b " << b;
+		}
+	}
+}
+
+TEST(VgaKernels, Cursor8bpp)
+{
+	check_cursor<uint8_t>(0x0f, 0x70);
+}
+
+TEST(VgaKernels, Cursor16bpp)
+{
+	check_cursor<uint16_t>(0xf800, 0x07e0);
+}
+
+TEST(VgaKernels, Cursor32bpp)
+{
+	check_cursor<uint32_t>(0x00ff8040, 0x80102030);
+}
+
+// The scanline converters in vga_draw.cpp, rendering a fixed, pseudo-random
+// video memory snapshot either with the per-pixel loops they used before
+// the kernels or with the kernels:
+//
+// - 4bpp: 320x200 and 160x200 (doubled) Tandy/PCjr 16-colour modes
+// - text: 80x25 with a 16 line font, 8 and 9 dot characters at 16 bpp
+// - cursor: a 64x64 S3 hardware cursor pattern at 16 and 32 bpp
+constexpr size_t vram_size = 256 * 1024;
+
+struct Snapshot {
+	std::vector<uint8_t> vram = {};
+	uint8_t palette[16] = {};
+	uint16_t xlat16[256] = {};
+};
+
+Snapshot make_snapshot()
+{
+	Snapshot snapshot;
+	std::mt19937 rng(0x3da);
+	snapshot.vram.resize(vram_size);
+	for (auto &v : snapshot.vram)
+		v = static_cast<uint8_t>(rng());
+	for (auto &p : snapshot.palette)
+		p = static_cast<uint8_t>(rng());
+	for (auto &x : snapshot.xlat16)
+		x = static_cast<uint16_t>(rng());
+	return snapshot;
+}
+
+using Frame = std::vector<uint8_t>;
+
+// 4bpp, two pixels per byte
+void draw_4bpp_scalar(const Snapshot &s, Frame &frame, const size_t width, const bool twice)
+{
+	const size_t src_bytes = twice ? width / 4 : width / 2;
+	uint8_t *draw = frame.data();
+	for (size_t line = 0; line < 200; ++line) {
+		const uint8_t *src = &s.vram[line * src_bytes];
+		for (size_t i = 0; i < src_bytes; ++i) {
+			const uint8_t hi = s.palette[src[i] >> 4];
+			const uint8_t lo = s.palette[src[i] & 0x0f];
+			*draw++ = hi;
+			if (twice)
+				*draw++ = hi;
+			*draw++ = lo;
+			if (twice)
+				*draw++ = lo;
+		}
+	}
+}
+
+void draw_4bpp_kernel(const Snapshot &s, Frame &frame, const size_t width, const bool twice)
+{
+	const size_t src_bytes = twice ? width / 4 : width / 2;
+	for (size_t line = 0; line < 200; ++line) {
+		uint8_t *draw = &frame[line * width];
+		const uint8_t *src = &s.vram[line * src_bytes];
+		if (twice)
+			vga_expand_4bpp_double(draw, src, src_bytes, s.palette);
+		else
+			vga_expand_4bpp(draw, src, src_bytes, s.palette);
+	}
+}
+
+// 80x25 text, 16 scanlines per row, fonts at the start of video memory
+template <bool kernel>
+void draw_text(const Snapshot &s, Frame &frame, const bool char9dot)
+{
+	const uint8_t *text = &s.vram[64 * 1024];
+	uint16_t *draw = reinterpret_cast<uint16_t *>(frame.data());
+	for (size_t line = 0; line < 400; ++line) {
+		const uint8_t *vidmem = &text[(line / 16) * 160];
+		for (size_t cx = 0; cx < 80; ++cx) {
+			const unsigned chr = vidmem[cx * 2];
+			const unsigned attr = vidmem[cx * 2 + 1];
+			unsigned font = s.vram[((attr >> 3) & 1) * 8192 + chr * 32 + line % 16];
+			const uint16_t fg = s.xlat16[attr & 0xf];
+			const uint16_t bg = s.xlat16[attr >> 4];
+			if (char9dot) {
+				font <<= 1;
+				if ((font & 0x2) && chr >= 0xc0 && chr <= 0xdf)
+					font |= 1;
+			}
+			if (kernel) {
+				vga_glyph_16bpp(draw, char9dot ? font >> 1 : font, fg, bg);
+				draw += 8;
+				if (char9dot)
+					*draw++ = (font & 1) ? fg : bg;
+			} else {
+				const unsigned top = char9dot ? 0x100 : 0x80;
+				for (unsigned n = 0; n < (char9dot ? 9u : 8u); ++n, font <<= 1)
+					*draw++ = s.xlat16[(font & top) ? attr & 0xf : attr >> 4];
+			}
+		}
+	}
+}
+
+// 64x64 cursor over a 640 pixel wide line, bits A and B in alternating words
+template <typename Pixel, bool kernel>
+void draw_cursor(const Snapshot &s, Frame &frame)
+{
+	const Pixel fg = static_cast<Pixel>(0x12345678);
+	const Pixel bg = static_cast<Pixel>(0x9abcdef0);
+	const uint8_t *pattern = &s.vram[128 * 1024];
+	const size_t line_bytes = 640 * sizeof(Pixel);
+	for (size_t line = 0; line < 64; ++line) {
+		memcpy(&frame[line * line_bytes], &s.vram[line * line_bytes], line_bytes);
+		Pixel *xat = reinterpret_cast<Pixel *>(&frame[line * line_bytes]) + 100;
+		const size_t start = line * 16;
+		for (size_t m = start; m < start + 16; (m & 1) ? (m += 3) : m++) {
+			const unsigned bits_a = pattern[m];
+			const unsigned bits_b = pattern[m + 2];
+			if (kernel) {
+				vga_cursor_8(xat, bits_a, bits_b, fg, bg);
+				xat += 8;
+				continue;
+			}
+			for (unsigned bit = 0x80; bit; bit >>= 1, xat++) {
+				if (bits_a & bit) {
+					if (bits_b & bit)
+						*xat ^= static_cast<Pixel>(~0U);
+				} else {
+					*xat = (bits_b & bit) ? fg : bg;
+				}
+			}
+		}
+	}
+}
+
+struct Mode {
+	const char *name;
+	size_t frame_bytes;
+	void (*scalar)(const Snapshot &, Frame &);
+	void (*kernel)(const Snapshot &, Frame &);
+};
+
+const Mode modes[] = {
+        {"4bpp 320x200", 320 * 200,
+         [](const Snapshot &s, Frame &f) { draw_4bpp_scalar(s, f, 320, false); },
+         [](const Snapshot &s, Frame &f) { draw_4bpp_kernel(s, f, 320, false); }},
+        {"4bpp 160x200 doubled", 320 * 200,
+         [](const Snapshot &s, Frame &f) { draw_4bpp_scalar(s, f, 320, true); },
+         [](const Snapshot &s, Frame &f) { draw_4bpp_kernel(s, f, 320, true); }},
+        {"text 80x25 8 dot", 640 * 400 * 2,
+         [](const Snapshot &s, Frame &f) { draw_text<false>(s, f, false); },
+         [](const Snapshot &s, Frame &f) { draw_text<true>(s, f, false); }},
+        {"text 80x25 9 dot", 720 * 400 * 2,
+         [](const Snapshot &s, Frame &f) { draw_text<false>(s, f, true); },
+         [](const Snapshot &s, Frame &f) { draw_text<true>(s, f, true); }},
+        {"cursor 16 bpp", 640 * 64 * 2, draw_cursor<uint16_t, false>,
+         draw_cursor<uint16_t, true>},
+        {"cursor 32 bpp", 640 * 64 * 4, draw_cursor<uint32_t, false>,
+         draw_cursor<uint32_t, true>},
+};
+
+TEST(VgaKernels, FramesMatchPerPixelLoops)
+{
+	const Snapshot snapshot = make_snapshot();
+	for (const auto &mode : modes) {
+		Frame expected(mode.frame_bytes), frame(mode.frame_bytes);
+		mode.scalar(snapshot, expected);
+		mode.kernel(snapshot, frame);
+		EXPECT_TRUE(frame == expected) << mode.name;
+	}
+}
+
+// Time per frame, with the per-pixel loops and with the kernels
+TEST(VgaKernelsBenchmark, Frames)
+{
+	constexpr int frames = 2000;
+	const Snapshot snapshot = make_snapshot();
+	for (const auto &mode : modes) {
+		Frame expected(mode.frame_bytes), frame(mode.frame_bytes);
+		const double scalar = benchmark_seconds(frames, [&] {
+			mode.scalar(snapshot, expected);
+		});
+		const double kernels = benchmark_seconds(frames, [&] {
+			mode.kernel(snapshot, frame);
+		});
+		EXPECT_TRUE(frame == expected) << mode.name;
+		const std::string what = mode.name;
+		benchmark_report((what + ", per-pixel loops").c_str(), scalar * 1e6, "us/frame");
+		benchmark_report((what + ", kernels").c_str(), kernels * 1e6, "us/frame");
+	}
+}
+
+} // namespace
@@ -0,0 +1,285 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/libs/zmbv/zmbv.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace {
+
+constexpr int keyframe_interval = 300; // same as the DOSBox capture code
+
+uint32_t read_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+int format_pixel_size(zmbv_format_t format)
+{
+	switch (format) {
+	case ZMBV_FORMAT_8BPP: return 1;
+	case ZMBV_FORMAT_15BPP:
+	case ZMBV_FORMAT_16BPP: return 2;
+	default: return 4;
+	}
+}
+
+class FrameSource {
+public:
+	virtual ~FrameSource() = default;
+	virtual bool Open() = 0;
+	// Fills in the next frame, returns false at the end of the clip
+	virtual bool Next(std::vector<uint8_t> &frame, char *pal) = 0;
+
+	int width = 0;
+	int height = 0;
+	zmbv_format_t format = ZMBV_FORMAT_NONE;
+};
+
+// Decodes the video chunks of a ZMBV AVI; empty chunks repeat a frame
+class AviSource final : public FrameSource {
+public:
+	AviSource(const std::string &path) : avi_path(path) {}
+
+	bool Open() override
+	{
+		std::ifstream file(avi_path, std::ios::binary);
+		avi.assign(std::istreambuf_iterator<char>(file),
+		           std::istreambuf_iterator<char>());
+		const size_t avih = Find("avih", 0);
+		pos = Find("movi", 0);
+		if (avih + 44 > avi.size() || pos >= avi.size())
+			return false;
+		// Skip the chunk size and the first eight fields of the header
+		width = static_cast<int>(read_le32(&avi[avih + 36]));
+		height = static_cast<int>(read_le32(&avi[avih + 40]));
+		decoder.reset(new VideoCodec());
+		return decoder->SetupDecompress(width, height);
+	}
+
+	bool Next(std::vector<uint8_t> &frame, char *pal) override
+	{
+		while (pos + 8 <= avi.size()) {
+			const uint8_t *chunk = &avi[pos];
+			const uint32_t size = read_le32(chunk + 4);
+			pos += 8 + ((size + 1) & ~1u);
+			if (memcmp(chunk, "idx1", 4) == 0)
+				return false;
+			if (memcmp(chunk, "00dc", 4) != 0)
+				continue;
+			if (size && !decoder->DecompressFrame(const_cast<uint8_t *>(chunk + 8),
+			                                      static_cast<int>(size)))
+				return false;
+			// Large enough for any format
+			frame.resize(static_cast<size_t>(width) * height * 4);
+			format = decoder->GetDecodedFrame(frame.data(), pal);
+			return true;
+		}
+		return false;
+	}
+
+private:
+	size_t Find(const char *tag, size_t from) const
+	{
+		const auto it = std::search(avi.begin() + from, avi.end(), tag, tag + 4);
+		return static_cast<size_t>(it - avi.begin()) + 4;
+	}
+
+	std::string avi_path;
+	std::vector<uint8_t> avi = {};
+	size_t pos = 0;
+	std::unique_ptr<VideoCodec> decoder = {};
+};
+
+// A scrolling gradient with a few moving sprites and a noisy status area
+class SyntheticSource final : public FrameSource {
+public:
+	bool Open() override
+	{
+		width = 640;
+		height = 480;
+		format = ZMBV_FORMAT_32BPP;
+		frame_num = 0;
+		return true;
+	}
+
+	bool Next(std::vector<uint8_t> &frame, char *) override
+	{
+		if (frame_num == 300)
+			return false;
+		frame.resize(static_cast<size_t>(width) * height * 4);
+		auto pixels = reinterpret_cast<uint32_t *>(frame.data());
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++) {
+				const int v = (y + frame_num) & 0xff;
+				pixels[y * width + x] = (v << 16) | ((x / 8) << 8) | (v ^ x);
+			}
+		for (int s = 0; s < 8; s++) {
+			const int sx = (s * 73 + frame_num * (s + 1)) % (width - 32);
+			const int sy = (s * 51 + frame_num * 2) % (height - 32);
+			for (int y = 0; y < 32; y++)
+				for (int x = 0; x < 32; x++)
+					pixels[(sy + y) * width + sx + x] = 0xff00ff * s + x * y;
+		}
+		for (int y = height - 16; y < height; y++)
+			for (int x = 0; x < 64; x++)
+				pixels[y * width + x] = (x * 2654435761u + frame_num * 40503u) >> 8;
+		frame_num++;
+		return true;
+	}
+
+private:
+	int frame_num = 0;
+};
+
+struct Result {
+	int frames = 0;
+	uint64_t bytes = 0;
+	uint64_t hash = 14695981039346656037u; // FNV-1a over the output
+	double seconds = 0;
+};
+
+// Encodes up to max_frames frames of the source and passes each compressed
+// frame to the consumer
+template <typename Consumer>
+bool encode(FrameSource &source, int threads, int max_frames, Result &result,
+            Consumer &&consume)
+{
+	if (!source.Open())
+		return false;
+	std::vector<uint8_t> frame;
+	char pal[256 * 4] = {};
+	if (!source.Next(frame, pal))
+		return false;
+
+	VideoCodec codec;
+	if (!codec.SetupCompress(source.width, source.height))
+		return false;
+	codec.SetSearchThreads(threads);
+	const int size = codec.NeededSize(source.width, source.height, source.format);
+	std::vector<uint8_t> out(static_cast<size_t>(size));
+	const int pitch = source.width * format_pixel_size(source.format);
+
+	do {
+		const auto start = std::chrono::steady_clock::now();
+		const int flags = (result.frames % keyframe_interval) ? 0 : 1;
+		if (!codec.PrepareCompressFrame(flags, source.format, pal, out.data(), size))
+			return false;
+		for (int y = 0; y < source.height; y++) {
+			void *line = &frame[static_cast<size_t>(y) * pitch];
+			codec.CompressLines(1, &line);
+		}
+		const int written = codec.FinishCompressFrame();
+		result.seconds += std::chrono::duration<double>(
+		        std::chrono::steady_clock::now() - start).count();
+		if (written < 0)
+			return false;
+		for (int i = 0; i < written; i++)
+			result.hash = (result.hash ^ out[i]) * 1099511628211u;
+		result.bytes += written;
+		result.frames++;
+		consume(out.data(), written);
+	} while (result.frames < max_frames && source.Next(frame, pal));
+	return true;
+}
+
+bool encode(FrameSource &source, int threads, int max_frames, Result &result)
+{
+	return encode(source, threads, max_frames, result, [](const uint8_t *, int) {});
+}
+
+constexpr int test_frames = 40;
+
+TEST(ZMBV, DecodesToSourceFrames)
+{
+	SyntheticSource source;
+	Result result;
+	std::vector<std::vector<uint8_t>> encoded;
+	ASSERT_TRUE(encode(source, 1, test_frames, result, [&](const uint8_t *data, int size) {
+		encoded.emplace_back(data, data + size);
+	}));
+
+	VideoCodec decoder;
+	ASSERT_TRUE(decoder.SetupDecompress(source.width, source.height));
+	ASSERT_TRUE(source.Open());
+	std::vector<uint8_t> frame;
+	std::vector<uint8_t> decoded(static_cast<size_t>(source.width) * source.height * 4);
+	char pal[256 * 4] = {};
+	for (auto &chunk : encoded) {
+		ASSERT_TRUE(source.Next(frame, pal));
+		ASSERT_TRUE(decoder.DecompressFrame(chunk.data(), static_cast<int>(chunk.size())));
+		EXPECT_EQ(decoder.GetDecodedFrame(decoded.data(), pal), ZMBV_FORMAT_32BPP);
+		EXPECT_TRUE(decoded == frame) << "frame " << (&chunk - encoded.data());
+	}
+}
+
+TEST(ZMBV, ThreadsDontChangeOutput)
+{
+	SyntheticSource source;
+	Result single;
+	ASSERT_TRUE(encode(source, 1, test_frames, single));
+	Result threaded;
+	ASSERT_TRUE(encode(source, 4, test_frames, threaded));
+	EXPECT_EQ(threaded.bytes, single.bytes);
+	EXPECT_EQ(threaded.hash, single.hash);
+}
+
+// Time spent encoding, with a single motion search thread and with one per
+// core. Replays the capture named by the ZMBV_CAPTURE environment variable
+// (an AVI written by DOSBox), or else the synthetic clip.
+TEST(ZMBVBenchmark, Encode)
+{
+	std::unique_ptr<FrameSource> source;
+	const char *capture = getenv("ZMBV_CAPTURE");
+	if (capture)
+		source.reset(new AviSource(capture));
+	else
+		source.reset(new SyntheticSource());
+
+	const int cores = static_cast<int>(std::thread::hardware_concurrency());
+	Result baseline;
+	for (int threads : {1, std::max(cores, 2)}) {
+		Result result;
+		ASSERT_TRUE(encode(*source, threads, INT_MAX, result))
+		        << "failed to replay " << (capture ? capture : "the clip");
+		if (threads == 1)
+			baseline = result;
+		else
+			EXPECT_EQ(result.hash, baseline.hash);
+		const std::string what = std::to_string(threads) + " search thread(s)";
+		benchmark_report(what.c_str(), result.seconds * 1000 / result.frames, "ms/frame");
+	}
+}
+
+} // namespace